@@ -10,6 +10,18 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+
+int aws_iot_demo_main( int argc, char ** argv );
+
+#ifndef ESP_PLATFORM
+
+/* Host build: the network is already up. */
+int main( int argc, char ** argv )
+{
+    return aws_iot_demo_main( argc, argv );
+}
+
+#else
 #include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
@@ -18,8 +30,6 @@
 
 #include "esp_log.h"
 
-int aws_iot_demo_main( int argc, char ** argv );
-
 static const char *TAG = "MQTT_EXAMPLE";
 
 /*
@@ -57,3 +67,5 @@ void app_main()
 
     aws_iot_demo_main(0,NULL);
 }
+
+#endif /* ESP_PLATFORM */
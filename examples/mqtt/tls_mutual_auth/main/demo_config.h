@@ -48,6 +48,9 @@
 
 /************ End of logging configuration ****************/
 
+/* Kconfig options of the demo. The host build generates its own. */
+#include "sdkconfig.h"
+
 
 /**
  * @brief Details of the MQTT broker to connect to.
@@ -254,6 +254,15 @@
  */
 #define TRANSPORT_SEND_RECV_TIMEOUT_MS      ( 1500U )
 
+#ifdef ESP_PLATFORM
+
+/**
+ * @brief Size of the transport read-ahead buffer. Small incoming packets are
+ * decrypted into it in one read and handed to coreMQTT from memory.
+ */
+    #define TRANSPORT_READ_AHEAD_SIZE       ( 512U )
+#endif
+
 /**
  * @brief The MQTT metrics string expected by AWS IoT.
  */
@@ -347,6 +356,25 @@ static MQTTSubscribeInfo_t pGlobalSubscriptionList[ 1 ];
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+/**
+ * @brief Scratch buffer the transport uses to send each MQTT packet's vectors
+ * as a single TLS record.
+ */
+static uint8_t writevBuffer[ NETWORK_BUFFER_SIZE ];
+
+#ifdef ESP_PLATFORM
+
+/**
+ * @brief Read-ahead buffer for the transport. The host transport has none.
+ */
+static uint8_t readAheadBuffer[ TRANSPORT_READ_AHEAD_SIZE ];
+
+/**
+ * @brief Static buffer for TLS Context Semaphore.
+ */
+static StaticSemaphore_t xTlsContextSemaphoreBuffer;
+#endif
+
 /**
  * @brief Status of latest Subscribe ACK;
  * it is updated every time the callback function processes a Subscribe ACK
@@ -372,11 +400,6 @@ static MQTTPubAckInfo_t pOutgoingPublishRecords[ OUTGOING_PUBLISH_RECORD_LEN ];
  */
 static MQTTPubAckInfo_t pIncomingPublishRecords[ INCOMING_PUBLISH_RECORD_LEN ];
 
-/**
- * @brief Static buffer for TLS Context Semaphore.
- */
-static StaticSemaphore_t xTlsContextSemaphoreBuffer;
-
 /*-----------------------------------------------------------*/
 
 int aws_iot_demo_main( int argc, char ** argv );
@@ -628,7 +651,20 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     pNetworkContext->pcHostname = AWS_IOT_ENDPOINT;
     pNetworkContext->xPort = AWS_MQTT_PORT;
     pNetworkContext->pxTls = NULL;
+#ifdef ESP_PLATFORM
     pNetworkContext->xTlsContextSemaphore = xSemaphoreCreateMutexStatic(&xTlsContextSemaphoreBuffer);
+    pNetworkContext->xReadAhead.pucBuffer = readAheadBuffer;
+    pNetworkContext->xReadAhead.xSize = sizeof( readAheadBuffer );
+#else
+    if( ( pNetworkContext->xTlsMutexInitialised == false ) &&
+        ( xTlsInit( pNetworkContext ) != TLS_TRANSPORT_SUCCESS ) )
+    {
+        LogError( ( "Failed to initialise the network context." ) );
+        return EXIT_FAILURE;
+    }
+#endif
+    pNetworkContext->pucWritevBuffer = writevBuffer;
+    pNetworkContext->xWritevBufferSize = sizeof( writevBuffer );
 
     pNetworkContext->disableSni = 0;
     uint16_t nextRetryBackOff;
@@ -1381,7 +1417,7 @@ static int initializeMqtt( MQTTContext_t * pMqttContext,
     transport.pNetworkContext = pNetworkContext;
     transport.send = espTlsTransportSend;
     transport.recv = espTlsTransportRecv;
-    transport.writev = NULL;
+    transport.writev = espTlsTransportWritev;
 
     /* Fill the values for network buffer. */
     networkBuffer.pBuffer = buffer;
@@ -20,6 +20,10 @@ int aws_iot_demo_main( int argc, char ** argv );
 
 #include "esp_log.h"
 
+#if CONFIG_LOG_DEFERRED_ENABLE
+#include "log_deferred.h"
+#endif
+
 static const char *TAG = "OTA_MQTT";
 
 void app_main()
@@ -29,6 +33,15 @@ void app_main()
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
 
     esp_log_level_set("*", ESP_LOG_INFO);
+
+#if CONFIG_LOG_DEFERRED_ENABLE
+    /* Print the deferred logs of the OTA library and the demo, at the
+     * level set above. */
+    LogDeferred_SetLevel(ESP_LOG_INFO);
+    if (!LogDeferred_Start(NULL, NULL)) {
+        ESP_LOGE(TAG, "Failed to start the deferred logging task.");
+    }
+#endif
     
     /* Initialize NVS partition */
     esp_err_t ret = nvs_flash_init();
@@ -23,6 +23,13 @@
 #ifndef DEMO_CONFIG_H_
 #define DEMO_CONFIG_H_
 
+#include "sdkconfig.h"
+
+/* Defer the demo's logs together with the OTA library's, see log_deferred.h. */
+#if CONFIG_LOG_DEFERRED_ENABLE && !defined( LOGGING_STACK_DEFERRED )
+    #define LOGGING_STACK_DEFERRED    1
+#endif
+
 /**************************************************/
 /******* DO NOT CHANGE the following order ********/
 /**************************************************/
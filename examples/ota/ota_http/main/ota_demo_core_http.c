@@ -43,6 +43,7 @@
 /* pthread include. */
 #include <pthread.h>
 #include "semaphore.h"
+#include "event.h"
 #include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -327,6 +328,15 @@ static NetworkContext_t networkContextMqtt;
  */
 static NetworkContext_t networkContextHttp;
 
+/**
+ * @brief Credentials converted to DER once and shared by the MQTT and HTTP
+ * connections and their reconnects.
+ */
+static TlsCredential_t mqttRootCaCredential;
+static TlsCredential_t httpRootCaCredential;
+static TlsCredential_t clientCertCredential;
+static TlsCredential_t clientKeyCredential;
+
 
 /**
  * @brief The host address string extracted from the pre-signed URL.
@@ -378,9 +388,10 @@ static char serverHost[ 256 ];
 static size_t serverHostLength;
 
 /**
- * @brief Semaphore for synchronizing buffer operations.
+ * @brief Event for synchronizing buffer operations, taken with a zero timeout
+ * around every block buffer get and free.
  */
-static osi_sem_t bufferSemaphore;
+static osi_event_t bufferEvent;
 
 /**
  * @brief Semaphore for synchronizing wait for ack.
@@ -724,16 +735,14 @@ static SubscriptionManagerCallback_t otaMessageCallback[] = { mqttJobCallback, m
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( osi_sem_take( &bufferSemaphore, 0 ) == 0 )
+    if( osi_event_wait( &bufferEvent, 0 ) == 0 )
     {
         pxBuffer->bufferUsed = false;
-        ( void ) osi_sem_give( &bufferSemaphore );
+        osi_event_signal( &bufferEvent );
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to get buffer event: another task holds it." ) );
     }
 }
 
@@ -744,7 +753,7 @@ OtaEventData_t * otaEventBufferGet( void )
     uint32_t ulIndex = 0;
     OtaEventData_t * pFreeBuffer = NULL;
 
-    if( osi_sem_take( &bufferSemaphore, 0 ) == 0 )
+    if( osi_event_wait( &bufferEvent, 0 ) == 0 )
     {
         for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
         {
@@ -756,13 +765,11 @@ OtaEventData_t * otaEventBufferGet( void )
             }
         }
 
-        ( void ) osi_sem_give( &bufferSemaphore );
+        osi_event_signal( &bufferEvent );
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to get buffer event: another task holds it." ) );
     }
 
     return pFreeBuffer;
@@ -1104,12 +1111,17 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
 
     /* Initialize credentials for establishing TLS session. */
     pNetworkContext->pcServerRootCAPem = root_cert_auth_pem_start;
+    pNetworkContext->pxServerRootCA = &mqttRootCaCredential;
 
     /* If #CLIENT_USERNAME is defined, username/password is used for authenticating
      * the client. */
     #ifndef CLIENT_USERNAME
         pNetworkContext->pcClientCertPem = client_cert_pem_start;
         pNetworkContext->pcClientKeyPem = client_key_pem_start;
+        pNetworkContext->pxClientCert = &clientCertCredential;
+        #if !defined( CONFIG_EXAMPLE_USE_SECURE_ELEMENT ) && !defined( CONFIG_EXAMPLE_USE_DS_PERIPHERAL )
+            pNetworkContext->pxClientKey = &clientKeyCredential;
+        #endif
     #endif
 
     if( AWS_MQTT_PORT == 443 )
@@ -1374,6 +1386,7 @@ static int32_t connectToS3Server( NetworkContext_t * pNetworkContext,
 
     /* Initialize TLS credentials. */
     pNetworkContext->pcServerRootCAPem = http_root_cert_auth_pem_start;
+    pNetworkContext->pxServerRootCA = &httpRootCaCredential;
 
 #ifdef CONFIG_EXAMPLE_USE_SECURE_ELEMENT
     pNetworkContext->pcClientCertPem = NULL;
@@ -1388,6 +1401,8 @@ static int32_t connectToS3Server( NetworkContext_t * pNetworkContext,
 #else
     pNetworkContext->pcClientCertPem = client_cert_pem_start;
     pNetworkContext->pcClientKeyPem = client_key_pem_start;
+    pNetworkContext->pxClientCert = &clientCertCredential;
+    pNetworkContext->pxClientKey = &clientKeyCredential;
 #endif
 
     /* Retrieve the address location and length from S3_PRESIGNED_GET_URL. */
@@ -2199,8 +2214,8 @@ int aws_iot_demo_main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
+    /* Event, semaphore and mutex initialization flags. */
+    bool bufferEventInitialized = false;
     bool ackSemInitialized = false;
     bool mqttMutexInitialized = false;
 
@@ -2212,19 +2227,9 @@ int aws_iot_demo_main( int argc,
                appFirmwareVersion.u.x.minor,
                appFirmwareVersion.u.x.build ) );
 
-    /* Initialize semaphore for buffer operations. */
-    if( osi_sem_new( &bufferSemaphore, 0x7FFFU, 1 ) != 0 )
-    {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        bufferSemInitialized = true;
-    }
+    /* Initialize event for buffer operations. */
+    osi_event_init( &bufferEvent, 1 );
+    bufferEventInitialized = true;
 
     /* Initialize semaphore for ack. */
     if( osi_sem_new( &ackSemaphore, 0x7FFFU, 0 ) != 0 )
@@ -2254,6 +2259,27 @@ int aws_iot_demo_main( int argc,
         mqttMutexInitialized = true;
     }
 
+    /* Convert the credentials to DER once for both connections. The private
+     * key stays in the secure element or the DS peripheral when one is used. */
+    if( ( xTlsCredentialLoad( &mqttRootCaCredential, root_cert_auth_pem_start ) != TLS_TRANSPORT_SUCCESS ) ||
+        ( xTlsCredentialLoad( &httpRootCaCredential, http_root_cert_auth_pem_start ) != TLS_TRANSPORT_SUCCESS ) ||
+        ( xTlsCredentialLoad( &clientCertCredential, client_cert_pem_start ) != TLS_TRANSPORT_SUCCESS ) )
+    {
+        LogError( ( "Failed to load TLS credentials." ) );
+
+        returnStatus = EXIT_FAILURE;
+    }
+
+    #if !defined( CONFIG_EXAMPLE_USE_SECURE_ELEMENT ) && !defined( CONFIG_EXAMPLE_USE_DS_PERIPHERAL )
+        if( ( returnStatus == EXIT_SUCCESS ) &&
+            ( xTlsCredentialLoad( &clientKeyCredential, client_key_pem_start ) != TLS_TRANSPORT_SUCCESS ) )
+        {
+            LogError( ( "Failed to load the TLS private key." ) );
+
+            returnStatus = EXIT_FAILURE;
+        }
+    #endif
+
     if( returnStatus == EXIT_SUCCESS )
     {
         /* Initialize MQTT library. Initialization of the MQTT library needs to be
@@ -2273,17 +2299,15 @@ int aws_iot_demo_main( int argc,
     /* Disconnect from S3 and close connection. */
     xTlsDisconnect( &networkContextHttp );
 
-    if( bufferSemInitialized == true )
-    {
-        /* Cleanup semaphore created for buffer operations. */
-        if( osi_sem_free( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
+    vTlsCredentialFree( &mqttRootCaCredential );
+    vTlsCredentialFree( &httpRootCaCredential );
+    vTlsCredentialFree( &clientCertCredential );
+    vTlsCredentialFree( &clientKeyCredential );
 
-            returnStatus = EXIT_FAILURE;
-        }
+    if( bufferEventInitialized == true )
+    {
+        /* Cleanup event created for buffer operations. */
+        osi_event_deinit( &bufferEvent );
     }
 
     if( ackSemInitialized == true )
@@ -43,6 +43,7 @@
 /* pthread include. */
 #include <pthread.h>
 #include "semaphore.h"
+#include "event.h"
 #include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -290,10 +291,10 @@ static bool mqttSessionEstablished = false;
 static pthread_mutex_t mqttMutex;
 
 /**
- * @brief Semaphore for synchronizing buffer operations.
+ * @brief Event for synchronizing buffer operations, taken with a zero timeout
+ * around every block buffer get and free.
  */
-// static osi_sem_t bufferSemaphore;
-static osi_sem_t bufferSemaphore;
+static osi_event_t bufferEvent;
 
 /**
  * @brief Semaphore for synchronizing wait for ack.
@@ -589,16 +590,14 @@ static SubscriptionManagerCallback_t otaMessageCallback[] = { mqttJobCallback, m
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( osi_sem_take( &bufferSemaphore, 0 ) == 0 )
+    if( osi_event_wait( &bufferEvent, 0 ) == 0 )
     {
         pxBuffer->bufferUsed = false;
-        ( void ) osi_sem_give( &bufferSemaphore );
+        osi_event_signal( &bufferEvent );
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to get buffer event: another task holds it." ) );
     }
 }
 
@@ -609,7 +608,7 @@ OtaEventData_t * otaEventBufferGet( void )
     uint32_t ulIndex = 0;
     OtaEventData_t * pFreeBuffer = NULL;
 
-    if( osi_sem_take( &bufferSemaphore, 0 ) == 0 )
+    if( osi_event_wait( &bufferEvent, 0 ) == 0 )
     {
         for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
         {
@@ -621,13 +620,11 @@ OtaEventData_t * otaEventBufferGet( void )
             }
         }
 
-        ( void ) osi_sem_give( &bufferSemaphore );
+        osi_event_signal( &bufferEvent );
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to get buffer event: another task holds it." ) );
     }
 
     return pFreeBuffer;
@@ -1746,27 +1743,17 @@ int aws_iot_demo_main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
+    /* Event, semaphore and mutex initialization flags. */
+    bool bufferEventInitialized = false;
     bool ackSemInitialized = false;
     bool mqttMutexInitialized = false;
 
     /* Maximum time in milliseconds to wait before exiting demo . */
     int16_t waitTimeoutMs = OTA_DEMO_EXIT_TIMEOUT_MS;
 
-    /* Initialize semaphore for buffer operations. */
-    if( osi_sem_new( &bufferSemaphore, 0x7FFFU, 1 ) != 0 )
-    {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        bufferSemInitialized = true;
-    }
+    /* Initialize event for buffer operations. */
+    osi_event_init( &bufferEvent, 1 );
+    bufferEventInitialized = true;
 
     /* Initialize semaphore for ack. */
     if( osi_sem_new( &ackSemaphore, 0x7FFFU, 0 ) != 0 )
@@ -1812,17 +1799,10 @@ int aws_iot_demo_main( int argc,
     /* Disconnect from broker and close connection. */
     disconnect();
 
-    if( bufferSemInitialized == true )
+    if( bufferEventInitialized == true )
     {
-        /* Cleanup semaphore created for buffer operations. */
-        if( osi_sem_free( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
+        /* Cleanup event created for buffer operations. */
+        osi_event_deinit( &bufferEvent );
     }
 
     if( ackSemInitialized == true )
@@ -81,6 +81,29 @@
     #define SdkLog( string )    printf string
 #endif
 
+/**
+ * @brief Set to 1 before including this file to send the logging macros
+ * through the deferred backend of posix_compat, see log_deferred.h. The
+ * module must then depend on the posix_compat component.
+ */
+#ifndef LOGGING_STACK_DEFERRED
+    #define LOGGING_STACK_DEFERRED    0
+#endif
+
+#if LOGGING_STACK_DEFERRED
+    #include "log_deferred.h"
+
+    #define SdkLogError( message, ... )    LOG_DEFERRED( LOG_ERROR, LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define SdkLogWarn( message, ... )     LOG_DEFERRED( LOG_WARN, LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define SdkLogInfo( message, ... )     LOG_DEFERRED( LOG_INFO, LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define SdkLogDebug( message, ... )    LOG_DEFERRED( LOG_DEBUG, LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+#else
+    #define SdkLogError( message, ... )    ESP_LOGE(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__)
+    #define SdkLogWarn( message, ... )     ESP_LOGW(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__)
+    #define SdkLogInfo( message, ... )     ESP_LOGI(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__)
+    #define SdkLogDebug( message, ... )    ESP_LOGD(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__)
+#endif
+
 /**
  * Disable definition of logging interface macros when generating doxygen output,
  * to avoid conflict with documentation of macros at the end of the file.
@@ -96,28 +119,28 @@
 #else
     #if LIBRARY_LOG_LEVEL == LOG_DEBUG
         /* All log level messages will logged. */
-        #define LogError( message, ... )    ESP_LOGE(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogWarn( message, ... )     ESP_LOGW(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogInfo( message, ... )     ESP_LOGI(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogDebug( message, ... )    ESP_LOGD(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
+        #define LogError( message, ... )    SdkLogError( message, ##__VA_ARGS__ );
+        #define LogWarn( message, ... )     SdkLogWarn( message, ##__VA_ARGS__ );
+        #define LogInfo( message, ... )     SdkLogInfo( message, ##__VA_ARGS__ );
+        #define LogDebug( message, ... )    SdkLogDebug( message, ##__VA_ARGS__ );
 
     #elif LIBRARY_LOG_LEVEL == LOG_INFO
         /* Only INFO, WARNING and ERROR messages will be logged. */
-        #define LogError( message, ... )    ESP_LOGE(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogWarn( message, ... )     ESP_LOGW(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogInfo( message, ... )     ESP_LOGI(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
+        #define LogError( message, ... )    SdkLogError( message, ##__VA_ARGS__ );
+        #define LogWarn( message, ... )     SdkLogWarn( message, ##__VA_ARGS__ );
+        #define LogInfo( message, ... )     SdkLogInfo( message, ##__VA_ARGS__ );
         #define LogDebug( message, ... )
 
     #elif LIBRARY_LOG_LEVEL == LOG_WARN
         /* Only WARNING and ERROR messages will be logged.*/
-        #define LogError( message, ... )    ESP_LOGE(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
-        #define LogWarn( message, ... )     ESP_LOGW(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
+        #define LogError( message, ... )    SdkLogError( message, ##__VA_ARGS__ );
+        #define LogWarn( message, ... )     SdkLogWarn( message, ##__VA_ARGS__ );
         #define LogInfo( message, ... )
         #define LogDebug( message, ... )
 
     #elif LIBRARY_LOG_LEVEL == LOG_ERROR
         /* Only ERROR messages will be logged. */
-        #define LogError( message, ... )    ESP_LOGE(LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__);
+        #define LogError( message, ... )    SdkLogError( message, ##__VA_ARGS__ );
         #define LogWarn( message, ... )
         #define LogInfo( message, ... )
         #define LogDebug( message, ... )
@@ -0,0 +1,755 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file transport_bench.c
+ * @brief Host benchmark of the POSIX TLS transport against a local broker
+ * and a local HTTPS server.
+ *
+ * A server thread in the same process listens on 127.0.0.1 with a
+ * self-signed certificate for localhost made at startup, which the client
+ * trusts as its root CA, so the handshake verifies the peer exactly as a
+ * demo does. The server plays two roles, one connection each:
+ *
+ * - Broker: answers CONNECT with CONNACK and each QoS 1 PUBLISH with a
+ *   PUBACK. The client sends its publishes through espTlsTransportWritev()
+ *   with up to a window of them in flight, as the MQTT demos do.
+ * - HTTPS: answers each GET with a Range header with a 206 carrying that
+ *   range, over one keep-alive connection, as the OTA over HTTP demo
+ *   downloads its image in blocks.
+ *
+ * Then the server closes a connection while the client still sends to it;
+ * the send must fail instead of SIGPIPE ending the process. The benchmark
+ * prints the handshake time, the publishes and the bytes per second and the
+ * round-trip latency percentiles:
+ *
+ * @code
+ * network_transport_bench -n 20000 -w 8 -s 256 -r 200 -b 4096
+ * @endcode
+ *
+ * Options: -n publishes, -w publishes in flight, -s publish payload bytes,
+ * -r ranged GETs, -b bytes per range, -g writev gather buffer bytes (0 sends
+ * each vector separately).
+ *
+ * Exits with 0 on success, or prints the failed step and exits with 1.
+ */
+
+/* Standard includes. */
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* OpenSSL includes. */
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include "network_transport.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Topic of the benchmark publishes.
+ */
+#define BENCH_TOPIC                 "bench/transport"
+
+/**
+ * @brief Largest MQTT packet or HTTP request the server accepts.
+ */
+#define BENCH_SERVER_BUFFER_SIZE    ( 65536U )
+
+/**
+ * @brief How long the client waits for any one response.
+ */
+#define BENCH_RESPONSE_TIMEOUT_MS   ( 10000U )
+
+#define CHECK( condition )                                                      \
+    do                                                                          \
+    {                                                                           \
+        if( !( condition ) )                                                    \
+        {                                                                       \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition ); \
+            exit( 1 );                                                          \
+        }                                                                       \
+    } while( 0 )
+
+/**
+ * @brief Role the server plays on the connection it accepts next.
+ */
+typedef enum BenchRole
+{
+    BENCH_ROLE_BROKER,
+    BENCH_ROLE_HTTPS,
+    BENCH_ROLE_CLOSE
+} BenchRole_t;
+
+/**
+ * @brief Server state, shared with the client only before a connection.
+ */
+typedef struct BenchServer
+{
+    SSL_CTX * pSslContext;
+    int listenSocket;
+    uint16_t port;
+    BenchRole_t role;
+    pthread_t thread;
+} BenchServer_t;
+
+static char serverCertPem[ 4096 ];
+
+/*-----------------------------------------------------------*/
+
+static uint64_t nowUs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000U ) + ( ( uint64_t ) now.tv_nsec / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareLatency( const void * pLeft,
+                           const void * pRight )
+{
+    uint32_t left = *( const uint32_t * ) pLeft;
+    uint32_t right = *( const uint32_t * ) pRight;
+
+    return ( left > right ) - ( left < right );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t percentile( const uint32_t * pSorted,
+                            size_t count,
+                            uint32_t permille )
+{
+    size_t index = ( count * permille ) / 1000U;
+
+    return ( count == 0U ) ? 0U : pSorted[ ( index < count ) ? index : ( count - 1U ) ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void printLatency( const char * pName,
+                          uint32_t * pLatencyUs,
+                          size_t count )
+{
+    qsort( pLatencyUs, count, sizeof( uint32_t ), compareLatency );
+    printf( "%s latency us: p50 %" PRIu32 ", p90 %" PRIu32 ", p99 %" PRIu32 ", max %" PRIu32 "\n",
+            pName, percentile( pLatencyUs, count, 500U ), percentile( pLatencyUs, count, 900U ),
+            percentile( pLatencyUs, count, 990U ), percentile( pLatencyUs, count, 1000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A P-256 key and a certificate for localhost signed with it, kept as the
+ * server's credentials and, in PEM, as the client's root CA. */
+static SSL_CTX * createServerContext( void )
+{
+    SSL_CTX * pSslContext = SSL_CTX_new( TLS_server_method() );
+    EVP_PKEY_CTX * pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+    EVP_PKEY * pKey = NULL;
+    X509 * pCert = X509_new();
+    X509_NAME * pName;
+    X509_EXTENSION * pSubjectAltName;
+    BIO * pBio = BIO_new( BIO_s_mem() );
+    int length;
+
+    CHECK( ( pSslContext != NULL ) && ( pKeyContext != NULL ) && ( pCert != NULL ) && ( pBio != NULL ) );
+    CHECK( EVP_PKEY_keygen_init( pKeyContext ) == 1 );
+    CHECK( EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) == 1 );
+    CHECK( EVP_PKEY_keygen( pKeyContext, &pKey ) == 1 );
+
+    CHECK( X509_set_version( pCert, 2 ) == 1 );
+    CHECK( ASN1_INTEGER_set( X509_get_serialNumber( pCert ), 1 ) == 1 );
+    CHECK( X509_gmtime_adj( X509_getm_notBefore( pCert ), -3600 ) != NULL );
+    CHECK( X509_gmtime_adj( X509_getm_notAfter( pCert ), 24 * 3600 ) != NULL );
+    CHECK( X509_set_pubkey( pCert, pKey ) == 1 );
+    pName = X509_get_subject_name( pCert );
+    CHECK( X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC, ( const unsigned char * ) "localhost", -1, -1, 0 ) == 1 );
+    CHECK( X509_set_issuer_name( pCert, pName ) == 1 );
+    pSubjectAltName = X509V3_EXT_conf_nid( NULL, NULL, NID_subject_alt_name, "DNS:localhost" );
+    CHECK( pSubjectAltName != NULL );
+    CHECK( X509_add_ext( pCert, pSubjectAltName, -1 ) == 1 );
+    X509_EXTENSION_free( pSubjectAltName );
+    CHECK( X509_sign( pCert, pKey, EVP_sha256() ) > 0 );
+
+    CHECK( SSL_CTX_use_certificate( pSslContext, pCert ) == 1 );
+    CHECK( SSL_CTX_use_PrivateKey( pSslContext, pKey ) == 1 );
+
+    CHECK( PEM_write_bio_X509( pBio, pCert ) == 1 );
+    length = BIO_read( pBio, serverCertPem, ( int ) sizeof( serverCertPem ) - 1 );
+    CHECK( length > 0 );
+    serverCertPem[ length ] = '\0';
+
+    BIO_free( pBio );
+    X509_free( pCert );
+    EVP_PKEY_free( pKey );
+    EVP_PKEY_CTX_free( pKeyContext );
+
+    return pSslContext;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool serverReadExact( SSL * pSsl,
+                             uint8_t * pBuffer,
+                             size_t length )
+{
+    size_t received = 0U;
+
+    while( received < length )
+    {
+        int result = SSL_read( pSsl, &pBuffer[ received ], ( int ) ( length - received ) );
+
+        if( result <= 0 )
+        {
+            return false;
+        }
+
+        received += ( size_t ) result;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/* CONNECT, PUBLISH at QoS 1 and DISCONNECT only; the client is ours. */
+static void serveBroker( SSL * pSsl,
+                         uint8_t * pBuffer )
+{
+    for( ; ; )
+    {
+        uint8_t header;
+        uint32_t remaining = 0U;
+        uint32_t shift = 0U;
+        uint8_t byte;
+
+        if( !serverReadExact( pSsl, &header, 1U ) )
+        {
+            return;
+        }
+
+        do
+        {
+            CHECK( serverReadExact( pSsl, &byte, 1U ) && ( shift <= 21U ) );
+            remaining |= ( uint32_t ) ( byte & 0x7FU ) << shift;
+            shift += 7U;
+        } while( ( byte & 0x80U ) != 0U );
+
+        CHECK( remaining <= BENCH_SERVER_BUFFER_SIZE );
+        CHECK( serverReadExact( pSsl, pBuffer, remaining ) );
+
+        if( header == 0x10U )
+        {
+            static const uint8_t connack[] = { 0x20U, 0x02U, 0x00U, 0x00U };
+
+            CHECK( SSL_write( pSsl, connack, sizeof( connack ) ) == ( int ) sizeof( connack ) );
+        }
+        else if( ( header & 0xF6U ) == 0x32U )
+        {
+            /* The packet identifier follows the topic. */
+            uint16_t topicLength = ( uint16_t ) ( ( pBuffer[ 0 ] << 8 ) | pBuffer[ 1 ] );
+            uint8_t puback[] = { 0x40U, 0x02U, 0U, 0U };
+
+            CHECK( remaining >= 4U + ( uint32_t ) topicLength );
+            puback[ 2 ] = pBuffer[ 2U + topicLength ];
+            puback[ 3 ] = pBuffer[ 3U + topicLength ];
+            CHECK( SSL_write( pSsl, puback, sizeof( puback ) ) == ( int ) sizeof( puback ) );
+        }
+        else
+        {
+            CHECK( header == 0xE0U );
+            return;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* One GET with "Range: bytes=<first>-<last>" per request, kept alive. */
+static void serveHttps( SSL * pSsl,
+                        uint8_t * pBuffer )
+{
+    size_t used = 0U;
+
+    for( ; ; )
+    {
+        char * pEnd;
+        char * pRange;
+        unsigned long first;
+        unsigned long last;
+        char head[ 128 ];
+        int headLength;
+        size_t requestLength;
+        int result;
+
+        pBuffer[ used ] = '\0';
+        pEnd = strstr( ( char * ) pBuffer, "\r\n\r\n" );
+
+        if( pEnd == NULL )
+        {
+            CHECK( used < BENCH_SERVER_BUFFER_SIZE - 1U );
+            result = SSL_read( pSsl, &pBuffer[ used ], ( int ) ( BENCH_SERVER_BUFFER_SIZE - 1U - used ) );
+
+            if( result <= 0 )
+            {
+                return;
+            }
+
+            used += ( size_t ) result;
+            continue;
+        }
+
+        pRange = strstr( ( char * ) pBuffer, "Range: bytes=" );
+        CHECK( ( pRange != NULL ) && ( pRange < pEnd ) );
+        CHECK( sscanf( pRange, "Range: bytes=%lu-%lu", &first, &last ) == 2 );
+        CHECK( ( first <= last ) && ( last - first < BENCH_SERVER_BUFFER_SIZE ) );
+
+        requestLength = ( size_t ) ( pEnd + 4 - ( char * ) pBuffer );
+        memmove( pBuffer, &pBuffer[ requestLength ], used - requestLength );
+        used -= requestLength;
+
+        headLength = snprintf( head, sizeof( head ),
+                               "HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\n\r\n",
+                               last - first + 1U );
+        CHECK( SSL_write( pSsl, head, headLength ) == headLength );
+
+        /* The body is the low byte of each offset, for the client to check. */
+        {
+            uint8_t body[ 4096 ];
+            unsigned long offset = first;
+
+            while( offset <= last )
+            {
+                size_t chunk = ( last - offset + 1U < sizeof( body ) ) ? ( last - offset + 1U ) : sizeof( body );
+                size_t i;
+
+                for( i = 0U; i < chunk; i++ )
+                {
+                    body[ i ] = ( uint8_t ) ( offset + i );
+                }
+
+                CHECK( SSL_write( pSsl, body, ( int ) chunk ) == ( int ) chunk );
+                offset += chunk;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverThread( void * pvParameters )
+{
+    BenchServer_t * pServer = pvParameters;
+    uint8_t * pBuffer = malloc( BENCH_SERVER_BUFFER_SIZE );
+    int clientSocket = accept( pServer->listenSocket, NULL, NULL );
+    SSL * pSsl = SSL_new( pServer->pSslContext );
+    int noDelay = 1;
+
+    CHECK( ( pBuffer != NULL ) && ( clientSocket >= 0 ) && ( pSsl != NULL ) );
+
+    /* The head and the body of a response are separate writes. */
+    CHECK( setsockopt( clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof( noDelay ) ) == 0 );
+    CHECK( SSL_set_fd( pSsl, clientSocket ) == 1 );
+    CHECK( SSL_accept( pSsl ) == 1 );
+
+    if( pServer->role == BENCH_ROLE_BROKER )
+    {
+        serveBroker( pSsl, pBuffer );
+    }
+    else if( pServer->role == BENCH_ROLE_HTTPS )
+    {
+        serveHttps( pSsl, pBuffer );
+    }
+
+    /* BENCH_ROLE_CLOSE drops the connection without close_notify. */
+    SSL_free( pSsl );
+    ( void ) close( clientSocket );
+    free( pBuffer );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void serverStart( BenchServer_t * pServer,
+                         BenchRole_t role )
+{
+    pServer->role = role;
+    CHECK( pthread_create( &pServer->thread, NULL, serverThread, pServer ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void serverListen( BenchServer_t * pServer )
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof( address );
+
+    pServer->pSslContext = createServerContext();
+    pServer->listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    CHECK( pServer->listenSocket >= 0 );
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    CHECK( bind( pServer->listenSocket, ( struct sockaddr * ) &address, sizeof( address ) ) == 0 );
+    CHECK( listen( pServer->listenSocket, 1 ) == 0 );
+    CHECK( getsockname( pServer->listenSocket, ( struct sockaddr * ) &address, &addressLength ) == 0 );
+    pServer->port = ntohs( address.sin_port );
+}
+
+/*-----------------------------------------------------------*/
+
+static void clientRecvExact( NetworkContext_t * pNetworkContext,
+                             uint8_t * pBuffer,
+                             size_t length )
+{
+    uint64_t deadlineUs = nowUs() + ( BENCH_RESPONSE_TIMEOUT_MS * 1000U );
+    size_t received = 0U;
+
+    while( received < length )
+    {
+        int32_t result = espTlsTransportRecv( pNetworkContext, &pBuffer[ received ], length - received );
+
+        CHECK( result >= 0 );
+        CHECK( ( result > 0 ) || ( nowUs() < deadlineUs ) );
+        received += ( size_t ) result;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t clientConnect( NetworkContext_t * pNetworkContext,
+                               const BenchServer_t * pServer )
+{
+    uint64_t startUs = nowUs();
+
+    pNetworkContext->pcHostname = "localhost";
+    pNetworkContext->xPort = pServer->port;
+    pNetworkContext->pcServerRootCAPem = serverCertPem;
+    CHECK( xTlsConnect( pNetworkContext ) == TLS_TRANSPORT_SUCCESS );
+
+    return nowUs() - startUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchBroker( NetworkContext_t * pNetworkContext,
+                         BenchServer_t * pServer,
+                         uint32_t publishes,
+                         uint32_t window,
+                         size_t payloadSize )
+{
+    static const uint8_t connect[] =
+    {
+        0x10U, 0x10U, 0x00U, 0x04U, 'M', 'Q', 'T', 'T', 0x04U, 0x02U, 0x00U, 0x3CU,
+        0x00U, 0x04U, 'b', 'e', 'n', 'c'
+    };
+    uint32_t * pLatencyUs = calloc( publishes, sizeof( uint32_t ) );
+    uint64_t * pSentUs = calloc( 65536U, sizeof( uint64_t ) );
+    uint8_t * pPayload = calloc( 1U, payloadSize + 1U );
+    uint8_t header[ 5 ];
+    uint8_t variable[ 2U + sizeof( BENCH_TOPIC ) - 1U + 2U ];
+    uint8_t response[ 4 ];
+    uint32_t remaining = ( uint32_t ) ( sizeof( variable ) + payloadSize );
+    size_t headerLength = 1U;
+    uint32_t sent = 0U;
+    uint32_t acked = 0U;
+    uint64_t handshakeUs;
+    uint64_t startUs;
+    uint64_t elapsedUs;
+
+    CHECK( ( pLatencyUs != NULL ) && ( pSentUs != NULL ) && ( pPayload != NULL ) );
+
+    serverStart( pServer, BENCH_ROLE_BROKER );
+    handshakeUs = clientConnect( pNetworkContext, pServer );
+    CHECK( espTlsTransportSend( pNetworkContext, connect, sizeof( connect ) ) == ( int32_t ) sizeof( connect ) );
+    clientRecvExact( pNetworkContext, response, sizeof( response ) );
+    CHECK( ( response[ 0 ] == 0x20U ) && ( response[ 3 ] == 0x00U ) );
+
+    header[ 0 ] = 0x32U;
+
+    do
+    {
+        header[ headerLength ] = ( uint8_t ) ( remaining & 0x7FU );
+        remaining >>= 7;
+        header[ headerLength ] |= ( remaining != 0U ) ? 0x80U : 0U;
+        headerLength++;
+    } while( remaining != 0U );
+
+    variable[ 0 ] = 0U;
+    variable[ 1 ] = ( uint8_t ) ( sizeof( BENCH_TOPIC ) - 1U );
+    memcpy( &variable[ 2 ], BENCH_TOPIC, sizeof( BENCH_TOPIC ) - 1U );
+
+    startUs = nowUs();
+
+    while( acked < publishes )
+    {
+        while( ( sent < publishes ) && ( sent - acked < window ) )
+        {
+            /* Packet identifiers are 1 to 65535. */
+            uint16_t packetId = ( uint16_t ) ( ( sent % 65535U ) + 1U );
+            TransportOutVector_t vectors[ 3 ] =
+            {
+                { header,   headerLength     },
+                { variable, sizeof( variable ) },
+                { pPayload, payloadSize      }
+            };
+            size_t total = headerLength + sizeof( variable ) + payloadSize;
+            size_t done = 0U;
+
+            variable[ sizeof( variable ) - 2U ] = ( uint8_t ) ( packetId >> 8 );
+            variable[ sizeof( variable ) - 1U ] = ( uint8_t ) packetId;
+            pSentUs[ packetId ] = nowUs();
+
+            /* As the agent does, resend what a short write left over. */
+            while( done < total )
+            {
+                TransportOutVector_t * pVector = vectors;
+                size_t count = 3U;
+                size_t skip = done;
+                int32_t result;
+
+                while( skip >= pVector->iov_len )
+                {
+                    skip -= pVector->iov_len;
+                    pVector++;
+                    count--;
+                }
+
+                pVector->iov_base = ( const uint8_t * ) pVector->iov_base + skip;
+                pVector->iov_len -= skip;
+                result = espTlsTransportWritev( pNetworkContext, pVector, count );
+                CHECK( result >= 0 );
+                done += ( size_t ) result;
+            }
+
+            sent++;
+        }
+
+        clientRecvExact( pNetworkContext, response, sizeof( response ) );
+        CHECK( response[ 0 ] == 0x40U );
+        pLatencyUs[ acked ] = ( uint32_t ) ( nowUs() - pSentUs[ ( response[ 2 ] << 8 ) | response[ 3 ] ] );
+        acked++;
+    }
+
+    elapsedUs = nowUs() - startUs;
+
+    header[ 0 ] = 0xE0U;
+    header[ 1 ] = 0x00U;
+    CHECK( espTlsTransportSend( pNetworkContext, header, 2U ) == 2 );
+    CHECK( xTlsDisconnect( pNetworkContext ) == TLS_TRANSPORT_SUCCESS );
+    CHECK( pthread_join( pServer->thread, NULL ) == 0 );
+
+    printf( "broker: handshake %" PRIu64 " us, %" PRIu32 " publishes of %zu bytes, window %" PRIu32 ", %.0f publishes/s\n",
+            handshakeUs, publishes, payloadSize, window,
+            ( elapsedUs > 0U ) ? ( ( double ) publishes * 1e6 / ( double ) elapsedUs ) : 0.0 );
+    printLatency( "broker PUBLISH to PUBACK", pLatencyUs, publishes );
+
+    free( pPayload );
+    free( pSentUs );
+    free( pLatencyUs );
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchHttps( NetworkContext_t * pNetworkContext,
+                        BenchServer_t * pServer,
+                        uint32_t requests,
+                        size_t rangeSize )
+{
+    uint32_t * pLatencyUs = calloc( requests, sizeof( uint32_t ) );
+    uint8_t * pBody = malloc( rangeSize );
+    uint64_t handshakeUs;
+    uint64_t startUs;
+    uint64_t elapsedUs;
+    uint32_t i;
+
+    CHECK( ( pLatencyUs != NULL ) && ( pBody != NULL ) );
+
+    serverStart( pServer, BENCH_ROLE_HTTPS );
+    handshakeUs = clientConnect( pNetworkContext, pServer );
+    startUs = nowUs();
+
+    for( i = 0U; i < requests; i++ )
+    {
+        char request[ 160 ];
+        char head[ 128 ];
+        size_t headLength = 0U;
+        unsigned long contentLength = 0U;
+        size_t first = ( size_t ) i * rangeSize;
+        int requestLength = snprintf( request, sizeof( request ),
+                                      "GET /firmware.bin HTTP/1.1\r\nHost: localhost\r\nRange: bytes=%zu-%zu\r\n\r\n",
+                                      first, first + rangeSize - 1U );
+        uint64_t requestUs = nowUs();
+        size_t j;
+
+        CHECK( espTlsTransportSend( pNetworkContext, request, ( size_t ) requestLength ) == requestLength );
+
+        /* Read the head a byte at a time, so none of the body is consumed. */
+        do
+        {
+            CHECK( headLength < sizeof( head ) - 1U );
+            clientRecvExact( pNetworkContext, ( uint8_t * ) &head[ headLength ], 1U );
+            headLength++;
+            head[ headLength ] = '\0';
+        } while( ( headLength < 4U ) || ( strcmp( &head[ headLength - 4U ], "\r\n\r\n" ) != 0 ) );
+
+        CHECK( strncmp( head, "HTTP/1.1 206", 12 ) == 0 );
+        CHECK( sscanf( strstr( head, "Content-Length: " ), "Content-Length: %lu", &contentLength ) == 1 );
+        CHECK( contentLength == rangeSize );
+        clientRecvExact( pNetworkContext, pBody, rangeSize );
+        pLatencyUs[ i ] = ( uint32_t ) ( nowUs() - requestUs );
+
+        for( j = 0U; j < rangeSize; j++ )
+        {
+            CHECK( pBody[ j ] == ( uint8_t ) ( first + j ) );
+        }
+    }
+
+    elapsedUs = nowUs() - startUs;
+
+    CHECK( xTlsDisconnect( pNetworkContext ) == TLS_TRANSPORT_SUCCESS );
+    CHECK( pthread_join( pServer->thread, NULL ) == 0 );
+
+    printf( "https: handshake %" PRIu64 " us, %" PRIu32 " ranges of %zu bytes, %.1f KiB/s\n",
+            handshakeUs, requests, rangeSize,
+            ( elapsedUs > 0U ) ? ( ( double ) requests * ( double ) rangeSize * 1e6 / 1024.0 / ( double ) elapsedUs ) : 0.0 );
+    printLatency( "https range request", pLatencyUs, requests );
+
+    free( pBody );
+    free( pLatencyUs );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Once a send has drawn the reset of a peer that has gone away, the next
+ * sends get EPIPE. Without the transport blocking SIGPIPE, that signal would
+ * end the process here. */
+static void checkPeerClosed( NetworkContext_t * pNetworkContext,
+                             BenchServer_t * pServer )
+{
+    static const uint8_t data[ 1024 ] = { 0 };
+    int i;
+
+    serverStart( pServer, BENCH_ROLE_CLOSE );
+    ( void ) clientConnect( pNetworkContext, pServer );
+    CHECK( pthread_join( pServer->thread, NULL ) == 0 );
+
+    /* The first write still succeeds, and draws the reset. */
+    CHECK( espTlsTransportSend( pNetworkContext, data, sizeof( data ) ) == ( int32_t ) sizeof( data ) );
+    ( void ) usleep( 100000 );
+
+    for( i = 0; i < 4; i++ )
+    {
+        CHECK( espTlsTransportSend( pNetworkContext, data, sizeof( data ) ) < 0 );
+    }
+
+    CHECK( xTlsDisconnect( pNetworkContext ) == TLS_TRANSPORT_SUCCESS );
+    printf( "peer closed: sends failed without SIGPIPE\n" );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t publishes = 20000U;
+    uint32_t window = 8U;
+    size_t payloadSize = 256U;
+    uint32_t requests = 200U;
+    size_t rangeSize = 4096U;
+    size_t gatherSize = 1024U;
+    NetworkContext_t networkContext = { 0 };
+    BenchServer_t server = { 0 };
+    int option;
+
+    while( ( option = getopt( argc, argv, "n:w:s:r:b:g:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 'n':
+                publishes = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'w':
+                window = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 's':
+                payloadSize = ( size_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'r':
+                requests = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'b':
+                rangeSize = ( size_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'g':
+                gatherSize = ( size_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                fprintf( stderr, "usage: %s [-n publishes] [-w window] [-s payload] [-r ranges] [-b range bytes] [-g gather bytes]\n", argv[ 0 ] );
+                return 1;
+        }
+    }
+
+    if( ( publishes == 0U ) || ( window == 0U ) || ( window > 65535U ) || ( requests == 0U ) ||
+        ( rangeSize == 0U ) || ( rangeSize >= BENCH_SERVER_BUFFER_SIZE ) ||
+        ( payloadSize > BENCH_SERVER_BUFFER_SIZE - 64U ) )
+    {
+        fprintf( stderr, "invalid options\n" );
+        return 1;
+    }
+
+    serverListen( &server );
+
+    CHECK( xTlsInit( &networkContext ) == TLS_TRANSPORT_SUCCESS );
+    networkContext.ulConnectTimeoutMs = BENCH_RESPONSE_TIMEOUT_MS;
+
+    if( gatherSize > 0U )
+    {
+        networkContext.pucWritevBuffer = malloc( gatherSize );
+        networkContext.xWritevBufferSize = gatherSize;
+        CHECK( networkContext.pucWritevBuffer != NULL );
+    }
+
+    benchBroker( &networkContext, &server, publishes, window, payloadSize );
+    benchHttps( &networkContext, &server, requests, rangeSize );
+    checkPeerClosed( &networkContext, &server );
+
+    vTlsDeinit( &networkContext );
+    free( networkContext.pucWritevBuffer );
+    ( void ) close( server.listenSocket );
+    SSL_CTX_free( server.pSslContext );
+
+    return 0;
+}
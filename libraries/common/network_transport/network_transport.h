@@ -0,0 +1,518 @@
+#ifndef ESP_TLS_TRANSPORT_H
+#define ESP_TLS_TRANSPORT_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "transport_interface.h"
+#include "esp_tls.h"
+
+typedef enum TlsTransportStatus
+{
+    TLS_TRANSPORT_SUCCESS = 0,              /**< Function successfully completed. */
+                                            /**< -1 is reserved for ESP_FAIL */
+    TLS_TRANSPORT_INVALID_PARAMETER = -2,   /**< At least one parameter was invalid. */
+    TLS_TRANSPORT_INSUFFICIENT_MEMORY = -3, /**< Insufficient memory required to establish connection. */
+    TLS_TRANSPORT_INVALID_CREDENTIALS = -4, /**< Provided credentials were invalid. */
+    TLS_TRANSPORT_HANDSHAKE_FAILED = -5,    /**< Performing TLS handshake with server failed. */
+    TLS_TRANSPORT_INTERNAL_ERROR = -6,      /**< A call to a system API resulted in an internal error. */
+    TLS_TRANSPORT_CONNECT_FAILURE = -7,     /**< Initial connection to the server failed. */
+    TLS_TRANSPORT_DISCONNECT_FAILURE = -8,  /**< Failed to disconnect from server. */
+    TLS_TRANSPORT_CONNECT_TIMEOUT = -9,     /**< A connect or handshake deadline expired. */
+    TLS_TRANSPORT_CONNECT_IN_PROGRESS = 1   /**< An asynchronous connect has not finished yet. */
+} TlsTransportStatus_t;
+
+/**
+ * @brief Causes of a failed connect, as counted by #TlsTransportStats_t.
+ */
+typedef enum TlsConnectFailure
+{
+    TLS_CONNECT_FAILURE_DNS = 0,     /**< Host name could not be resolved. */
+    TLS_CONNECT_FAILURE_TCP,         /**< Socket could not be created or connected. */
+    TLS_CONNECT_FAILURE_TIMEOUT,     /**< Connect or handshake deadline expired. */
+    TLS_CONNECT_FAILURE_CREDENTIALS, /**< A certificate or key could not be parsed. */
+    TLS_CONNECT_FAILURE_HANDSHAKE,   /**< TLS handshake failed. */
+    TLS_CONNECT_FAILURE_OTHER,       /**< Out of memory or unclassified error. */
+    TLS_CONNECT_FAILURE_MAX
+} TlsConnectFailure_t;
+
+/**
+ * @brief Transport statistics of one connection.
+ *
+ * Enabled by pointing NetworkContext_t::pxStats at application storage.
+ * Send-side counters are only written with the send mutex held and
+ * receive-side counters with the receive mutex held. Every field is a 32-bit
+ * word, so a snapshot never reads a torn counter, but counters of an
+ * in-flight call may be one step apart. Byte counters wrap at 4 GiB.
+ */
+typedef struct TlsTransportStats
+{
+    uint32_t ulSendCalls;         /**< @brief Calls to #espTlsTransportSend and #espTlsTransportWritev. */
+    uint32_t ulBytesSent;         /**< @brief Bytes accepted by esp-tls for sending. */
+    uint32_t ulSendWantCount;     /**< @brief Sends that returned WANT_READ or WANT_WRITE. */
+    uint32_t ulSendLockWaitUs;    /**< @brief Total time spent waiting for the send mutex. */
+    uint32_t ulSendLockWaitMaxUs; /**< @brief Longest single wait for the send mutex. */
+
+    uint32_t ulRecvCalls;         /**< @brief Calls to #espTlsTransportRecv. */
+    uint32_t ulBytesReceived;     /**< @brief Bytes returned to the caller. */
+    uint32_t ulRecvWantCount;     /**< @brief Receives that returned WANT_READ or WANT_WRITE. */
+    uint32_t ulRecvLockWaitUs;    /**< @brief Total time spent waiting for the receive mutex. */
+    uint32_t ulRecvLockWaitMaxUs; /**< @brief Longest single wait for the receive mutex. */
+
+    uint32_t ulConnects;          /**< @brief Successful connects. */
+    uint32_t ulLastConnectUs;     /**< @brief Duration of the last successful connect and handshake. */
+    uint32_t ulMaxConnectUs;      /**< @brief Longest successful connect and handshake. */
+    uint32_t ulConnectFailures[ TLS_CONNECT_FAILURE_MAX ]; /**< @brief Failed connects by cause. */
+} TlsTransportStats_t;
+
+/**
+ * @brief Completion callback of #xTlsConnectAsync.
+ *
+ * Invoked from #xTlsConnectStep, in the calling task, once the connect has
+ * succeeded, failed or timed out.
+ */
+typedef void ( * TlsConnectCallback_t )( NetworkContext_t * pxNetworkContext,
+                                         TlsTransportStatus_t xStatus,
+                                         void * pvUserData );
+
+/**
+ * @brief State of an asynchronous connect. Owned by the transport.
+ */
+typedef struct TlsAsyncConnect
+{
+    esp_tls_t * pxTls;                /**< @brief Connection being established, NULL when idle. */
+    struct TlsAsyncDns * pxDns;       /**< @brief Host name lookup and its result. */
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t * pxSession; /**< @brief Session taken from the cache for this handshake. */
+#endif
+    TlsConnectCallback_t xCallback;   /**< @brief Completion callback, may be NULL. */
+    void * pvUserData;                /**< @brief Passed back to the callback. */
+    TickType_t xDeadlineTick;         /**< @brief End of the connect phase, or of the handshake once it runs. */
+    bool xDeadlineSet;                /**< @brief False when the handshake has no deadline. */
+    int64_t llStartUs;                /**< @brief Start of the whole connect, for statistics. */
+    bool xHandshakeStarted;           /**< @brief TCP is up and the TLS handshake is running. */
+} TlsAsyncConnect_t;
+
+/**
+ * @brief A TLS credential converted to DER once and shared by any number of
+ * contexts.
+ *
+ * #xTlsCredentialLoad converts a single-object PEM certificate or private key
+ * to DER, so later connects skip strlen() and base64 decoding and esp-tls is
+ * handed the binary object directly. Inputs mbedTLS cannot decode this way
+ * (certificate chains, encrypted keys) are kept as the original PEM string.
+ * A loaded credential is read-only and may be used concurrently.
+ *
+ * Only the encoding is shared. esp-tls takes credentials as buffers, so each
+ * connect still parses the DER into its own mbedtls_x509_crt and
+ * mbedtls_pk_context, and holds them for the life of the session.
+ */
+typedef struct TlsCredential
+{
+    const unsigned char * pucData; /**< @brief Buffer passed to esp-tls, DER or the original PEM. */
+    size_t xLength;                /**< @brief Length of pucData, including the terminator for PEM. */
+    unsigned char * pucDer;        /**< @brief DER copy owned by the credential, NULL when PEM is used. */
+} TlsCredential_t;
+
+/**
+ * @brief Optional read-ahead buffer of a connection.
+ *
+ * coreMQTT reads the fixed header and remaining length a few bytes at a
+ * time. With a buffer set, #espTlsTransportRecv drains up to xSize decrypted
+ * bytes in one esp_tls_conn_read and serves those small reads from memory.
+ * Reads of at least xSize bytes go straight to the caller's buffer.
+ */
+typedef struct TlsReadAhead
+{
+    uint8_t * pucBuffer;  /**< @brief Application-provided storage, NULL to disable read-ahead. */
+    size_t xSize;         /**< @brief Size of pucBuffer in bytes. */
+    size_t xHead;         /**< @brief Offset of the first unread byte. Owned by the transport. */
+    size_t xTail;         /**< @brief End of the buffered data. Owned by the transport. */
+    size_t xBorrowed;     /**< @brief Bytes lent out by #espTlsTransportRecvBorrow. Owned by the transport. */
+    uint32_t ulRecvCalls; /**< @brief Calls to #espTlsTransportRecv that reached the connection. */
+    uint32_t ulTlsReads;  /**< @brief esp_tls_conn_read calls those needed. */
+} TlsReadAhead_t;
+
+/**
+ * @brief TLS session cache kept across reconnects of one NetworkContext_t.
+ *
+ * After a successful handshake the session is saved, and the next
+ * #xTlsConnect to the same host and port offers it to the server so the
+ * connection can be resumed without a full handshake. Resumption needs
+ * CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS; without it only the counters are kept.
+ */
+typedef struct TlsSessionCache
+{
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t * pxSession; /**< @brief Session saved from the last successful handshake. */
+#endif
+    uint32_t ulPeerHash;                  /**< @brief Hash of the host name and port the session belongs to. */
+    uint32_t ulHits;                      /**< @brief Connects that offered a cached session. */
+    uint32_t ulMisses;                    /**< @brief Connects that had no cached session for the peer. */
+} TlsSessionCache_t;
+
+/**
+ * @brief Traffic class of a connection, used by a shared #TlsShaper_t.
+ */
+typedef enum TlsTrafficPriority
+{
+    TLS_TRAFFIC_BULK = 0, /**< Waits for tokens, and leaves the reserve to control traffic. */
+    TLS_TRAFFIC_CONTROL   /**< Never waits; its bytes are charged to the bucket afterwards. */
+} TlsTrafficPriority_t;
+
+/**
+ * @brief Counters of a #TlsShaper_t.
+ */
+typedef struct TlsShaperStats
+{
+    uint32_t ulBulkBytes;    /**< @brief Bytes sent or received by bulk connections. */
+    uint32_t ulControlBytes; /**< @brief Bytes sent or received by control connections. */
+    uint32_t ulBulkDelays;   /**< @brief Times a bulk send or receive had to wait for tokens. */
+    uint32_t ulBulkDelayMs;  /**< @brief Total time bulk connections spent waiting. */
+} TlsShaperStats_t;
+
+/**
+ * @brief Token-bucket bandwidth shaper shared by any number of contexts.
+ *
+ * Every byte sent or received by a context that points at the shaper costs
+ * one token, and tokens are refilled at ulRateBytesPerSec up to ulBurstBytes.
+ * A bulk context waits before sending or receiving until the bucket holds
+ * more than ulReserveBytes, and a receive is shortened to the available
+ * budget. A control context never waits, so MQTT keep-alives and acks are not
+ * held behind an OTA download. What control traffic uses is taken out of
+ * the next bulk transfer instead.
+ *
+ * Receive shaping works by not reading from the socket, so the server is slowed
+ * down by TCP flow control. Initialise with #xTlsShaperInit.
+ */
+typedef struct TlsShaper
+{
+    SemaphoreHandle_t xMutex;   /**< @brief Guards the bucket. Owned by the shaper. */
+    uint32_t ulRateBytesPerSec; /**< @brief Refill rate. */
+    uint32_t ulBurstBytes;      /**< @brief Bucket capacity. */
+    uint32_t ulReserveBytes;    /**< @brief Tokens bulk traffic may not use. */
+    int32_t lTokens;            /**< @brief Current budget, negative after control traffic overdraws it. */
+    int64_t llLastRefillUs;     /**< @brief Time up to which tokens have been added. */
+    TlsShaperStats_t xStats;    /**< @brief Counters, read with #vTlsShaperSnapshot. */
+} TlsShaper_t;
+
+/** @brief Number of resolved addresses kept per context. */
+#define TLS_ADDRESS_CACHE_SIZE    ( 4U )
+
+/** @brief Room for the longest textual IPv6 address and its terminator. */
+#define TLS_ADDRESS_MAX_LEN       ( 46U )
+
+/**
+ * @brief Addresses of NetworkContext_t::pcHostname resolved by an earlier
+ * connect. Owned by the transport.
+ *
+ * The address that last connected is kept first. The cache is dropped when
+ * it expires, when the host name changes, or when none of its addresses
+ * accepts a connection.
+ */
+typedef struct TlsAddressCache
+{
+    char acAddresses[ TLS_ADDRESS_CACHE_SIZE ][ TLS_ADDRESS_MAX_LEN ]; /**< @brief Numeric addresses, IPv6 and IPv4 interleaved. */
+    uint8_t ucCount;          /**< @brief Valid entries in acAddresses. */
+    uint32_t ulHostHash;      /**< @brief Hash of the host name the addresses belong to. */
+    TickType_t xResolvedTick; /**< @brief When the addresses were resolved. */
+    uint32_t ulHits;          /**< @brief Connects that used cached addresses. */
+    uint32_t ulMisses;        /**< @brief Connects that had to resolve the host name. */
+} TlsAddressCache_t;
+
+struct NetworkContext
+{
+    SemaphoreHandle_t xTlsContextSemaphore;
+
+    /**
+    * @brief Optional mutexes guarding the send and receive paths separately.
+    *
+    * When both are set, a task blocked waiting for data does not hold up
+    * writes from other tasks. #xTlsRecvSemaphore keeps receivers apart, and
+    * #xTlsSendSemaphore guards the TLS session itself: it is held for every
+    * write and, briefly, for every read, since mbedTLS reads can write alerts
+    * and renegotiate. This keeps the mode safe with
+    * CONFIG_MBEDTLS_DYNAMIC_BUFFER and CONFIG_MBEDTLS_SSL_RENEGOTIATION, which
+    * the examples enable. A receiver waits for the socket to become readable
+    * without it. #xTlsContextSemaphore is then only taken by #xTlsConnect and
+    * #xTlsDisconnect, which take both mutexes as well, in the order context,
+    * receive, send, to wait for in-flight I/O.
+    *
+    * Leave both NULL to serialise every call on #xTlsContextSemaphore.
+    *
+    * @note Once a TLS record starts to arrive, its read holds
+    * #xTlsSendSemaphore until the whole record is in, so a sender can still
+    * wait for up to the receive timeout behind a record cut short by the
+    * network. Data already buffered by mbedTLS is read without waiting.
+    */
+    SemaphoreHandle_t xTlsSendSemaphore;
+    SemaphoreHandle_t xTlsRecvSemaphore;
+
+    esp_tls_t* pxTls;
+    const char *pcHostname;          /**< @brief Server host name. */
+    int xPort;                       /**< @brief Server port in host-order. */
+    const char *pcServerRootCAPem;   /**< @brief String representing a trusted server root certificate. */
+    const char *pcClientCertPem;     /**< @brief String representing the client certificate. */
+    const char *pcClientKeyPem;      /**< @brief String representing the client certificate's private key. */
+
+    /**
+    * @brief Optional pre-loaded credentials. When set they are used instead
+    * of the matching PEM string above. They must outlive the connection.
+    */
+    const TlsCredential_t *pxServerRootCA;
+    const TlsCredential_t *pxClientCert;
+    const TlsCredential_t *pxClientKey;
+
+    bool use_secure_element;         /**< @brief Boolean representing the use of secure element
+                                                 for the TLS connection. */
+    void *ds_data;                   /**< @brief Pointer for digital signature peripheral context */
+
+    /**
+    * @brief To use ALPN, set this to a NULL-terminated list of supported
+    * protocols in decreasing order of preference.
+    *
+    * See [this link]
+    * (https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/)
+    * for more information.
+    */
+    const char ** pAlpnProtos;
+
+    /**
+    * @brief Disable server name indication (SNI) for a TLS session.
+    */
+    BaseType_t disableSni;
+
+    /**
+    * @brief Optional scratch buffer used by #espTlsTransportWritev.
+    *
+    * Vectors whose total length fits in the buffer are copied into it and sent
+    * as a single TLS record. Larger writes, or a NULL buffer, fall back to one
+    * write per vector. Only accessed with the send mutex held.
+    */
+    uint8_t * pucWritevBuffer;
+    size_t xWritevBufferSize;
+
+    /**
+    * @brief Session resumption state. Zero-initialise it together with the
+    * rest of the context and release it with #vTlsSessionCacheClear.
+    */
+    TlsSessionCache_t xSessionCache;
+
+    /**
+    * @brief Deadline for the TCP connect, in milliseconds, including the host
+    * name lookup of #xTlsConnectAsync. It is also the socket send and receive
+    * timeout once connected. 0 selects 1000 ms.
+    */
+    uint32_t ulConnectTimeoutMs;
+
+    /**
+    * @brief Deadline for the TLS handshake of #xTlsConnectAsync, in
+    * milliseconds, counted from the moment TCP is connected. 0 disables it.
+    */
+    uint32_t ulHandshakeTimeoutMs;
+
+    TlsReadAhead_t xReadAhead;
+
+    TlsAsyncConnect_t xAsyncConnect;
+
+    /**
+    * @brief Optional statistics block, NULL to disable collection.
+    */
+    TlsTransportStats_t * pxStats;
+
+    /**
+    * @brief Optional bandwidth shaper shared with other contexts, NULL to
+    * send and receive unthrottled.
+    */
+    TlsShaper_t * pxShaper;
+    TlsTrafficPriority_t xTrafficPriority; /**< @brief Class of this connection within pxShaper. */
+
+    /**
+    * @brief Maximum age of the resolved addresses kept in xAddressCache, in
+    * milliseconds. 0 disables the cache and lets esp-tls resolve the host
+    * name on every connect.
+    */
+    uint32_t ulAddressCacheTtlMs;
+    TlsAddressCache_t xAddressCache;
+
+    /**
+    * @brief Race connection attempts across the resolved addresses and the
+    * primary and alternate ports, keeping the first to complete its
+    * handshake. Attempts start ulRaceStaggerMs apart (0 selects 250 ms), or
+    * immediately when all earlier attempts have failed.
+    */
+    bool xRaceEndpoints;
+    uint32_t ulRaceStaggerMs;
+
+    /**
+    * @brief Optional second endpoint of the same host, e.g. 443 with ALPN
+    * next to 8883. Only used when xRaceEndpoints is set; 0 disables it.
+    */
+    int xAlternatePort;
+    const char **pAlternateAlpnProtos;
+};
+
+TlsTransportStatus_t xTlsConnect(NetworkContext_t* pxNetworkContext );
+
+/**
+ * @brief Start connecting without blocking the calling task.
+ *
+ * Performs the first step of the connect and returns. The caller then calls
+ * #xTlsConnectStep until it stops returning #TLS_TRANSPORT_CONNECT_IN_PROGRESS,
+ * so one task can bring up several connections in parallel.
+ *
+ * The host name is resolved by the lwIP DNS client in the background, and each
+ * step waits at most a tick for the socket, so a step never blocks for the
+ * connect timeout. The connection locks are only taken at the start and once
+ * the connect has finished. On success the socket is left blocking, with
+ * NetworkContext_t::ulConnectTimeoutMs as send and receive timeout, exactly
+ * as after #xTlsConnect.
+ *
+ * @param[in] pxNetworkContext The network context to connect.
+ * @param[in] xCallback Optional callback invoked on completion.
+ * @param[in] pvUserData Passed to @p xCallback.
+ *
+ * @return #TLS_TRANSPORT_CONNECT_IN_PROGRESS, or the final status if the
+ * connect finished in the first step.
+ */
+TlsTransportStatus_t xTlsConnectAsync( NetworkContext_t* pxNetworkContext,
+                                       TlsConnectCallback_t xCallback,
+                                       void* pvUserData );
+
+/**
+ * @brief Advance a connect started with #xTlsConnectAsync.
+ *
+ * @return #TLS_TRANSPORT_CONNECT_IN_PROGRESS while the connect is pending,
+ * #TLS_TRANSPORT_SUCCESS once it is usable, or an error status. The
+ * completion callback runs before the final status is returned.
+ */
+TlsTransportStatus_t xTlsConnectStep( NetworkContext_t* pxNetworkContext );
+
+TlsTransportStatus_t xTlsDisconnect( NetworkContext_t* pxNetworkContext );
+
+/**
+ * @brief Copy the statistics of a context. Cheap enough to poll; a context
+ * without statistics yields all zeroes.
+ */
+void vTlsTransportStatsSnapshot( const NetworkContext_t* pxNetworkContext,
+                                 TlsTransportStats_t* pxSnapshot );
+
+/**
+ * @brief Zero the statistics of a context. Increments made by a concurrent
+ * send or receive may be lost.
+ */
+void vTlsTransportStatsReset( NetworkContext_t* pxNetworkContext );
+
+/**
+ * @brief Initialise a shaper with a full bucket.
+ *
+ * @param[in] ulRateBytesPerSec Sustained rate shared by all attached contexts,
+ * in both directions together. Must not be 0.
+ * @param[in] ulBurstBytes Bucket capacity. Must be larger than @p ulReserveBytes.
+ * @param[in] ulReserveBytes Headroom kept for control traffic.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INVALID_PARAMETER or
+ * #TLS_TRANSPORT_INSUFFICIENT_MEMORY.
+ */
+TlsTransportStatus_t xTlsShaperInit( TlsShaper_t* pxShaper,
+                                     uint32_t ulRateBytesPerSec,
+                                     uint32_t ulBurstBytes,
+                                     uint32_t ulReserveBytes );
+
+/**
+ * @brief Change the rate of a shaper at run time, e.g. once the link quality
+ * is known.
+ */
+void vTlsShaperSetRate( TlsShaper_t* pxShaper,
+                        uint32_t ulRateBytesPerSec );
+
+/**
+ * @brief Copy the counters of a shaper.
+ */
+void vTlsShaperSnapshot( TlsShaper_t* pxShaper,
+                         TlsShaperStats_t* pxSnapshot );
+
+/**
+ * @brief Free the resources of a shaper. No context may still point at it.
+ */
+void vTlsShaperDelete( TlsShaper_t* pxShaper );
+
+/**
+ * @brief Load a PEM certificate or private key into a shareable credential.
+ *
+ * @param[out] pxCredential The credential to initialise.
+ * @param[in] pcPem NUL-terminated PEM string. It must stay valid for the
+ * lifetime of the credential, since it is used as is when it cannot be
+ * converted.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INVALID_PARAMETER or
+ * #TLS_TRANSPORT_INSUFFICIENT_MEMORY.
+ */
+TlsTransportStatus_t xTlsCredentialLoad( TlsCredential_t* pxCredential,
+                                         const char* pcPem );
+
+/**
+ * @brief Release the memory held by a credential. No context may still be
+ * using it.
+ */
+void vTlsCredentialFree( TlsCredential_t* pxCredential );
+
+/**
+ * @brief Drop the TLS session saved in the context so the next connect does
+ * a full handshake. Also frees the memory held by the saved session.
+ */
+void vTlsSessionCacheClear( NetworkContext_t* pxNetworkContext );
+
+int32_t espTlsTransportSend( NetworkContext_t* pxNetworkContext,
+    const void* pvData, size_t uxDataLen );
+
+int32_t espTlsTransportRecv( NetworkContext_t* pxNetworkContext,
+    void* pvData, size_t uxDataLen );
+
+/**
+ * @brief Receive without copying, by borrowing the read-ahead buffer.
+ *
+ * Sets @p ppucData to up to @p uxMaxLen decrypted bytes inside
+ * NetworkContext_t::xReadAhead, refilling it with one esp_tls_conn_read when
+ * it is empty. A consumer can then parse or store the data in place instead
+ * of having it copied into its own buffer first. Requires a read-ahead buffer.
+ *
+ * After a positive return the data belongs to the caller until
+ * #espTlsTransportRecvRelease, which must be called promptly and from the
+ * same task, with no #espTlsTransportRecv in between.
+ *
+ * @warning In full duplex mode the receive mutex stays taken until the
+ * release, so other receivers and #xTlsDisconnect wait for it. In half duplex
+ * mode the shared #xTlsContextSemaphore is given back right away, so sends
+ * such as MQTT pings and acks are never held up by a borrow. Other receives
+ * then return 0 until the release, and a disconnect cancels the borrow: the
+ * bytes stay readable, but only until the next receive after a reconnect.
+ *
+ * @return Number of bytes borrowed, 0 if no data is available yet (nothing to
+ * release), or a negative value on error or when the connection was closed.
+ */
+int32_t espTlsTransportRecvBorrow( NetworkContext_t* pxNetworkContext,
+    const uint8_t** ppucData, size_t uxMaxLen );
+
+/**
+ * @brief Return a buffer obtained with #espTlsTransportRecvBorrow.
+ *
+ * @param[in] uxConsumed Number of borrowed bytes the caller used. Any
+ * remainder is returned by the next receive.
+ */
+void espTlsTransportRecvRelease( NetworkContext_t* pxNetworkContext,
+    size_t uxConsumed );
+
+/**
+ * @brief Send an array of buffers over the TLS connection.
+ *
+ * Implements #TransportWritev_t. The vectors are gathered into
+ * NetworkContext_t::pucWritevBuffer when they fit, so a small MQTT packet
+ * costs one TLS record instead of one per vector.
+ *
+ * @return Number of bytes sent, which may be less than the total length of
+ * the vectors, or a negative value on error.
+ */
+int32_t espTlsTransportWritev( NetworkContext_t* pxNetworkContext,
+    TransportOutVector_t* pxIoVec, size_t uxIoVecCount );
+
+#endif /* ESP_TLS_TRANSPORT_H */
\ No newline at end of file
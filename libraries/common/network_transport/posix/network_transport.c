@@ -0,0 +1,642 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include "network_transport.h"
+
+#define TAG "network_transport"
+#define LOGE( fmt, ... )    fprintf( stderr, "E " TAG ": " fmt "\n", ## __VA_ARGS__ )
+
+#define DEFAULT_CONNECT_TIMEOUT_MS (1000U)
+
+static uint32_t prvTimeoutMs( const NetworkContext_t* pxNetworkContext )
+{
+    return pxNetworkContext->ulConnectTimeoutMs != 0 ? pxNetworkContext->ulConnectTimeoutMs :
+                                                      DEFAULT_CONNECT_TIMEOUT_MS;
+}
+
+/* Connect a non-blocking socket, waiting at most ulTimeoutMs. */
+static TlsTransportStatus_t prvConnectWithTimeout( int xSocket,
+                                                   const struct addrinfo* pxAddr,
+                                                   uint32_t ulTimeoutMs )
+{
+    int lFlags = fcntl(xSocket, F_GETFL, 0);
+
+    if (lFlags < 0 || fcntl(xSocket, F_SETFL, lFlags | O_NONBLOCK) < 0)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    if (connect(xSocket, pxAddr->ai_addr, pxAddr->ai_addrlen) < 0)
+    {
+        if (errno != EINPROGRESS)
+        {
+            return TLS_TRANSPORT_CONNECT_FAILURE;
+        }
+
+        struct pollfd xPoll = { .fd = xSocket, .events = POLLOUT };
+        int lError = 0;
+        socklen_t xLen = sizeof(lError);
+        int lReady = poll(&xPoll, 1, (int) ulTimeoutMs);
+
+        if (lReady == 0)
+        {
+            return TLS_TRANSPORT_CONNECT_TIMEOUT;
+        }
+
+        if (lReady < 0 ||
+            getsockopt(xSocket, SOL_SOCKET, SO_ERROR, &lError, &xLen) < 0 ||
+            lError != 0)
+        {
+            return TLS_TRANSPORT_CONNECT_FAILURE;
+        }
+    }
+
+    /* Back to blocking, bounded by the receive and send timeouts. */
+    if (fcntl(xSocket, F_SETFL, lFlags) < 0)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    return TLS_TRANSPORT_SUCCESS;
+}
+
+static TlsTransportStatus_t prvOpenSocket( NetworkContext_t* pxNetworkContext )
+{
+    struct addrinfo xHints = { 0 };
+    struct addrinfo* pxList = NULL;
+    char cPort[ 8 ];
+    uint32_t ulTimeoutMs = prvTimeoutMs(pxNetworkContext);
+    TlsTransportStatus_t xRet = TLS_TRANSPORT_CONNECT_FAILURE;
+
+    xHints.ai_family = AF_UNSPEC;
+    xHints.ai_socktype = SOCK_STREAM;
+    xHints.ai_protocol = IPPROTO_TCP;
+    snprintf(cPort, sizeof(cPort), "%d", pxNetworkContext->xPort);
+
+    int lGaiRet = getaddrinfo(pxNetworkContext->pcHostname, cPort, &xHints, &pxList);
+
+    if (lGaiRet != 0)
+    {
+        LOGE("Failed to resolve %s: %s", pxNetworkContext->pcHostname, gai_strerror(lGaiRet));
+        return TLS_TRANSPORT_CONNECT_FAILURE;
+    }
+
+    for (struct addrinfo* pxAddr = pxList; pxAddr != NULL; pxAddr = pxAddr->ai_next)
+    {
+        int xSocket = socket(pxAddr->ai_family, pxAddr->ai_socktype, pxAddr->ai_protocol);
+
+        if (xSocket < 0)
+        {
+            continue;
+        }
+
+        xRet = prvConnectWithTimeout(xSocket, pxAddr, ulTimeoutMs);
+
+        if (xRet == TLS_TRANSPORT_SUCCESS)
+        {
+            struct timeval xTimeout = {
+                .tv_sec = ulTimeoutMs / 1000U,
+                .tv_usec = (ulTimeoutMs % 1000U) * 1000U
+            };
+            int lNoDelay = 1;
+
+            setsockopt(xSocket, SOL_SOCKET, SO_RCVTIMEO, &xTimeout, sizeof(xTimeout));
+            setsockopt(xSocket, SOL_SOCKET, SO_SNDTIMEO, &xTimeout, sizeof(xTimeout));
+            setsockopt(xSocket, IPPROTO_TCP, TCP_NODELAY, &lNoDelay, sizeof(lNoDelay));
+            pxNetworkContext->xSocket = xSocket;
+            break;
+        }
+
+        close(xSocket);
+    }
+
+    freeaddrinfo(pxList);
+
+    if (xRet != TLS_TRANSPORT_SUCCESS)
+    {
+        LOGE("Failed to connect to %s:%d", pxNetworkContext->pcHostname, pxNetworkContext->xPort);
+    }
+
+    return xRet;
+}
+
+/* Add every certificate of a PEM bundle to the trust store. */
+static bool prvLoadRootCa( SSL_CTX* pxSslContext, const char* pcPem )
+{
+    BIO* pxBio = BIO_new_mem_buf(pcPem, -1);
+    X509_STORE* pxStore = SSL_CTX_get_cert_store(pxSslContext);
+    X509* pxCert;
+    int lCount = 0;
+
+    if (pxBio == NULL)
+    {
+        return false;
+    }
+
+    while ((pxCert = PEM_read_bio_X509(pxBio, NULL, NULL, NULL)) != NULL)
+    {
+        if (X509_STORE_add_cert(pxStore, pxCert) == 1)
+        {
+            lCount++;
+        }
+        X509_free(pxCert);
+    }
+
+    /* The loop ends on a "no start line" error once the bundle is exhausted. */
+    ERR_clear_error();
+    BIO_free(pxBio);
+
+    return lCount > 0;
+}
+
+static bool prvLoadClientCredentials( SSL_CTX* pxSslContext,
+                                      const char* pcCertPem,
+                                      const char* pcKeyPem )
+{
+    bool xOk = false;
+    BIO* pxCertBio = BIO_new_mem_buf(pcCertPem, -1);
+    BIO* pxKeyBio = BIO_new_mem_buf(pcKeyPem, -1);
+    X509* pxCert = NULL;
+    EVP_PKEY* pxKey = NULL;
+
+    if (pxCertBio != NULL && pxKeyBio != NULL)
+    {
+        pxCert = PEM_read_bio_X509(pxCertBio, NULL, NULL, NULL);
+        pxKey = PEM_read_bio_PrivateKey(pxKeyBio, NULL, NULL, NULL);
+        xOk = pxCert != NULL && pxKey != NULL &&
+              SSL_CTX_use_certificate(pxSslContext, pxCert) == 1 &&
+              SSL_CTX_use_PrivateKey(pxSslContext, pxKey) == 1 &&
+              SSL_CTX_check_private_key(pxSslContext) == 1;
+    }
+
+    X509_free(pxCert);
+    EVP_PKEY_free(pxKey);
+    BIO_free(pxCertBio);
+    BIO_free(pxKeyBio);
+
+    return xOk;
+}
+
+/* Convert the NULL-terminated ALPN list to the length-prefixed wire format. */
+static bool prvSetAlpn( SSL_CTX* pxSslContext, const char** pAlpnProtos )
+{
+    unsigned char ucWire[ 256 ];
+    size_t xLen = 0;
+
+    for (const char** ppcProto = pAlpnProtos; *ppcProto != NULL; ppcProto++)
+    {
+        size_t xProtoLen = strlen(*ppcProto);
+
+        if (xProtoLen == 0 || xProtoLen > 255 || xLen + 1 + xProtoLen > sizeof(ucWire))
+        {
+            return false;
+        }
+
+        ucWire[ xLen++ ] = (unsigned char) xProtoLen;
+        memcpy(&ucWire[ xLen ], *ppcProto, xProtoLen);
+        xLen += xProtoLen;
+    }
+
+    /* Unlike most of OpenSSL, this returns 0 on success. */
+    return SSL_CTX_set_alpn_protos(pxSslContext, ucWire, (unsigned int) xLen) == 0;
+}
+
+static TlsTransportStatus_t prvCreateSslContext( NetworkContext_t* pxNetworkContext )
+{
+    SSL_CTX* pxSslContext = SSL_CTX_new(TLS_client_method());
+
+    if (pxSslContext == NULL)
+    {
+        return TLS_TRANSPORT_INSUFFICIENT_MEMORY;
+    }
+
+    pxNetworkContext->pxSslContext = pxSslContext;
+    SSL_CTX_set_min_proto_version(pxSslContext, TLS1_2_VERSION);
+    SSL_CTX_set_mode(pxSslContext, SSL_MODE_AUTO_RETRY);
+
+    if (pxNetworkContext->pcServerRootCAPem != NULL)
+    {
+        if (!prvLoadRootCa(pxSslContext, pxNetworkContext->pcServerRootCAPem))
+        {
+            LOGE("Failed to parse the server root CA");
+            return TLS_TRANSPORT_INVALID_CREDENTIALS;
+        }
+        SSL_CTX_set_verify(pxSslContext, SSL_VERIFY_PEER, NULL);
+    }
+
+    if (pxNetworkContext->pcClientCertPem != NULL && pxNetworkContext->pcClientKeyPem != NULL)
+    {
+        if (!prvLoadClientCredentials(pxSslContext,
+                                      pxNetworkContext->pcClientCertPem,
+                                      pxNetworkContext->pcClientKeyPem))
+        {
+            LOGE("Failed to load the client certificate or key");
+            return TLS_TRANSPORT_INVALID_CREDENTIALS;
+        }
+    }
+
+    if (pxNetworkContext->pAlpnProtos != NULL &&
+        !prvSetAlpn(pxSslContext, pxNetworkContext->pAlpnProtos))
+    {
+        LOGE("Invalid ALPN protocol list");
+        return TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+
+    return TLS_TRANSPORT_SUCCESS;
+}
+
+static TlsTransportStatus_t prvHandshake( NetworkContext_t* pxNetworkContext )
+{
+    SSL* pxSsl = SSL_new(pxNetworkContext->pxSslContext);
+
+    if (pxSsl == NULL)
+    {
+        return TLS_TRANSPORT_INSUFFICIENT_MEMORY;
+    }
+
+    pxNetworkContext->pxSsl = pxSsl;
+
+    if (SSL_set_fd(pxSsl, pxNetworkContext->xSocket) != 1)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    if (!pxNetworkContext->disableSni &&
+        SSL_set_tlsext_host_name(pxSsl, pxNetworkContext->pcHostname) != 1)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    /* As esp-tls does, check the server name whenever the peer is verified. */
+    if (pxNetworkContext->pcServerRootCAPem != NULL &&
+        SSL_set1_host(pxSsl, pxNetworkContext->pcHostname) != 1)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    if (SSL_connect(pxSsl) != 1)
+    {
+        long lVerify = SSL_get_verify_result(pxSsl);
+
+        LOGE("TLS handshake with %s failed: %s", pxNetworkContext->pcHostname,
+             lVerify != X509_V_OK ? X509_verify_cert_error_string(lVerify) :
+                                    ERR_reason_error_string(ERR_peek_last_error()));
+        ERR_clear_error();
+        return TLS_TRANSPORT_HANDSHAKE_FAILED;
+    }
+
+    return TLS_TRANSPORT_SUCCESS;
+}
+
+/* OpenSSL writes to the socket with write(), which raises SIGPIPE once the
+ * peer has gone away, and that ends the process unless it is handled.
+ * Every OpenSSL call that may write runs with the mutex held, so taking the
+ * mutex also blocks SIGPIPE in the calling thread, and releasing it
+ * discards one raised meanwhile. The write then just fails with EPIPE. */
+static void prvLock( NetworkContext_t* pxNetworkContext, sigset_t* pxOldMask )
+{
+    sigset_t xPipe;
+
+    pthread_mutex_lock(&pxNetworkContext->xTlsMutex);
+    sigemptyset(&xPipe);
+    sigaddset(&xPipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &xPipe, pxOldMask);
+}
+
+static void prvUnlock( NetworkContext_t* pxNetworkContext, const sigset_t* pxOldMask )
+{
+    sigset_t xPipe;
+    sigset_t xPending;
+
+    sigemptyset(&xPipe);
+    sigaddset(&xPipe, SIGPIPE);
+
+    /* A SIGPIPE the caller had blocked already is theirs to handle. */
+    if (!sigismember(pxOldMask, SIGPIPE) &&
+        sigpending(&xPending) == 0 && sigismember(&xPending, SIGPIPE))
+    {
+        struct timespec xNoWait = { 0 };
+
+        (void) sigtimedwait(&xPipe, NULL, &xNoWait);
+    }
+
+    pthread_sigmask(SIG_SETMASK, pxOldMask, NULL);
+    pthread_mutex_unlock(&pxNetworkContext->xTlsMutex);
+}
+
+/* Free whatever part of the connection exists. Called with the mutex held. */
+static void prvCloseLocked( NetworkContext_t* pxNetworkContext, bool xNotifyPeer )
+{
+    if (pxNetworkContext->pxSsl != NULL)
+    {
+        if (xNotifyPeer)
+        {
+            (void) SSL_shutdown(pxNetworkContext->pxSsl);
+        }
+        SSL_free(pxNetworkContext->pxSsl);
+        pxNetworkContext->pxSsl = NULL;
+    }
+
+    if (pxNetworkContext->pxSslContext != NULL)
+    {
+        SSL_CTX_free(pxNetworkContext->pxSslContext);
+        pxNetworkContext->pxSslContext = NULL;
+    }
+
+    if (pxNetworkContext->xSocket >= 0)
+    {
+        close(pxNetworkContext->xSocket);
+    }
+    pxNetworkContext->xSocket = -1;
+    ERR_clear_error();
+}
+
+/* Map an OpenSSL I/O result to the transport interface convention: bytes
+ * transferred, 0 when the call should be retried, negative on error. */
+static int32_t prvIoResult( SSL* pxSsl, int lRet )
+{
+    if (lRet > 0)
+    {
+        return lRet;
+    }
+
+    switch (SSL_get_error(pxSsl, lRet))
+    {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return 0;
+
+        case SSL_ERROR_SYSCALL:
+            /* A socket timeout surfaces here on some OpenSSL versions. */
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                ERR_clear_error();
+                return 0;
+            }
+            /* fall through */
+
+        default:
+            ERR_clear_error();
+            return -1;
+    }
+}
+
+TlsTransportStatus_t xTlsInit( NetworkContext_t* pxNetworkContext )
+{
+    if (pxNetworkContext == NULL || pxNetworkContext->xTlsMutexInitialised)
+    {
+        return TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+
+    if (pthread_mutex_init(&pxNetworkContext->xTlsMutex, NULL) != 0)
+    {
+        return TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    pxNetworkContext->xSocket = -1;
+    pxNetworkContext->pxSslContext = NULL;
+    pxNetworkContext->pxSsl = NULL;
+    pxNetworkContext->xTlsMutexInitialised = true;
+
+    return TLS_TRANSPORT_SUCCESS;
+}
+
+void vTlsDeinit( NetworkContext_t* pxNetworkContext )
+{
+    if (pxNetworkContext == NULL || !pxNetworkContext->xTlsMutexInitialised)
+    {
+        return;
+    }
+
+    sigset_t xOldMask;
+
+    prvLock(pxNetworkContext, &xOldMask);
+    prvCloseLocked(pxNetworkContext, true);
+    prvUnlock(pxNetworkContext, &xOldMask);
+    pthread_mutex_destroy(&pxNetworkContext->xTlsMutex);
+    pxNetworkContext->xTlsMutexInitialised = false;
+}
+
+TlsTransportStatus_t xTlsConnect(NetworkContext_t* pxNetworkContext )
+{
+    if (pxNetworkContext == NULL || pxNetworkContext->pcHostname == NULL ||
+        !pxNetworkContext->xTlsMutexInitialised)
+    {
+        return TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+
+    sigset_t xOldMask;
+
+    prvLock(pxNetworkContext, &xOldMask);
+
+    /* Drop a previous connection that was never closed. */
+    prvCloseLocked(pxNetworkContext, false);
+
+    TlsTransportStatus_t xRet = prvCreateSslContext(pxNetworkContext);
+
+    if (xRet == TLS_TRANSPORT_SUCCESS)
+    {
+        xRet = prvOpenSocket(pxNetworkContext);
+    }
+
+    if (xRet == TLS_TRANSPORT_SUCCESS)
+    {
+        xRet = prvHandshake(pxNetworkContext);
+    }
+
+    if (xRet != TLS_TRANSPORT_SUCCESS)
+    {
+        prvCloseLocked(pxNetworkContext, false);
+    }
+
+    prvUnlock(pxNetworkContext, &xOldMask);
+
+    return xRet;
+}
+
+TlsTransportStatus_t xTlsDisconnect( NetworkContext_t* pxNetworkContext )
+{
+    if (pxNetworkContext == NULL || !pxNetworkContext->xTlsMutexInitialised)
+    {
+        return TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+
+    sigset_t xOldMask;
+
+    prvLock(pxNetworkContext, &xOldMask);
+    prvCloseLocked(pxNetworkContext, true);
+    prvUnlock(pxNetworkContext, &xOldMask);
+
+    return TLS_TRANSPORT_SUCCESS;
+}
+
+int32_t espTlsTransportSend(NetworkContext_t* pxNetworkContext,
+    const void* pvData, size_t uxDataLen)
+{
+    if (pvData == NULL || uxDataLen == 0)
+    {
+        return -1;
+    }
+
+    int32_t lBytesSent = -1;
+
+    if (pxNetworkContext != NULL && pxNetworkContext->xTlsMutexInitialised)
+    {
+        sigset_t xOldMask;
+
+        prvLock(pxNetworkContext, &xOldMask);
+        /* The connection may have been closed while waiting for the mutex. */
+        if (pxNetworkContext->pxSsl != NULL)
+        {
+            int lLen = uxDataLen > INT32_MAX ? INT32_MAX : (int) uxDataLen;
+
+            lBytesSent = prvIoResult(pxNetworkContext->pxSsl,
+                                     SSL_write(pxNetworkContext->pxSsl, pvData, lLen));
+        }
+        prvUnlock(pxNetworkContext, &xOldMask);
+    }
+
+    return lBytesSent;
+}
+
+int32_t espTlsTransportWritev(NetworkContext_t* pxNetworkContext,
+    TransportOutVector_t* pxIoVec, size_t uxIoVecCount)
+{
+    if (pxIoVec == NULL || uxIoVecCount == 0)
+    {
+        return -1;
+    }
+
+    if (pxNetworkContext == NULL || !pxNetworkContext->xTlsMutexInitialised)
+    {
+        return -1;
+    }
+
+    size_t uxTotalLen = 0;
+    size_t i;
+
+    for (i = 0; i < uxIoVecCount; i++)
+    {
+        if (pxIoVec[i].iov_base == NULL && pxIoVec[i].iov_len != 0)
+        {
+            return -1;
+        }
+        uxTotalLen += pxIoVec[i].iov_len;
+    }
+
+    if (uxTotalLen == 0 || uxTotalLen > INT32_MAX)
+    {
+        return -1;
+    }
+
+    int32_t lBytesSent = 0;
+    sigset_t xOldMask;
+
+    prvLock(pxNetworkContext, &xOldMask);
+
+    if (pxNetworkContext->pxSsl == NULL)
+    {
+        lBytesSent = -1;
+    }
+    else if (pxNetworkContext->pucWritevBuffer != NULL &&
+             uxTotalLen <= pxNetworkContext->xWritevBufferSize)
+    {
+        /* Gather everything into one record. */
+        uint8_t* pucCursor = pxNetworkContext->pucWritevBuffer;
+
+        for (i = 0; i < uxIoVecCount; i++)
+        {
+            if (pxIoVec[i].iov_len > 0)
+            {
+                memcpy(pucCursor, pxIoVec[i].iov_base, pxIoVec[i].iov_len);
+                pucCursor += pxIoVec[i].iov_len;
+            }
+        }
+
+        lBytesSent = prvIoResult(pxNetworkContext->pxSsl,
+                                 SSL_write(pxNetworkContext->pxSsl,
+                                           pxNetworkContext->pucWritevBuffer,
+                                           (int) uxTotalLen));
+    }
+    else
+    {
+        /* Write the vectors one by one, stopping at the first short write so
+         * the caller can resume from the right offset. */
+        for (i = 0; i < uxIoVecCount; i++)
+        {
+            if (pxIoVec[i].iov_len == 0)
+            {
+                continue;
+            }
+
+            int32_t lRet = prvIoResult(pxNetworkContext->pxSsl,
+                                       SSL_write(pxNetworkContext->pxSsl,
+                                                 pxIoVec[i].iov_base,
+                                                 (int) pxIoVec[i].iov_len));
+
+            if (lRet < 0)
+            {
+                /* Report the error only if nothing has been sent yet. */
+                if (lBytesSent == 0)
+                {
+                    lBytesSent = lRet;
+                }
+                break;
+            }
+
+            lBytesSent += lRet;
+
+            if ((size_t) lRet < pxIoVec[i].iov_len)
+            {
+                break;
+            }
+        }
+    }
+
+    prvUnlock(pxNetworkContext, &xOldMask);
+
+    return lBytesSent;
+}
+
+int32_t espTlsTransportRecv(NetworkContext_t* pxNetworkContext,
+    void* pvData, size_t uxDataLen)
+{
+    if (pvData == NULL || uxDataLen == 0)
+    {
+        return -1;
+    }
+
+    int32_t lBytesRead = -1;
+
+    if (pxNetworkContext != NULL && pxNetworkContext->xTlsMutexInitialised)
+    {
+        sigset_t xOldMask;
+
+        prvLock(pxNetworkContext, &xOldMask);
+        /* The connection may have been closed while waiting for the mutex. */
+        if (pxNetworkContext->pxSsl != NULL)
+        {
+            int lLen = uxDataLen > INT32_MAX ? INT32_MAX : (int) uxDataLen;
+
+            lBytesRead = prvIoResult(pxNetworkContext->pxSsl,
+                                     SSL_read(pxNetworkContext->pxSsl, pvData, lLen));
+        }
+        prvUnlock(pxNetworkContext, &xOldMask);
+    }
+
+    return lBytesRead;
+}
@@ -0,0 +1,124 @@
+#ifndef ESP_TLS_TRANSPORT_H
+#define ESP_TLS_TRANSPORT_H
+
+/*
+ * Host (Linux) build of the TLS transport, using POSIX sockets and OpenSSL.
+ *
+ * It implements the same connect, disconnect, send, receive and writev API as
+ * the esp-tls transport one directory up, so demo logic can run natively
+ * against a local broker. The esp-tls specific extensions (secure element,
+ * digital signature peripheral, asynchronous connect, session cache, shared
+ * credentials, read-ahead, statistics) are not available here, and demo code
+ * that uses them must leave them out of host builds.
+ *
+ * Where the target code creates xTlsContextSemaphore, host code calls
+ * #xTlsInit instead.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "transport_interface.h"
+
+typedef enum TlsTransportStatus
+{
+    TLS_TRANSPORT_SUCCESS = 0,              /**< Function successfully completed. */
+                                            /**< -1 is reserved for ESP_FAIL */
+    TLS_TRANSPORT_INVALID_PARAMETER = -2,   /**< At least one parameter was invalid. */
+    TLS_TRANSPORT_INSUFFICIENT_MEMORY = -3, /**< Insufficient memory required to establish connection. */
+    TLS_TRANSPORT_INVALID_CREDENTIALS = -4, /**< Provided credentials were invalid. */
+    TLS_TRANSPORT_HANDSHAKE_FAILED = -5,    /**< Performing TLS handshake with server failed. */
+    TLS_TRANSPORT_INTERNAL_ERROR = -6,      /**< A call to a system API resulted in an internal error. */
+    TLS_TRANSPORT_CONNECT_FAILURE = -7,     /**< Initial connection to the server failed. */
+    TLS_TRANSPORT_DISCONNECT_FAILURE = -8,  /**< Failed to disconnect from server. */
+    TLS_TRANSPORT_CONNECT_TIMEOUT = -9,     /**< A connect or handshake deadline expired. */
+    TLS_TRANSPORT_CONNECT_IN_PROGRESS = 1   /**< An asynchronous connect has not finished yet. */
+} TlsTransportStatus_t;
+
+struct NetworkContext
+{
+    /**
+    * @brief Serialises connect, disconnect, send and receive. Created by
+    * #xTlsInit and destroyed by #vTlsDeinit.
+    */
+    pthread_mutex_t xTlsMutex;
+    bool xTlsMutexInitialised;
+
+    /**
+    * @brief Connection state. Owned by the transport. xSocket is -1 while
+    * there is no connection.
+    */
+    int xSocket;
+    struct ssl_ctx_st * pxSslContext;
+    struct ssl_st * pxSsl;
+
+    const char *pcHostname; /**< @brief Server host name. */
+    int xPort;              /**< @brief Server port in host-order. */
+    const char *pcServerRootCAPem; /**< @brief Trusted server root certificate bytes. */
+    const char *pcClientCertPem; /**< @brief Client certificate bytes. */
+    const char *pcClientKeyPem; /**< @brief Client certificate's private key bytes. */
+    const char **pAlpnProtos;
+    bool disableSni;
+
+    /**
+    * @brief Optional buffer used by #espTlsTransportWritev to gather small
+    * vectors into a single TLS record. NULL sends each vector separately.
+    */
+    uint8_t * pucWritevBuffer;
+    size_t xWritevBufferSize;
+
+    /**
+    * @brief TCP connect timeout, also used as the socket receive timeout.
+    * Zero selects the default.
+    */
+    uint32_t ulConnectTimeoutMs;
+
+    /**
+    * @brief Fields of the esp-tls context that demo code sets. Accepted so
+    * that code builds unchanged, and otherwise ignored.
+    */
+    void * xTlsContextSemaphore;
+    void * pxTls;
+    bool use_secure_element;
+    void * ds_data;
+};
+
+/**
+ * @brief Prepare a context for use. Call once, before the context is shared
+ * with other threads and before the first #xTlsConnect.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INVALID_PARAMETER or
+ * #TLS_TRANSPORT_INTERNAL_ERROR.
+ */
+TlsTransportStatus_t xTlsInit( NetworkContext_t* pxNetworkContext );
+
+/**
+ * @brief Close any connection and free what #xTlsInit created. No other
+ * thread may still use the context.
+ */
+void vTlsDeinit( NetworkContext_t* pxNetworkContext );
+
+TlsTransportStatus_t xTlsConnect(NetworkContext_t* pxNetworkContext );
+
+TlsTransportStatus_t xTlsDisconnect( NetworkContext_t* pxNetworkContext );
+
+int32_t espTlsTransportSend( NetworkContext_t* pxNetworkContext,
+    const void* pvData, size_t uxDataLen );
+
+int32_t espTlsTransportRecv( NetworkContext_t* pxNetworkContext,
+    void* pvData, size_t uxDataLen );
+
+/**
+ * @brief Send an array of buffers over the TLS connection.
+ *
+ * Implements #TransportWritev_t. The vectors are gathered into
+ * NetworkContext_t::pucWritevBuffer when they fit, so a small MQTT packet
+ * costs one TLS record instead of one per vector.
+ *
+ * @return Number of bytes sent, which may be less than the total length of
+ * the vectors, or a negative value on error.
+ */
+int32_t espTlsTransportWritev( NetworkContext_t* pxNetworkContext,
+    TransportOutVector_t* pxIoVec, size_t uxIoVecCount );
+
+#endif /* ESP_TLS_TRANSPORT_H */
@@ -0,0 +1,308 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file event_bench.c
+ * @brief Host microbenchmark of osi_event_t against osi_sem_t.
+ *
+ * Three measurements for each primitive:
+ *
+ * - Try-lock: a wait with zero timeout and a signal on one task, as the OTA
+ *   demos do around every buffer get and free, in pairs per second.
+ * - Signal latency: two tasks hand a signal back and forth, each waiting
+ *   forever on its own object. Half of each round trip is one signal to
+ *   wakeup, reported as percentiles.
+ * - RAM: the bytes each object needs, including the kernel object osi_sem_t
+ *   allocates from the heap.
+ *
+ * Both run on the FreeRTOS shim of the posix_compat host build, so the
+ * semaphore is a pthread mutex and condition variable rather than a kernel
+ * object, and the sizes are those of the host:
+ *
+ * @code
+ * posix_compat_event_bench -n 1000000 -r 20000
+ * @endcode
+ *
+ * Options: -n try-lock pairs, -r signal round trips.
+ */
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event.h"
+#include "semaphore.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The two primitives under test.
+ */
+typedef enum BenchKind
+{
+    BENCH_EVENT,
+    BENCH_SEM
+} BenchKind_t;
+
+/**
+ * @brief One object of either kind.
+ */
+typedef struct BenchObject
+{
+    osi_event_t event;
+    osi_sem_t sem;
+} BenchObject_t;
+
+static BenchKind_t benchKind;
+static BenchObject_t ping;
+static BenchObject_t pong;
+static uint32_t roundTrips;
+static TaskHandle_t mainTask;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t nowNs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000000U ) + ( uint64_t ) now.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareLatency( const void * pLeft,
+                           const void * pRight )
+{
+    uint32_t left = *( const uint32_t * ) pLeft;
+    uint32_t right = *( const uint32_t * ) pRight;
+
+    return ( left > right ) - ( left < right );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t percentile( const uint32_t * pSorted,
+                            size_t count,
+                            uint32_t permille )
+{
+    size_t index = ( count * permille ) / 1000U;
+
+    return ( count == 0U ) ? 0U : pSorted[ ( index < count ) ? index : ( count - 1U ) ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void objectInit( BenchObject_t * pObject,
+                        uint32_t initCount )
+{
+    if( benchKind == BENCH_EVENT )
+    {
+        osi_event_init( &pObject->event, initCount );
+    }
+    else if( osi_sem_new( &pObject->sem, 0x7FFFU, initCount ) != 0 )
+    {
+        fprintf( stderr, "failed to create a semaphore\n" );
+        exit( 1 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void objectDeinit( BenchObject_t * pObject )
+{
+    if( benchKind == BENCH_EVENT )
+    {
+        osi_event_deinit( &pObject->event );
+    }
+    else
+    {
+        ( void ) osi_sem_free( &pObject->sem );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int objectWait( BenchObject_t * pObject,
+                       uint32_t timeout )
+{
+    return ( benchKind == BENCH_EVENT ) ? osi_event_wait( &pObject->event, timeout ) :
+                                          osi_sem_take( &pObject->sem, timeout );
+}
+
+/*-----------------------------------------------------------*/
+
+static void objectSignal( BenchObject_t * pObject )
+{
+    if( benchKind == BENCH_EVENT )
+    {
+        osi_event_signal( &pObject->event );
+    }
+    else
+    {
+        osi_sem_give( &pObject->sem );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static double benchTryLock( uint32_t pairs )
+{
+    uint64_t startNs;
+    uint64_t elapsedNs;
+    uint32_t i;
+
+    objectInit( &ping, 1U );
+    startNs = nowNs();
+
+    for( i = 0U; i < pairs; i++ )
+    {
+        if( objectWait( &ping, 0U ) != 0 )
+        {
+            fprintf( stderr, "try-lock failed\n" );
+            exit( 1 );
+        }
+
+        objectSignal( &ping );
+    }
+
+    elapsedNs = nowNs() - startNs;
+    objectDeinit( &ping );
+
+    return ( elapsedNs > 0U ) ? ( ( double ) pairs * 1e9 / ( double ) elapsedNs ) : 0.0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void pongTask( void * pvParameters )
+{
+    uint32_t i;
+
+    ( void ) pvParameters;
+
+    for( i = 0U; i < roundTrips; i++ )
+    {
+        ( void ) objectWait( &ping, OSI_EVENT_MAX_TIMEOUT );
+        objectSignal( &pong );
+    }
+
+    ( void ) xTaskNotifyGive( mainTask );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchLatency( const char * pName,
+                          uint32_t * pLatencyNs )
+{
+    uint32_t i;
+
+    objectInit( &ping, 0U );
+    objectInit( &pong, 0U );
+
+    if( xTaskCreate( pongTask, "pong", 4096, NULL, 5, NULL ) != pdPASS )
+    {
+        fprintf( stderr, "failed to create the pong task\n" );
+        exit( 1 );
+    }
+
+    for( i = 0U; i < roundTrips; i++ )
+    {
+        uint64_t startNs = nowNs();
+
+        objectSignal( &ping );
+        ( void ) objectWait( &pong, OSI_EVENT_MAX_TIMEOUT );
+        pLatencyNs[ i ] = ( uint32_t ) ( ( nowNs() - startNs ) / 2U );
+    }
+
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+    objectDeinit( &ping );
+    objectDeinit( &pong );
+
+    qsort( pLatencyNs, roundTrips, sizeof( uint32_t ), compareLatency );
+    printf( "%s signal to wakeup ns: p50 %" PRIu32 ", p90 %" PRIu32 ", p99 %" PRIu32 ", max %" PRIu32 "\n",
+            pName, percentile( pLatencyNs, roundTrips, 500U ), percentile( pLatencyNs, roundTrips, 900U ),
+            percentile( pLatencyNs, roundTrips, 990U ), percentile( pLatencyNs, roundTrips, 1000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t pairs = 1000000U;
+    uint32_t * pLatencyNs;
+    double eventRate;
+    double semRate;
+    int option;
+
+    roundTrips = 20000U;
+
+    while( ( option = getopt( argc, argv, "n:r:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 'n':
+                pairs = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'r':
+                roundTrips = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                fprintf( stderr, "usage: %s [-n try-lock pairs] [-r round trips]\n", argv[ 0 ] );
+                return 1;
+        }
+    }
+
+    if( ( pairs == 0U ) || ( roundTrips == 0U ) )
+    {
+        fprintf( stderr, "invalid options\n" );
+        return 1;
+    }
+
+    pLatencyNs = malloc( roundTrips * sizeof( uint32_t ) );
+
+    if( pLatencyNs == NULL )
+    {
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    mainTask = xTaskGetCurrentTaskHandle();
+
+    benchKind = BENCH_EVENT;
+    eventRate = benchTryLock( pairs );
+    benchKind = BENCH_SEM;
+    semRate = benchTryLock( pairs );
+    printf( "try-lock pairs/s: osi_event %.0f, osi_sem %.0f, ratio %.2fx\n",
+            eventRate, semRate, ( semRate > 0.0 ) ? ( eventRate / semRate ) : 0.0 );
+
+    benchKind = BENCH_EVENT;
+    benchLatency( "osi_event", pLatencyNs );
+    benchKind = BENCH_SEM;
+    benchLatency( "osi_sem  ", pLatencyNs );
+
+    printf( "bytes per object: osi_event %zu, osi_sem %zu (handle %zu + semaphore %zu, plus heap overhead)\n",
+            sizeof( osi_event_t ), sizeof( osi_sem_t ) + sizeof( StaticSemaphore_t ),
+            sizeof( osi_sem_t ), sizeof( StaticSemaphore_t ) );
+
+    free( pLatencyNs );
+
+    return 0;
+}
@@ -49,10 +49,34 @@ uint32_t Clock_GetTimeMs( void );
 /**
  * @brief Millisecond sleep function.
  *
+ * Sleeps for @p sleepTimeMs rounded up to whole scheduler ticks, so a sleep
+ * shorter than a tick still yields for one. It never busy-waits; use
+ * Clock_SleepUntilUs() for sub-tick deadlines.
+ *
  * @param[in] sleepTimeMs milliseconds to sleep.
  */
 void Clock_SleepMs( uint32_t sleepTimeMs );
 
+/**
+ * @brief The high resolution timer query function.
+ *
+ * @return Microseconds since an arbitrary fixed point, from a monotonic clock
+ * that does not wrap in practice.
+ */
+uint64_t Clock_GetTimeUs( void );
+
+/**
+ * @brief Sleep until a deadline of the Clock_GetTimeUs() clock.
+ *
+ * Returns at or after the deadline, immediately if it has passed. Repeated
+ * calls with deadlines advanced by a fixed period run at that period without
+ * accumulating drift. A remainder shorter than a tick costs one more tick of
+ * sleep, or is busy-waited if it is within CONFIG_CLOCK_SLEEP_SPIN_LIMIT_US.
+ *
+ * @param[in] deadlineUs Time to sleep until.
+ */
+void Clock_SleepUntilUs( uint64_t deadlineUs );
+
 /* *INDENT-OFF* */
 #ifdef __cplusplus
     }
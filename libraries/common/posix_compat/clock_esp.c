@@ -14,10 +14,26 @@
 /* Platform clock include. */
 #include "clock.h"
 
+#include "esp_rom_sys.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+/**
+ * @brief Sub-tick remainders of Clock_SleepUntilUs() up to this are
+ * busy-waited rather than slept for, since a tick of sleep would overshoot
+ * them by up to a whole tick. 0, the default, never spins.
+ */
+#ifndef CLOCK_SLEEP_SPIN_LIMIT_US
+    #ifdef CONFIG_CLOCK_SLEEP_SPIN_LIMIT_US
+        #define CLOCK_SLEEP_SPIN_LIMIT_US    CONFIG_CLOCK_SLEEP_SPIN_LIMIT_US
+    #else
+        #define CLOCK_SLEEP_SPIN_LIMIT_US    ( 0U )
+    #endif
+#endif
+
+#define TICK_PERIOD_US    ( ( uint64_t ) portTICK_PERIOD_MS * 1000U )
+
 uint32_t Clock_GetTimeMs( void )
 {
     /* esp_timer_get_time is in microseconds, converting to milliseconds */
@@ -34,5 +50,44 @@ uint32_t Clock_GetTimeMs( void )
 
 void Clock_SleepMs( uint32_t sleepTimeMs )
 {
-    vTaskDelay( sleepTimeMs/portTICK_PERIOD_MS );
-}
\ No newline at end of file
+    /* Round up, so that sleeps shorter than a tick still yield. */
+    vTaskDelay( ( TickType_t ) ( ( sleepTimeMs + portTICK_PERIOD_MS - 1U ) / portTICK_PERIOD_MS ) );
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetTimeUs( void )
+{
+    /* esp_timer counts microseconds since boot in 64 bits. */
+    return ( uint64_t ) esp_timer_get_time();
+}
+
+/*-----------------------------------------------------------*/
+
+void Clock_SleepUntilUs( uint64_t deadlineUs )
+{
+    uint64_t nowUs = Clock_GetTimeUs();
+    uint64_t remainingUs;
+
+    while( nowUs < deadlineUs )
+    {
+        remainingUs = deadlineUs - nowUs;
+
+        if( remainingUs >= TICK_PERIOD_US )
+        {
+            /* vTaskDelay() may return up to a tick early, as the current tick
+             * is already partly over; the loop sleeps the rest. */
+            vTaskDelay( ( TickType_t ) ( remainingUs / TICK_PERIOD_US ) );
+        }
+        else if( remainingUs <= ( uint64_t ) CLOCK_SLEEP_SPIN_LIMIT_US )
+        {
+            esp_rom_delay_us( ( uint32_t ) remainingUs );
+        }
+        else
+        {
+            vTaskDelay( 1 );
+        }
+
+        nowUs = Clock_GetTimeUs();
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file clock_posix.c
+ * @brief Host (Linux) implementation of clock.h.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <time.h>
+
+/* Platform clock include. */
+#include "clock.h"
+
+uint32_t Clock_GetTimeMs( void )
+{
+    /* Libraries need only the lower 32 bits of the time in milliseconds, since
+     * this function is used only for calculating the time difference. */
+    return ( uint32_t ) ( Clock_GetTimeUs() / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+void Clock_SleepMs( uint32_t sleepTimeMs )
+{
+    Clock_SleepUntilUs( Clock_GetTimeUs() + ( ( uint64_t ) sleepTimeMs * 1000U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetTimeUs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000U ) + ( ( uint64_t ) now.tv_nsec / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+void Clock_SleepUntilUs( uint64_t deadlineUs )
+{
+    struct timespec deadline;
+
+    deadline.tv_sec = ( time_t ) ( deadlineUs / 1000000U );
+    deadline.tv_nsec = ( long ) ( deadlineUs % 1000000U ) * 1000L;
+
+    /* An absolute deadline is immune to being woken early by signals. */
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) == EINTR )
+    {
+    }
+}
@@ -0,0 +1,139 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file event.h
+ * @brief Lightweight counting event, a cheaper osi_sem_t for hot paths.
+ *
+ * An event is a count of signals that one task at a time waits on. It can
+ * be statically allocated and initialised, needs no kernel object, and both
+ * osi_event_signal() and an osi_event_wait() that finds a signal pending are
+ * a single atomic operation. Only a wait that has to block involves the
+ * kernel: on FreeRTOS it sleeps on the waiting task's notification value,
+ * on the host on a condition variable.
+ *
+ * With an initial count of 1, osi_event_wait( &event, 0 ) and
+ * osi_event_signal() act as try-lock and unlock.
+ */
+
+#ifndef OSI_EVENT_H_
+#define OSI_EVENT_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+#else
+    #include <pthread.h>
+#endif
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief Timeout of osi_event_wait() that waits forever.
+ */
+#define OSI_EVENT_MAX_TIMEOUT    0xffffffffUL
+
+/**
+ * @brief An event. The members are private to the event implementation.
+ * Only one task may wait on an event at a time, see osi_event_wait().
+ */
+typedef struct osi_event
+{
+    uint32_t count;           /**< @brief Signals not yet consumed. */
+    #ifdef ESP_PLATFORM
+        TaskHandle_t waiter;  /**< @brief Task blocked in osi_event_wait(), or NULL. */
+    #else
+        uint32_t waiters;     /**< @brief Threads blocked in osi_event_wait(). */
+        pthread_mutex_t lock; /**< @brief Guards blocking on signalled. */
+        pthread_cond_t signalled;
+    #endif
+} osi_event_t;
+
+/**
+ * @brief Initialise an event.
+ *
+ * @param[out] event The event.
+ * @param[in] init_count Signals pending initially.
+ */
+void osi_event_init( osi_event_t * event,
+                     uint32_t init_count );
+
+/**
+ * @brief Release the resources of an event. Does nothing on FreeRTOS.
+ *
+ * @param[in] event The event, which no task may be waiting on.
+ */
+void osi_event_deinit( osi_event_t * event );
+
+/**
+ * @brief Signal an event, waking its waiter if there is one.
+ *
+ * @warning On FreeRTOS the waiter is woken with a task notification, see
+ * osi_event_wait().
+ *
+ * @param[in] event The event.
+ */
+void osi_event_signal( osi_event_t * event );
+
+#ifdef ESP_PLATFORM
+
+/**
+ * @brief Signal an event from an interrupt.
+ *
+ * @param[in] event The event.
+ * @param[out] higher_priority_task_woken Set to pdTRUE if a context switch
+ * should be requested on exit from the interrupt.
+ */
+    void osi_event_signal_from_isr( osi_event_t * event,
+                                    BaseType_t * higher_priority_task_woken );
+#endif
+
+/**
+ * @brief Consume a signal, waiting for one if none is pending.
+ *
+ * Only one task may wait on an event at a time.
+ *
+ * @warning On FreeRTOS a wait that blocks sleeps on a notification of the
+ * calling task. With configTASK_NOTIFICATION_ARRAY_ENTRIES above 1 that is
+ * its own index, OSI_EVENT_NOTIFY_INDEX, by default the last one. With a
+ * single entry, the default of ESP-IDF and the only one before FreeRTOS
+ * 10.4, it is index 0, shared with xTaskNotifyGive(), ulTaskNotifyTake() and
+ * xTaskNotifyWait() on the same task. A task that uses those must not wait
+ * on an event, since a wait that blocked clears the notification value on
+ * return, and a signaller preempted between seeing the waiter and notifying
+ * it can leave a notification behind to wake the task's next
+ * ulTaskNotifyTake().
+ *
+ * @param[in] event The event.
+ * @param[in] timeout Milliseconds to wait: 0 only checks, and
+ * #OSI_EVENT_MAX_TIMEOUT waits forever.
+ *
+ * @return 0 if a signal was consumed, -2 on timeout, as osi_sem_take().
+ */
+int osi_event_wait( osi_event_t * event,
+                    uint32_t timeout );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef OSI_EVENT_H_ */
@@ -0,0 +1,173 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file event_esp.c
+ * @brief Lightweight counting event on FreeRTOS task notifications.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+
+#include "event.h"
+
+/*-----------------------------------------------------------*/
+
+/* Wait on a notification index of the event's own where the kernel has more
+ * than one, so events never touch the value other code on the task uses. */
+#if defined( configTASK_NOTIFICATION_ARRAY_ENTRIES ) && ( configTASK_NOTIFICATION_ARRAY_ENTRIES > 1 )
+    #ifndef OSI_EVENT_NOTIFY_INDEX
+        #define OSI_EVENT_NOTIFY_INDEX    ( configTASK_NOTIFICATION_ARRAY_ENTRIES - 1 )
+    #endif
+    #define EVENT_NOTIFY_GIVE( task )                 xTaskNotifyGiveIndexed( ( task ), OSI_EVENT_NOTIFY_INDEX )
+    #define EVENT_NOTIFY_GIVE_FROM_ISR( task, woken ) vTaskNotifyGiveIndexedFromISR( ( task ), OSI_EVENT_NOTIFY_INDEX, ( woken ) )
+    #define EVENT_NOTIFY_TAKE( ticks )                ulTaskNotifyTakeIndexed( OSI_EVENT_NOTIFY_INDEX, pdTRUE, ( ticks ) )
+#else
+    #define EVENT_NOTIFY_GIVE( task )                 xTaskNotifyGive( task )
+    #define EVENT_NOTIFY_GIVE_FROM_ISR( task, woken ) vTaskNotifyGiveFromISR( ( task ), ( woken ) )
+    #define EVENT_NOTIFY_TAKE( ticks )                ulTaskNotifyTake( pdTRUE, ( ticks ) )
+#endif
+
+/*-----------------------------------------------------------*/
+
+static bool tryConsume( osi_event_t * event )
+{
+    uint32_t count = __atomic_load_n( &event->count, __ATOMIC_ACQUIRE );
+
+    while( count > 0U )
+    {
+        if( __atomic_compare_exchange_n( &event->count, &count, count - 1U, true,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_init( osi_event_t * event,
+                     uint32_t init_count )
+{
+    event->count = init_count;
+    event->waiter = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_deinit( osi_event_t * event )
+{
+    configASSERT( event->waiter == NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_signal( osi_event_t * event )
+{
+    TaskHandle_t waiter;
+
+    __atomic_add_fetch( &event->count, 1U, __ATOMIC_SEQ_CST );
+    waiter = __atomic_load_n( &event->waiter, __ATOMIC_SEQ_CST );
+
+    /* A notification to a waiter that has just consumed a signal anyway is
+     * drained when it stops waiting. */
+    if( waiter != NULL )
+    {
+        ( void ) EVENT_NOTIFY_GIVE( waiter );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_signal_from_isr( osi_event_t * event,
+                                BaseType_t * higher_priority_task_woken )
+{
+    TaskHandle_t waiter;
+
+    __atomic_add_fetch( &event->count, 1U, __ATOMIC_SEQ_CST );
+    waiter = __atomic_load_n( &event->waiter, __ATOMIC_SEQ_CST );
+
+    if( waiter != NULL )
+    {
+        EVENT_NOTIFY_GIVE_FROM_ISR( waiter, higher_priority_task_woken );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int osi_event_wait( osi_event_t * event,
+                    uint32_t timeout )
+{
+    TaskHandle_t self;
+    TickType_t blockTicks;
+    TickType_t startTicks;
+    TickType_t elapsedTicks;
+    int ret = -2;
+
+    if( tryConsume( event ) )
+    {
+        return 0;
+    }
+
+    if( timeout == 0U )
+    {
+        return -2;
+    }
+
+    /* Round up, so a timeout shorter than a tick still blocks. */
+    blockTicks = ( timeout == OSI_EVENT_MAX_TIMEOUT ) ? portMAX_DELAY :
+                 ( TickType_t ) ( ( timeout + portTICK_PERIOD_MS - 1U ) / portTICK_PERIOD_MS );
+    self = xTaskGetCurrentTaskHandle();
+    startTicks = xTaskGetTickCount();
+
+    configASSERT( ( event->waiter == NULL ) || ( event->waiter == self ) );
+
+    /* Register before checking again, so a signal sent in between is either
+     * seen by the check or notifies this task. */
+    __atomic_store_n( &event->waiter, self, __ATOMIC_SEQ_CST );
+
+    for( ; ; )
+    {
+        if( tryConsume( event ) )
+        {
+            ret = 0;
+            break;
+        }
+
+        if( blockTicks == portMAX_DELAY )
+        {
+            ( void ) EVENT_NOTIFY_TAKE( portMAX_DELAY );
+            continue;
+        }
+
+        elapsedTicks = xTaskGetTickCount() - startTicks;
+
+        if( elapsedTicks >= blockTicks )
+        {
+            break;
+        }
+
+        ( void ) EVENT_NOTIFY_TAKE( blockTicks - elapsedTicks );
+    }
+
+    __atomic_store_n( &event->waiter, NULL, __ATOMIC_SEQ_CST );
+
+    /* Drop a notification from a signaller that saw this task registered
+     * after the signal had been consumed, so it cannot wake an unrelated
+     * wait on the task later. */
+    ( void ) EVENT_NOTIFY_TAKE( 0 );
+
+    return ret;
+}
@@ -0,0 +1,145 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file event_posix.c
+ * @brief Host (Linux) implementation of the lightweight counting event.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "event.h"
+
+/*-----------------------------------------------------------*/
+
+static bool tryConsume( osi_event_t * event )
+{
+    uint32_t count = __atomic_load_n( &event->count, __ATOMIC_ACQUIRE );
+
+    while( count > 0U )
+    {
+        if( __atomic_compare_exchange_n( &event->count, &count, count - 1U, true,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_init( osi_event_t * event,
+                     uint32_t init_count )
+{
+    pthread_condattr_t attributes;
+
+    event->count = init_count;
+    event->waiters = 0U;
+    ( void ) pthread_mutex_init( &event->lock, NULL );
+
+    /* Deadlines are taken from the monotonic clock. */
+    ( void ) pthread_condattr_init( &attributes );
+    ( void ) pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( &event->signalled, &attributes );
+    ( void ) pthread_condattr_destroy( &attributes );
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_deinit( osi_event_t * event )
+{
+    ( void ) pthread_cond_destroy( &event->signalled );
+    ( void ) pthread_mutex_destroy( &event->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+void osi_event_signal( osi_event_t * event )
+{
+    __atomic_add_fetch( &event->count, 1U, __ATOMIC_SEQ_CST );
+
+    /* Signal with the lock held, so it cannot fall between a waiter's check
+     * of the count and its wait. */
+    if( __atomic_load_n( &event->waiters, __ATOMIC_SEQ_CST ) > 0U )
+    {
+        ( void ) pthread_mutex_lock( &event->lock );
+        ( void ) pthread_cond_signal( &event->signalled );
+        ( void ) pthread_mutex_unlock( &event->lock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int osi_event_wait( osi_event_t * event,
+                    uint32_t timeout )
+{
+    struct timespec deadline;
+    int ret = -2;
+    int waitStatus = 0;
+
+    if( tryConsume( event ) )
+    {
+        return 0;
+    }
+
+    if( timeout == 0U )
+    {
+        return -2;
+    }
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &deadline );
+    deadline.tv_sec += ( time_t ) ( timeout / 1000U );
+    deadline.tv_nsec += ( long ) ( timeout % 1000U ) * 1000000L;
+
+    if( deadline.tv_nsec >= 1000000000L )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    ( void ) pthread_mutex_lock( &event->lock );
+    __atomic_add_fetch( &event->waiters, 1U, __ATOMIC_SEQ_CST );
+
+    for( ; ; )
+    {
+        if( tryConsume( event ) )
+        {
+            ret = 0;
+            break;
+        }
+
+        if( waitStatus == ETIMEDOUT )
+        {
+            break;
+        }
+
+        if( timeout == OSI_EVENT_MAX_TIMEOUT )
+        {
+            waitStatus = pthread_cond_wait( &event->signalled, &event->lock );
+        }
+        else
+        {
+            waitStatus = pthread_cond_timedwait( &event->signalled, &event->lock, &deadline );
+        }
+    }
+
+    __atomic_sub_fetch( &event->waiters, 1U, __ATOMIC_SEQ_CST );
+    ( void ) pthread_mutex_unlock( &event->lock );
+
+    return ret;
+}
@@ -0,0 +1,35 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file esp_log.h
+ * @brief Host (Linux) stand-in for the ESP-IDF logging macros, printing to
+ * stderr.
+ */
+
+#ifndef FREERTOS_SHIM_ESP_LOG_H_
+#define FREERTOS_SHIM_ESP_LOG_H_
+
+/* Standard includes. */
+#include <stdio.h>
+
+#define ESP_SHIM_LOG( letter, tag, format, ... ) \
+    fprintf( stderr, letter " (%s) " format "\n", ( tag ), ## __VA_ARGS__ )
+
+#define ESP_LOGE( tag, format, ... )    ESP_SHIM_LOG( "E", tag, format, ## __VA_ARGS__ )
+#define ESP_LOGW( tag, format, ... )    ESP_SHIM_LOG( "W", tag, format, ## __VA_ARGS__ )
+#define ESP_LOGI( tag, format, ... )    ESP_SHIM_LOG( "I", tag, format, ## __VA_ARGS__ )
+#define ESP_LOGD( tag, format, ... )    ( ( void ) ( tag ) )
+#define ESP_LOGV( tag, format, ... )    ( ( void ) ( tag ) )
+
+#endif /* ifndef FREERTOS_SHIM_ESP_LOG_H_ */
@@ -0,0 +1,89 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file FreeRTOS.h
+ * @brief Host (Linux) stand-in for the FreeRTOS kernel headers.
+ *
+ * Only the part of the FreeRTOS API used by the ports in this repository is
+ * provided, mapped to pthreads by freertos_shim.c. Ticks are milliseconds.
+ * It is not a simulator: there is no scheduler, and task priorities and
+ * stack sizes are ignored.
+ */
+
+#ifndef FREERTOS_SHIM_FREERTOS_H_
+#define FREERTOS_SHIM_FREERTOS_H_
+
+/* Standard includes. */
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+typedef long             BaseType_t;
+typedef unsigned long    UBaseType_t;
+typedef uint32_t         TickType_t;
+
+#define pdFALSE               ( ( BaseType_t ) 0 )
+#define pdTRUE                ( ( BaseType_t ) 1 )
+#define pdPASS                ( pdTRUE )
+#define pdFAIL                ( pdFALSE )
+
+#define configTICK_RATE_HZ    ( 1000U )
+#define portTICK_PERIOD_MS    ( ( TickType_t ) 1000U / configTICK_RATE_HZ )
+#define portMAX_DELAY         ( ( TickType_t ) 0xffffffffUL )
+#define pdMS_TO_TICKS( xTimeInMs ) \
+    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInMs ) * configTICK_RATE_HZ ) / 1000U ) )
+
+#define configASSERT( x )     assert( x )
+
+/**
+ * @brief Critical section lock. Recursive like a portMUX on one core, so
+ * nested critical sections on the same lock work.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+#define portENTER_CRITICAL( pMux )      ( void ) pthread_mutex_lock( &( pMux )->mutex )
+#define portEXIT_CRITICAL( pMux )       ( void ) pthread_mutex_unlock( &( pMux )->mutex )
+#define portENTER_CRITICAL_ISR( pMux )  portENTER_CRITICAL( pMux )
+#define portEXIT_CRITICAL_ISR( pMux )   portEXIT_CRITICAL( pMux )
+#define portYIELD_FROM_ISR()
+
+void * pvPortMalloc( size_t xSize );
+
+void vPortFree( void * pv );
+
+/**
+ * @brief A task, which is a thread on the host.
+ */
+typedef struct tskTaskControlBlock * TaskHandle_t;
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef FREERTOS_SHIM_FREERTOS_H_ */
@@ -0,0 +1,88 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file queue.h
+ * @brief Host (Linux) stand-in for the FreeRTOS queue API.
+ */
+
+#ifndef FREERTOS_SHIM_QUEUE_H_
+#define FREERTOS_SHIM_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief A queue. As in FreeRTOS, semaphores are queues with items of size 0,
+ * where the item count is the semaphore count.
+ *
+ * The members are private to freertos_shim.c; they are visible only so that
+ * queues and semaphores can be statically allocated.
+ */
+typedef struct QueueDefinition
+{
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    uint8_t * pStorage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+    TaskHandle_t holder;      /**< Owner of a mutex, NULL when not held. */
+    UBaseType_t recursion;    /**< Nested takes of a recursive mutex. */
+    uint8_t kind;
+    bool dynamic;
+} StaticQueue_t;
+
+typedef struct QueueDefinition * QueueHandle_t;
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength,
+                            UBaseType_t uxItemSize );
+
+QueueHandle_t xQueueCreateStatic( UBaseType_t uxQueueLength,
+                                  UBaseType_t uxItemSize,
+                                  uint8_t * pucQueueStorage,
+                                  StaticQueue_t * pxStaticQueue );
+
+void vQueueDelete( QueueHandle_t xQueue );
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue,
+                             const void * pvItemToQueue,
+                             TickType_t xTicksToWait );
+
+BaseType_t xQueueSendToFront( QueueHandle_t xQueue,
+                              const void * pvItemToQueue,
+                              TickType_t xTicksToWait );
+
+#define xQueueSend( xQueue, pvItemToQueue, xTicksToWait ) \
+    xQueueSendToBack( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ) )
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * pvBuffer,
+                          TickType_t xTicksToWait );
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef FREERTOS_SHIM_QUEUE_H_ */
@@ -0,0 +1,72 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file semphr.h
+ * @brief Host (Linux) stand-in for the FreeRTOS semaphore API.
+ */
+
+#ifndef FREERTOS_SHIM_SEMPHR_H_
+#define FREERTOS_SHIM_SEMPHR_H_
+
+#include "freertos/queue.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+typedef QueueHandle_t    SemaphoreHandle_t;
+typedef StaticQueue_t    StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount,
+                                            UBaseType_t uxInitialCount );
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t uxMaxCount,
+                                                  UBaseType_t uxInitialCount,
+                                                  StaticSemaphore_t * pxSemaphoreBuffer );
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t * pxMutexBuffer );
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void );
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t * pxMutexBuffer );
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore,
+                           TickType_t xBlockTime );
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore );
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex,
+                                    TickType_t xBlockTime );
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex );
+
+UBaseType_t uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore );
+
+#define xSemaphoreCreateBinary()                    xSemaphoreCreateCounting( 1U, 0U )
+#define xSemaphoreCreateBinaryStatic( pxBuffer )    xSemaphoreCreateCountingStatic( 1U, 0U, ( pxBuffer ) )
+#define xSemaphoreGiveFromISR( xSemaphore, pxHigherPriorityTaskWoken ) \
+    ( ( void ) ( pxHigherPriorityTaskWoken ), xSemaphoreGive( xSemaphore ) )
+#define vSemaphoreDelete( xSemaphore )              vQueueDelete( xSemaphore )
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef FREERTOS_SHIM_SEMPHR_H_ */
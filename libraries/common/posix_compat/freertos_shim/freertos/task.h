@@ -0,0 +1,83 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file task.h
+ * @brief Host (Linux) stand-in for the FreeRTOS task API.
+ */
+
+#ifndef FREERTOS_SHIM_TASK_H_
+#define FREERTOS_SHIM_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+#define tskIDLE_PRIORITY                ( ( UBaseType_t ) 0U )
+
+#define taskENTER_CRITICAL( pMux )      portENTER_CRITICAL( pMux )
+#define taskEXIT_CRITICAL( pMux )       portEXIT_CRITICAL( pMux )
+#define taskENTER_CRITICAL_ISR( pMux )  portENTER_CRITICAL( pMux )
+#define taskEXIT_CRITICAL_ISR( pMux )   portEXIT_CRITICAL( pMux )
+
+typedef void (* TaskFunction_t)( void * pvParameters );
+
+/**
+ * @brief Start a detached thread running @p pxTaskCode. The stack depth and
+ * priority are ignored.
+ */
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const uint32_t usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask );
+
+/**
+ * @brief Only a task deleting itself, with NULL or its own handle, is
+ * supported.
+ */
+void vTaskDelete( TaskHandle_t xTaskToDelete );
+
+void vTaskDelay( const TickType_t xTicksToDelay );
+
+/**
+ * @brief Milliseconds since the first call into the shim.
+ */
+TickType_t xTaskGetTickCount( void );
+
+/**
+ * @brief Handle of the calling thread. Threads not started with
+ * xTaskCreate() get one on first use, so they can wait on notifications.
+ */
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit,
+                           TickType_t xTicksToWait );
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify );
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify,
+                             BaseType_t * pxHigherPriorityTaskWoken );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef FREERTOS_SHIM_TASK_H_ */
@@ -0,0 +1,85 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timers.h
+ * @brief Host (Linux) stand-in for the FreeRTOS software timer API.
+ *
+ * Callbacks run one at a time in a daemon task started with the first timer,
+ * as in FreeRTOS. Commands take effect at once rather than through a queue,
+ * so their block time is ignored and they never fail.
+ */
+
+#ifndef FREERTOS_SHIM_TIMERS_H_
+#define FREERTOS_SHIM_TIMERS_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+typedef struct tmrTimerControl * TimerHandle_t;
+
+typedef void (* TimerCallbackFunction_t)( TimerHandle_t xTimer );
+
+/**
+ * @brief A timer. The members are private to freertos_shim.c; they are
+ * visible only so that timers can be statically allocated.
+ */
+typedef struct tmrTimerControl
+{
+    struct tmrTimerControl * pNext; /**< Next active timer. */
+    TimerCallbackFunction_t pxCallbackFunction;
+    void * pvTimerID;
+    TickType_t xPeriod;
+    uint64_t expiryMs;
+    bool autoReload;
+    bool active;
+} StaticTimer_t;
+
+TimerHandle_t xTimerCreateStatic( const char * const pcTimerName,
+                                  const TickType_t xTimerPeriodInTicks,
+                                  const UBaseType_t uxAutoReload,
+                                  void * const pvTimerID,
+                                  TimerCallbackFunction_t pxCallbackFunction,
+                                  StaticTimer_t * pxTimerBuffer );
+
+BaseType_t xTimerStart( TimerHandle_t xTimer,
+                        TickType_t xTicksToWait );
+
+BaseType_t xTimerStop( TimerHandle_t xTimer,
+                       TickType_t xTicksToWait );
+
+/**
+ * @brief Set the period and start the timer, dormant or not, from now.
+ */
+BaseType_t xTimerChangePeriod( TimerHandle_t xTimer,
+                               TickType_t xNewPeriod,
+                               TickType_t xTicksToWait );
+
+BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer );
+
+void * pvTimerGetTimerID( const TimerHandle_t xTimer );
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle( void );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef FREERTOS_SHIM_TIMERS_H_ */
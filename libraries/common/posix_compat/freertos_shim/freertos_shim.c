@@ -0,0 +1,932 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file freertos_shim.c
+ * @brief The FreeRTOS API subset of the shim headers, on pthreads.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+/*-----------------------------------------------------------*/
+
+#define KIND_QUEUE        ( 0U )
+#define KIND_COUNTING     ( 1U )
+#define KIND_MUTEX        ( 2U )
+#define KIND_RECURSIVE    ( 3U )
+
+/**
+ * @brief A task. Freed when its thread exits.
+ */
+struct tskTaskControlBlock
+{
+    TaskFunction_t pxTaskCode;
+    void * pvParameters;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notifyValue;
+};
+
+static pthread_once_t taskKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t taskKey;
+
+/*-----------------------------------------------------------*/
+
+static void initCond( pthread_cond_t * pCond )
+{
+    pthread_condattr_t attributes;
+
+    /* Deadlines are taken from the monotonic clock. */
+    ( void ) pthread_condattr_init( &attributes );
+    ( void ) pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( pCond, &attributes );
+    ( void ) pthread_condattr_destroy( &attributes );
+}
+
+/*-----------------------------------------------------------*/
+
+static void deadlineAfter( struct timespec * pDeadline,
+                           TickType_t xTicks )
+{
+    uint64_t ms = ( uint64_t ) xTicks * portTICK_PERIOD_MS;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, pDeadline );
+    pDeadline->tv_sec += ( time_t ) ( ms / 1000U );
+    pDeadline->tv_nsec += ( long ) ( ms % 1000U ) * 1000000L;
+
+    if( pDeadline->tv_nsec >= 1000000000L )
+    {
+        pDeadline->tv_sec++;
+        pDeadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait on @p pCond once, for at most the time left of @p xTicks.
+ *
+ * @return false once the wait has timed out.
+ */
+static bool waitOnce( pthread_cond_t * pCond,
+                      pthread_mutex_t * pLock,
+                      TickType_t xTicks,
+                      const struct timespec * pDeadline )
+{
+    if( xTicks == 0U )
+    {
+        return false;
+    }
+
+    if( xTicks == portMAX_DELAY )
+    {
+        ( void ) pthread_cond_wait( pCond, pLock );
+        return true;
+    }
+
+    return pthread_cond_timedwait( pCond, pLock, pDeadline ) != ETIMEDOUT;
+}
+
+/*-----------------------------------------------------------*/
+
+static void freeTask( void * pvTask )
+{
+    TaskHandle_t pxTask = ( TaskHandle_t ) pvTask;
+
+    ( void ) pthread_cond_destroy( &pxTask->notified );
+    ( void ) pthread_mutex_destroy( &pxTask->lock );
+    free( pxTask );
+}
+
+/*-----------------------------------------------------------*/
+
+static void createTaskKey( void )
+{
+    ( void ) pthread_key_create( &taskKey, freeTask );
+}
+
+/*-----------------------------------------------------------*/
+
+static TaskHandle_t newTask( TaskFunction_t pxTaskCode,
+                             void * pvParameters )
+{
+    TaskHandle_t pxTask = calloc( 1U, sizeof( *pxTask ) );
+
+    if( pxTask != NULL )
+    {
+        pxTask->pxTaskCode = pxTaskCode;
+        pxTask->pvParameters = pvParameters;
+        ( void ) pthread_mutex_init( &pxTask->lock, NULL );
+        initCond( &pxTask->notified );
+    }
+
+    return pxTask;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * taskEntry( void * pvTask )
+{
+    TaskHandle_t pxTask = ( TaskHandle_t ) pvTask;
+
+    ( void ) pthread_setspecific( taskKey, pxTask );
+    pxTask->pxTaskCode( pxTask->pvParameters );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    return malloc( xSize );
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const uint32_t usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask )
+{
+    TaskHandle_t pxTask;
+    pthread_attr_t attributes;
+    pthread_t thread;
+    int status;
+
+    ( void ) pcName;
+    ( void ) usStackDepth;
+    ( void ) uxPriority;
+
+    ( void ) pthread_once( &taskKeyOnce, createTaskKey );
+    pxTask = newTask( pxTaskCode, pvParameters );
+
+    if( pxTask == NULL )
+    {
+        return pdFAIL;
+    }
+
+    ( void ) pthread_attr_init( &attributes );
+    ( void ) pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED );
+    status = pthread_create( &thread, &attributes, taskEntry, pxTask );
+    ( void ) pthread_attr_destroy( &attributes );
+
+    if( status != 0 )
+    {
+        freeTask( pxTask );
+        return pdFAIL;
+    }
+
+    if( pxCreatedTask != NULL )
+    {
+        *pxCreatedTask = pxTask;
+    }
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    configASSERT( ( xTaskToDelete == NULL ) || ( xTaskToDelete == xTaskGetCurrentTaskHandle() ) );
+
+    pthread_exit( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelay( const TickType_t xTicksToDelay )
+{
+    struct timespec deadline;
+
+    deadlineAfter( &deadline, xTicksToDelay );
+
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) == EINTR )
+    {
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    /* Truncated like the FreeRTOS tick count, which wraps. */
+    return ( TickType_t ) ( ( ( uint64_t ) now.tv_sec * 1000U ) +
+                            ( ( uint64_t ) now.tv_nsec / 1000000U ) ) / portTICK_PERIOD_MS;
+}
+
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    TaskHandle_t pxTask;
+
+    ( void ) pthread_once( &taskKeyOnce, createTaskKey );
+    pxTask = ( TaskHandle_t ) pthread_getspecific( taskKey );
+
+    if( pxTask == NULL )
+    {
+        pxTask = newTask( NULL, NULL );
+        configASSERT( pxTask != NULL );
+        ( void ) pthread_setspecific( taskKey, pxTask );
+    }
+
+    return pxTask;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit,
+                           TickType_t xTicksToWait )
+{
+    TaskHandle_t pxTask = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    uint32_t value;
+
+    deadlineAfter( &deadline, xTicksToWait );
+    ( void ) pthread_mutex_lock( &pxTask->lock );
+
+    while( pxTask->notifyValue == 0U )
+    {
+        if( !waitOnce( &pxTask->notified, &pxTask->lock, xTicksToWait, &deadline ) )
+        {
+            break;
+        }
+    }
+
+    value = pxTask->notifyValue;
+
+    if( value > 0U )
+    {
+        pxTask->notifyValue = ( xClearCountOnExit != pdFALSE ) ? 0U : ( value - 1U );
+    }
+
+    ( void ) pthread_mutex_unlock( &pxTask->lock );
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify )
+{
+    ( void ) pthread_mutex_lock( &xTaskToNotify->lock );
+    xTaskToNotify->notifyValue++;
+    ( void ) pthread_cond_signal( &xTaskToNotify->notified );
+    ( void ) pthread_mutex_unlock( &xTaskToNotify->lock );
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify,
+                             BaseType_t * pxHigherPriorityTaskWoken )
+{
+    ( void ) xTaskNotifyGive( xTaskToNotify );
+
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static QueueHandle_t initQueue( StaticQueue_t * pxQueue,
+                                UBaseType_t uxQueueLength,
+                                UBaseType_t uxItemSize,
+                                uint8_t * pucQueueStorage,
+                                uint8_t kind )
+{
+    memset( pxQueue, 0, sizeof( *pxQueue ) );
+    ( void ) pthread_mutex_init( &pxQueue->lock, NULL );
+    initCond( &pxQueue->notEmpty );
+    initCond( &pxQueue->notFull );
+    pxQueue->pStorage = pucQueueStorage;
+    pxQueue->length = uxQueueLength;
+    pxQueue->itemSize = uxItemSize;
+    pxQueue->kind = kind;
+
+    return pxQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+static QueueHandle_t createQueue( UBaseType_t uxQueueLength,
+                                  UBaseType_t uxItemSize,
+                                  uint8_t kind )
+{
+    /* The storage follows the queue in one allocation, as in FreeRTOS. */
+    StaticQueue_t * pxQueue = malloc( sizeof( StaticQueue_t ) + ( uxQueueLength * uxItemSize ) );
+
+    if( pxQueue == NULL )
+    {
+        return NULL;
+    }
+
+    ( void ) initQueue( pxQueue, uxQueueLength, uxItemSize, ( uint8_t * ) &pxQueue[ 1 ], kind );
+    pxQueue->dynamic = true;
+
+    return pxQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t sendItem( QueueHandle_t xQueue,
+                            const void * pvItemToQueue,
+                            TickType_t xTicksToWait,
+                            bool toFront )
+{
+    struct timespec deadline;
+    UBaseType_t index;
+    BaseType_t ret = pdPASS;
+
+    deadlineAfter( &deadline, xTicksToWait );
+    ( void ) pthread_mutex_lock( &xQueue->lock );
+
+    while( ( xQueue->count == xQueue->length ) && ( ret == pdPASS ) )
+    {
+        if( !waitOnce( &xQueue->notFull, &xQueue->lock, xTicksToWait, &deadline ) )
+        {
+            ret = pdFAIL;
+        }
+    }
+
+    /* Checked again, as the last wait may have timed out just as space
+     * was made. */
+    if( xQueue->count < xQueue->length )
+    {
+        if( toFront )
+        {
+            xQueue->head = ( xQueue->head + xQueue->length - 1U ) % xQueue->length;
+            index = xQueue->head;
+        }
+        else
+        {
+            index = ( xQueue->head + xQueue->count ) % xQueue->length;
+        }
+
+        if( xQueue->itemSize > 0U )
+        {
+            memcpy( &xQueue->pStorage[ index * xQueue->itemSize ], pvItemToQueue, xQueue->itemSize );
+        }
+
+        xQueue->count++;
+        ( void ) pthread_cond_signal( &xQueue->notEmpty );
+        ret = pdPASS;
+    }
+
+    ( void ) pthread_mutex_unlock( &xQueue->lock );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t receiveItem( QueueHandle_t xQueue,
+                               void * pvBuffer,
+                               TickType_t xTicksToWait )
+{
+    struct timespec deadline;
+    BaseType_t ret = pdPASS;
+
+    deadlineAfter( &deadline, xTicksToWait );
+    ( void ) pthread_mutex_lock( &xQueue->lock );
+
+    while( ( xQueue->count == 0U ) && ( ret == pdPASS ) )
+    {
+        if( !waitOnce( &xQueue->notEmpty, &xQueue->lock, xTicksToWait, &deadline ) )
+        {
+            ret = pdFAIL;
+        }
+    }
+
+    if( xQueue->count > 0U )
+    {
+        if( xQueue->itemSize > 0U )
+        {
+            memcpy( pvBuffer, &xQueue->pStorage[ xQueue->head * xQueue->itemSize ], xQueue->itemSize );
+        }
+
+        xQueue->head = ( xQueue->head + 1U ) % xQueue->length;
+        xQueue->count--;
+
+        if( ( xQueue->kind == KIND_MUTEX ) || ( xQueue->kind == KIND_RECURSIVE ) )
+        {
+            __atomic_store_n( &xQueue->holder, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE );
+        }
+
+        ( void ) pthread_cond_signal( &xQueue->notFull );
+        ret = pdPASS;
+    }
+
+    ( void ) pthread_mutex_unlock( &xQueue->lock );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength,
+                            UBaseType_t uxItemSize )
+{
+    configASSERT( uxQueueLength > 0U );
+
+    return createQueue( uxQueueLength, uxItemSize, KIND_QUEUE );
+}
+
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreateStatic( UBaseType_t uxQueueLength,
+                                  UBaseType_t uxItemSize,
+                                  uint8_t * pucQueueStorage,
+                                  StaticQueue_t * pxStaticQueue )
+{
+    configASSERT( ( uxQueueLength > 0U ) && ( pxStaticQueue != NULL ) );
+
+    return initQueue( pxStaticQueue, uxQueueLength, uxItemSize, pucQueueStorage, KIND_QUEUE );
+}
+
+/*-----------------------------------------------------------*/
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+    ( void ) pthread_cond_destroy( &xQueue->notFull );
+    ( void ) pthread_cond_destroy( &xQueue->notEmpty );
+    ( void ) pthread_mutex_destroy( &xQueue->lock );
+
+    if( xQueue->dynamic )
+    {
+        free( xQueue );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue,
+                             const void * pvItemToQueue,
+                             TickType_t xTicksToWait )
+{
+    return sendItem( xQueue, pvItemToQueue, xTicksToWait, false );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendToFront( QueueHandle_t xQueue,
+                              const void * pvItemToQueue,
+                              TickType_t xTicksToWait )
+{
+    return sendItem( xQueue, pvItemToQueue, xTicksToWait, true );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * pvBuffer,
+                          TickType_t xTicksToWait )
+{
+    return receiveItem( xQueue, pvBuffer, xTicksToWait );
+}
+
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue )
+{
+    UBaseType_t count;
+
+    ( void ) pthread_mutex_lock( &xQueue->lock );
+    count = xQueue->count;
+    ( void ) pthread_mutex_unlock( &xQueue->lock );
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount,
+                                            UBaseType_t uxInitialCount )
+{
+    SemaphoreHandle_t xSemaphore;
+
+    configASSERT( ( uxMaxCount > 0U ) && ( uxInitialCount <= uxMaxCount ) );
+    xSemaphore = createQueue( uxMaxCount, 0U, KIND_COUNTING );
+
+    if( xSemaphore != NULL )
+    {
+        xSemaphore->count = uxInitialCount;
+    }
+
+    return xSemaphore;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t uxMaxCount,
+                                                  UBaseType_t uxInitialCount,
+                                                  StaticSemaphore_t * pxSemaphoreBuffer )
+{
+    SemaphoreHandle_t xSemaphore;
+
+    configASSERT( ( uxMaxCount > 0U ) && ( uxInitialCount <= uxMaxCount ) );
+    xSemaphore = initQueue( pxSemaphoreBuffer, uxMaxCount, 0U, NULL, KIND_COUNTING );
+    xSemaphore->count = uxInitialCount;
+
+    return xSemaphore;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void )
+{
+    SemaphoreHandle_t xMutex = createQueue( 1U, 0U, KIND_MUTEX );
+
+    if( xMutex != NULL )
+    {
+        xMutex->count = 1U;
+    }
+
+    return xMutex;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t * pxMutexBuffer )
+{
+    SemaphoreHandle_t xMutex = initQueue( pxMutexBuffer, 1U, 0U, NULL, KIND_MUTEX );
+
+    xMutex->count = 1U;
+
+    return xMutex;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void )
+{
+    SemaphoreHandle_t xMutex = createQueue( 1U, 0U, KIND_RECURSIVE );
+
+    if( xMutex != NULL )
+    {
+        xMutex->count = 1U;
+    }
+
+    return xMutex;
+}
+
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t * pxMutexBuffer )
+{
+    SemaphoreHandle_t xMutex = initQueue( pxMutexBuffer, 1U, 0U, NULL, KIND_RECURSIVE );
+
+    xMutex->count = 1U;
+
+    return xMutex;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore,
+                           TickType_t xBlockTime )
+{
+    return receiveItem( xSemaphore, NULL, xBlockTime );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+    if( xSemaphore->kind == KIND_MUTEX )
+    {
+        /* Only the holder may give a mutex. */
+        ( void ) pthread_mutex_lock( &xSemaphore->lock );
+
+        if( __atomic_load_n( &xSemaphore->holder, __ATOMIC_ACQUIRE ) != xTaskGetCurrentTaskHandle() )
+        {
+            ( void ) pthread_mutex_unlock( &xSemaphore->lock );
+            return pdFAIL;
+        }
+
+        __atomic_store_n( &xSemaphore->holder, NULL, __ATOMIC_RELEASE );
+        ( void ) pthread_mutex_unlock( &xSemaphore->lock );
+    }
+
+    return sendItem( xSemaphore, NULL, 0U, false );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex,
+                                    TickType_t xBlockTime )
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    BaseType_t ret;
+
+    /* Only the holder itself changes the holder from or to its own handle,
+     * so the unlocked check is safe. */
+    if( __atomic_load_n( &xMutex->holder, __ATOMIC_ACQUIRE ) == self )
+    {
+        xMutex->recursion++;
+        return pdPASS;
+    }
+
+    ret = receiveItem( xMutex, NULL, xBlockTime );
+
+    if( ret == pdPASS )
+    {
+        xMutex->recursion = 1U;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex )
+{
+    if( __atomic_load_n( &xMutex->holder, __ATOMIC_ACQUIRE ) != xTaskGetCurrentTaskHandle() )
+    {
+        return pdFAIL;
+    }
+
+    if( --xMutex->recursion > 0U )
+    {
+        return pdPASS;
+    }
+
+    __atomic_store_n( &xMutex->holder, NULL, __ATOMIC_RELEASE );
+
+    return sendItem( xMutex, NULL, 0U, false );
+}
+
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore )
+{
+    return uxQueueMessagesWaiting( xSemaphore );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Guards the active timer list, which is unsorted: the daemon scans it
+ * for the earliest expiry, which is fine for the few timers of a host run.
+ */
+static pthread_mutex_t timerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timerChanged;
+static pthread_once_t timerDaemonOnce = PTHREAD_ONCE_INIT;
+static TimerHandle_t activeTimers;
+static TaskHandle_t timerDaemon;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t nowMs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000U ) + ( ( uint64_t ) now.tv_nsec / 1000000U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Called with timerLock held. */
+static void unlinkTimer( TimerHandle_t xTimer )
+{
+    TimerHandle_t * ppLink = &activeTimers;
+
+    while( *ppLink != NULL )
+    {
+        if( *ppLink == xTimer )
+        {
+            *ppLink = xTimer->pNext;
+            break;
+        }
+
+        ppLink = &( *ppLink )->pNext;
+    }
+
+    xTimer->pNext = NULL;
+    xTimer->active = false;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Called with timerLock held. */
+static void startTimer( TimerHandle_t xTimer )
+{
+    if( xTimer->active )
+    {
+        unlinkTimer( xTimer );
+    }
+
+    xTimer->expiryMs = nowMs() + ( ( uint64_t ) xTimer->xPeriod * portTICK_PERIOD_MS );
+    xTimer->active = true;
+    xTimer->pNext = activeTimers;
+    activeTimers = xTimer;
+    ( void ) pthread_cond_signal( &timerChanged );
+}
+
+/*-----------------------------------------------------------*/
+
+static void timerDaemonTask( void * pvParameters )
+{
+    TimerHandle_t pxTimer;
+    TimerHandle_t pxDue;
+    struct timespec deadline;
+    uint64_t currentMs;
+
+    ( void ) pvParameters;
+    ( void ) pthread_mutex_lock( &timerLock );
+
+    for( ; ; )
+    {
+        pxDue = activeTimers;
+
+        for( pxTimer = activeTimers; pxTimer != NULL; pxTimer = pxTimer->pNext )
+        {
+            if( pxTimer->expiryMs < pxDue->expiryMs )
+            {
+                pxDue = pxTimer;
+            }
+        }
+
+        currentMs = nowMs();
+
+        if( pxDue == NULL )
+        {
+            ( void ) pthread_cond_wait( &timerChanged, &timerLock );
+        }
+        else if( pxDue->expiryMs > currentMs )
+        {
+            deadline.tv_sec = ( time_t ) ( pxDue->expiryMs / 1000U );
+            deadline.tv_nsec = ( long ) ( pxDue->expiryMs % 1000U ) * 1000000L;
+            ( void ) pthread_cond_timedwait( &timerChanged, &timerLock, &deadline );
+        }
+        else
+        {
+            unlinkTimer( pxDue );
+
+            if( pxDue->autoReload )
+            {
+                startTimer( pxDue );
+            }
+
+            /* The callback may use the timer API, so it runs unlocked. */
+            ( void ) pthread_mutex_unlock( &timerLock );
+            pxDue->pxCallbackFunction( pxDue );
+            ( void ) pthread_mutex_lock( &timerLock );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void startTimerDaemon( void )
+{
+    BaseType_t created;
+
+    initCond( &timerChanged );
+    created = xTaskCreate( timerDaemonTask, "Tmr Svc", 2048, NULL, 1, &timerDaemon );
+    configASSERT( created == pdPASS );
+    ( void ) created;
+}
+
+/*-----------------------------------------------------------*/
+
+TimerHandle_t xTimerCreateStatic( const char * const pcTimerName,
+                                  const TickType_t xTimerPeriodInTicks,
+                                  const UBaseType_t uxAutoReload,
+                                  void * const pvTimerID,
+                                  TimerCallbackFunction_t pxCallbackFunction,
+                                  StaticTimer_t * pxTimerBuffer )
+{
+    ( void ) pcTimerName;
+
+    configASSERT( ( xTimerPeriodInTicks > 0U ) && ( pxTimerBuffer != NULL ) );
+    ( void ) pthread_once( &timerDaemonOnce, startTimerDaemon );
+
+    memset( pxTimerBuffer, 0, sizeof( *pxTimerBuffer ) );
+    pxTimerBuffer->pxCallbackFunction = pxCallbackFunction;
+    pxTimerBuffer->pvTimerID = pvTimerID;
+    pxTimerBuffer->xPeriod = xTimerPeriodInTicks;
+    pxTimerBuffer->autoReload = ( uxAutoReload != 0U );
+
+    return pxTimerBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTimerStart( TimerHandle_t xTimer,
+                        TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    ( void ) pthread_mutex_lock( &timerLock );
+    startTimer( xTimer );
+    ( void ) pthread_mutex_unlock( &timerLock );
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTimerStop( TimerHandle_t xTimer,
+                       TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    ( void ) pthread_mutex_lock( &timerLock );
+
+    if( xTimer->active )
+    {
+        unlinkTimer( xTimer );
+    }
+
+    ( void ) pthread_mutex_unlock( &timerLock );
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTimerChangePeriod( TimerHandle_t xTimer,
+                               TickType_t xNewPeriod,
+                               TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    configASSERT( xNewPeriod > 0U );
+
+    ( void ) pthread_mutex_lock( &timerLock );
+    xTimer->xPeriod = xNewPeriod;
+    startTimer( xTimer );
+    ( void ) pthread_mutex_unlock( &timerLock );
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer )
+{
+    BaseType_t active;
+
+    ( void ) pthread_mutex_lock( &timerLock );
+    active = xTimer->active ? pdTRUE : pdFALSE;
+    ( void ) pthread_mutex_unlock( &timerLock );
+
+    return active;
+}
+
+/*-----------------------------------------------------------*/
+
+void * pvTimerGetTimerID( const TimerHandle_t xTimer )
+{
+    return xTimer->pvTimerID;
+}
+
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle( void )
+{
+    ( void ) pthread_once( &timerDaemonOnce, startTimerDaemon );
+
+    return timerDaemon;
+}
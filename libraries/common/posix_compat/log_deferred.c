@@ -0,0 +1,1085 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file log_deferred.c
+ * @brief Deferred logging on a multi-producer, single-consumer ring buffer.
+ *
+ * Producers reserve space for a record by advancing the reserve head with a
+ * compare-and-swap, copy the record in and then publish it by setting the
+ * committed bit of its control word. The consumer formats committed records
+ * in order, stopping at the first one still being written, and frees them by
+ * advancing the read tail. A record that would straddle the end of the
+ * buffer is preceded by a padding record filling the rest of it.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef ESP_PLATFORM
+    #include "esp_log.h"
+#endif
+
+/* Platform clock include. */
+#include "clock.h"
+
+#include "event.h"
+#include "log_deferred.h"
+
+/*-----------------------------------------------------------*/
+
+#ifndef LOG_DEFERRED_TASK_STACK_SIZE
+    #define LOG_DEFERRED_TASK_STACK_SIZE    ( 3072U )
+#endif
+
+#ifndef LOG_DEFERRED_TASK_PRIORITY
+    #ifdef CONFIG_LOG_DEFERRED_TASK_PRIORITY
+        #define LOG_DEFERRED_TASK_PRIORITY    CONFIG_LOG_DEFERRED_TASK_PRIORITY
+    #else
+        #define LOG_DEFERRED_TASK_PRIORITY    ( tskIDLE_PRIORITY + 1U )
+    #endif
+#endif
+
+_Static_assert( ( LOG_DEFERRED_BUFFER_SIZE & ( LOG_DEFERRED_BUFFER_SIZE - 1U ) ) == 0U,
+                "LOG_DEFERRED_BUFFER_SIZE must be a power of 2" );
+_Static_assert( LOG_DEFERRED_STRING_MAX <= 255U,
+                "String lengths are stored in a byte" );
+
+#define BUFFER_MASK          ( ( uint32_t ) LOG_DEFERRED_BUFFER_SIZE - 1U )
+
+/**
+ * @brief Records start on this boundary, so the header can be read in place.
+ */
+#define RECORD_ALIGN         ( 8U )
+#define ALIGN_UP( x )        ( ( ( x ) + RECORD_ALIGN - 1U ) & ~( RECORD_ALIGN - 1U ) )
+
+/* Control word of a record: the bytes it holds and its state. */
+#define CONTROL_LENGTH       ( 0xFFFFU )
+#define CONTROL_COMMITTED    ( 1UL << 16 )
+#define CONTROL_PADDING      ( 1UL << 17 )
+
+#define STATE_STOPPED        ( 0U )
+#define STATE_STARTING       ( 1U )
+#define STATE_RUNNING        ( 2U )
+
+/**
+ * @brief Start of every record, followed by the captured arguments.
+ */
+typedef struct RecordHeader
+{
+    uint32_t control;               /**< @brief Written last, see CONTROL_COMMITTED. */
+    uint32_t timestampMs;           /**< @brief Clock_GetTimeMs() at the log call. */
+    const LogDeferredSite_t * pSite;
+} RecordHeader_t;
+
+/**
+ * @brief A parsed printf conversion specification.
+ */
+typedef struct FormatSpec
+{
+    const char * pStart;   /**< @brief The '%'. */
+    size_t length;         /**< @brief Characters up to and including the conversion. */
+    bool widthStar;        /**< @brief Width taken from an int argument. */
+    bool precisionStar;    /**< @brief Precision taken from an int argument. */
+    int32_t precision;     /**< @brief Literal precision, -1 for none. */
+    char lengthModifier;   /**< @brief 'H' for hh, 'q' for ll, else as written, 0 for none. */
+    char conversion;
+} FormatSpec_t;
+
+/**
+ * @brief How an argument is passed, and so captured and replayed.
+ */
+typedef enum ArgClass
+{
+    ARG_NONE,              /**< @brief %%, no argument. */
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_POINTER,
+    ARG_STRING,            /**< @brief Copied as a length byte and the characters. */
+    ARG_UNSUPPORTED,       /**< @brief Capture and formatting stop here. */
+    ARG_PRECISION          /**< @brief Star precision, an int that bounds the next %s. Layouts only. */
+} ArgClass_t;
+
+/* Argument layout of a site, cached in LogDeferredSite_t::pLayout: the
+ * class of each va_arg, LAYOUT_BITS each from the least significant bits,
+ * ended by ARG_NONE. */
+#define LAYOUT_BITS          ( 4U )
+#define LAYOUT_SLOTS         ( 7U )
+#define LAYOUT_CLASS         ( 0xFU )
+#define LAYOUT_ARGS          ( 0x0FFFFFFFUL )
+#define LAYOUT_VALID         ( 1UL << 31 )
+#define LAYOUT_PARSE         ( 1UL << 30 ) /* No usable layout, parse the format on every call. */
+
+_Static_assert( ARG_PRECISION <= LAYOUT_CLASS, "Argument classes must fit in a layout slot" );
+
+static uint8_t ring[ LOG_DEFERRED_BUFFER_SIZE ] __attribute__( ( aligned( RECORD_ALIGN ) ) );
+
+/**
+ * @brief Free running byte counters; their difference is the space in use.
+ */
+static uint32_t reserveHead;
+static uint32_t readTail;
+
+static LogDeferredStats_t stats;
+
+/**
+ * @brief Most verbose level recorded.
+ */
+static uint8_t maxLevel = LOG_DEFERRED_DEFAULT_LEVEL;
+
+/**
+ * @brief Signalled for each record committed, wakes the drain task.
+ */
+static osi_event_t recordsPending;
+
+static uint8_t serviceState = STATE_STOPPED;
+static LogDeferredSink_t taskSink;
+static void * taskContext;
+
+/*-----------------------------------------------------------*/
+
+static const char * parseSpec( const char * pFormat,
+                               FormatSpec_t * pSpec )
+{
+    const char * p = strchr( pFormat, '%' );
+
+    if( p == NULL )
+    {
+        return NULL;
+    }
+
+    memset( pSpec, 0, sizeof( *pSpec ) );
+    pSpec->pStart = p;
+    pSpec->precision = -1;
+    p++;
+
+    while( ( *p != '\0' ) && ( strchr( "-+ #0", *p ) != NULL ) )
+    {
+        p++;
+    }
+
+    if( *p == '*' )
+    {
+        pSpec->widthStar = true;
+        p++;
+    }
+    else
+    {
+        while( ( *p >= '0' ) && ( *p <= '9' ) )
+        {
+            p++;
+        }
+    }
+
+    if( *p == '.' )
+    {
+        p++;
+
+        if( *p == '*' )
+        {
+            pSpec->precisionStar = true;
+            p++;
+        }
+        else
+        {
+            pSpec->precision = 0;
+
+            while( ( *p >= '0' ) && ( *p <= '9' ) )
+            {
+                pSpec->precision = ( pSpec->precision * 10 ) + ( *p - '0' );
+                p++;
+            }
+        }
+    }
+
+    switch( *p )
+    {
+        case 'h':
+        case 'l':
+            pSpec->lengthModifier = *p;
+            p++;
+
+            if( *p == pSpec->lengthModifier )
+            {
+                pSpec->lengthModifier = ( *p == 'h' ) ? 'H' : 'q';
+                p++;
+            }
+
+            break;
+
+        case 'j':
+        case 'z':
+        case 't':
+        case 'L':
+            pSpec->lengthModifier = *p;
+            p++;
+            break;
+
+        default:
+            break;
+    }
+
+    pSpec->conversion = *p;
+
+    if( *p != '\0' )
+    {
+        p++;
+    }
+
+    pSpec->length = ( size_t ) ( p - pSpec->pStart );
+
+    return p;
+}
+
+/*-----------------------------------------------------------*/
+
+static ArgClass_t classify( const FormatSpec_t * pSpec )
+{
+    ArgClass_t argClass = ARG_UNSUPPORTED;
+
+    switch( pSpec->conversion )
+    {
+        case '%':
+            argClass = ARG_NONE;
+            break;
+
+        case 'c':
+            argClass = ( pSpec->lengthModifier == 0 ) ? ARG_INT : ARG_UNSUPPORTED;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+
+            switch( pSpec->lengthModifier )
+            {
+                case 0:
+                case 'H':
+                case 'h':
+                    argClass = ARG_INT;
+                    break;
+
+                case 'l':
+                    argClass = ARG_LONG;
+                    break;
+
+                case 'q':
+                    argClass = ARG_LONG_LONG;
+                    break;
+
+                case 'j':
+                    argClass = ARG_INTMAX;
+                    break;
+
+                case 'z':
+                    argClass = ARG_SIZE;
+                    break;
+
+                case 't':
+                    argClass = ARG_PTRDIFF;
+                    break;
+
+                default:
+                    break;
+            }
+
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            argClass = ( pSpec->lengthModifier == 'L' ) ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+            break;
+
+        case 'p':
+            argClass = ARG_POINTER;
+            break;
+
+        case 's':
+            argClass = ( pSpec->lengthModifier == 0 ) ? ARG_STRING : ARG_UNSUPPORTED;
+            break;
+
+        default:
+            break;
+    }
+
+    return argClass;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool put( uint8_t * pRecord,
+                 size_t * pUsed,
+                 const void * pValue,
+                 size_t length )
+{
+    if( ( LOG_DEFERRED_RECORD_MAX - *pUsed ) < length )
+    {
+        return false;
+    }
+
+    memcpy( &pRecord[ *pUsed ], pValue, length );
+    *pUsed += length;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool putString( uint8_t * pRecord,
+                       size_t * pUsed,
+                       const char * pString,
+                       int32_t precision )
+{
+    size_t limit = LOG_DEFERRED_STRING_MAX;
+    size_t length = 0U;
+    uint8_t lengthByte;
+
+    if( pString == NULL )
+    {
+        pString = "(null)";
+    }
+
+    /* A precision bounds the read, as for a string that is not terminated. */
+    if( ( precision >= 0 ) && ( ( size_t ) precision < limit ) )
+    {
+        limit = ( size_t ) precision;
+    }
+
+    if( limit > ( LOG_DEFERRED_RECORD_MAX - *pUsed ) )
+    {
+        limit = ( *pUsed < LOG_DEFERRED_RECORD_MAX ) ? ( LOG_DEFERRED_RECORD_MAX - *pUsed - 1U ) : 0U;
+    }
+
+    while( ( length < limit ) && ( pString[ length ] != '\0' ) )
+    {
+        length++;
+    }
+
+    lengthByte = ( uint8_t ) length;
+
+    return put( pRecord, pUsed, &lengthByte, 1U ) &&
+           put( pRecord, pUsed, pString, length );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy one argument after those already in the record.
+ *
+ * @return false if it did not fit.
+ */
+static bool captureArg( uint8_t * pRecord,
+                        size_t * pUsed,
+                        ArgClass_t argClass,
+                        int32_t precision,
+                        va_list * pArgs )
+{
+    bool room = true;
+
+    switch( argClass )
+    {
+        case ARG_INT:
+           {
+               int value = va_arg( *pArgs, int );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_LONG:
+           {
+               long value = va_arg( *pArgs, long );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_LONG_LONG:
+           {
+               long long value = va_arg( *pArgs, long long );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_INTMAX:
+           {
+               intmax_t value = va_arg( *pArgs, intmax_t );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_SIZE:
+           {
+               size_t value = va_arg( *pArgs, size_t );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_PTRDIFF:
+           {
+               ptrdiff_t value = va_arg( *pArgs, ptrdiff_t );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_DOUBLE:
+           {
+               double value = va_arg( *pArgs, double );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_LONG_DOUBLE:
+           {
+               long double value = va_arg( *pArgs, long double );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_POINTER:
+           {
+               void * value = va_arg( *pArgs, void * );
+               room = put( pRecord, pUsed, &value, sizeof( value ) );
+               break;
+           }
+
+        case ARG_STRING:
+            room = putString( pRecord, pUsed, va_arg( *pArgs, const char * ), precision );
+            break;
+
+        default:
+            break;
+    }
+
+    return room;
+}
+
+/*-----------------------------------------------------------*/
+
+static void layoutAdd( uint32_t * pLayout,
+                       uint32_t * pSlot,
+                       ArgClass_t argClass )
+{
+    if( *pSlot < LAYOUT_SLOTS )
+    {
+        *pLayout |= ( uint32_t ) argClass << ( *pSlot * LAYOUT_BITS );
+    }
+    else
+    {
+        *pLayout |= LAYOUT_PARSE;
+    }
+
+    ( *pSlot )++;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy the arguments of a log call after the record header, as its
+ * format asks for them.
+ *
+ * @param[out] pLayout The argument layout of the format, or 0 if the record
+ * filled up before the format was parsed to the end.
+ *
+ * @return Bytes of the record used.
+ */
+static size_t capture( uint8_t * pRecord,
+                       const char * pFormat,
+                       va_list * pArgs,
+                       uint32_t * pLayout )
+{
+    size_t used = sizeof( RecordHeader_t );
+    FormatSpec_t spec;
+    bool room = true;
+    uint32_t layout = LAYOUT_VALID;
+    uint32_t slot = 0U;
+
+    while( room && ( ( pFormat = parseSpec( pFormat, &spec ) ) != NULL ) )
+    {
+        ArgClass_t argClass = classify( &spec );
+        int32_t precision = spec.precision;
+
+        if( argClass == ARG_UNSUPPORTED )
+        {
+            break;
+        }
+
+        if( spec.widthStar )
+        {
+            int width = va_arg( *pArgs, int );
+
+            room = put( pRecord, &used, &width, sizeof( width ) );
+            layoutAdd( &layout, &slot, ARG_INT );
+        }
+
+        if( room && spec.precisionStar )
+        {
+            int starPrecision = va_arg( *pArgs, int );
+
+            precision = starPrecision;
+            room = put( pRecord, &used, &starPrecision, sizeof( starPrecision ) );
+            layoutAdd( &layout, &slot, ARG_PRECISION );
+        }
+
+        if( room && ( argClass != ARG_NONE ) )
+        {
+            room = captureArg( pRecord, &used, argClass, precision, pArgs );
+            layoutAdd( &layout, &slot, argClass );
+        }
+
+        /* A layout holds no literal precisions. */
+        if( ( argClass == ARG_STRING ) && !spec.precisionStar && ( spec.precision >= 0 ) )
+        {
+            layout |= LAYOUT_PARSE;
+        }
+    }
+
+    *pLayout = room ? layout : 0U;
+
+    return used;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy the arguments of a log call after the record header, as a
+ * layout cached by capture() asks for them.
+ *
+ * @return Bytes of the record used.
+ */
+static size_t captureLayout( uint8_t * pRecord,
+                             uint32_t layout,
+                             va_list * pArgs )
+{
+    size_t used = sizeof( RecordHeader_t );
+    int32_t precision = -1;
+    bool room = true;
+    ArgClass_t argClass;
+
+    layout &= LAYOUT_ARGS;
+
+    while( room && ( ( argClass = ( ArgClass_t ) ( layout & LAYOUT_CLASS ) ) != ARG_NONE ) )
+    {
+        if( argClass == ARG_PRECISION )
+        {
+            int starPrecision = va_arg( *pArgs, int );
+
+            precision = starPrecision;
+            room = put( pRecord, &used, &starPrecision, sizeof( starPrecision ) );
+        }
+        else
+        {
+            room = captureArg( pRecord, &used, argClass, precision, pArgs );
+            precision = -1;
+        }
+
+        layout >>= LAYOUT_BITS;
+    }
+
+    return used;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool take( const uint8_t * pRecord,
+                  size_t length,
+                  size_t * pOffset,
+                  void * pValue,
+                  size_t valueLength )
+{
+    if( ( length - *pOffset ) < valueLength )
+    {
+        return false;
+    }
+
+    memcpy( pValue, &pRecord[ *pOffset ], valueLength );
+    *pOffset += valueLength;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void append( char * pLine,
+                    size_t * pPosition,
+                    const char * pText,
+                    size_t length )
+{
+    size_t space = LOG_DEFERRED_LINE_MAX - 1U - *pPosition;
+
+    if( length > space )
+    {
+        length = space;
+    }
+
+    memcpy( &pLine[ *pPosition ], pText, length );
+    *pPosition += length;
+    pLine[ *pPosition ] = '\0';
+}
+
+/*-----------------------------------------------------------*/
+
+/* Format one captured argument with the conversion text in specText and
+ * the star arguments in stars. */
+#define FORMAT_ARG( value )                                                                               \
+    ( ( starCount == 0U ) ? snprintf( &pLine[ *pPosition ], space, specText, value ) :                    \
+      ( starCount == 1U ) ? snprintf( &pLine[ *pPosition ], space, specText, stars[ 0 ], value ) :        \
+      snprintf( &pLine[ *pPosition ], space, specText, stars[ 0 ], stars[ 1 ], value ) )
+
+#define TAKE_AND_FORMAT( type )                                                  \
+    do                                                                           \
+    {                                                                            \
+        type value;                                                              \
+        if( !take( pRecord, length, pOffset, &value, sizeof( value ) ) )         \
+        {                                                                        \
+            return false;                                                        \
+        }                                                                        \
+        written = FORMAT_ARG( value );                                           \
+    } while( 0 )
+
+/**
+ * @brief Format the captured argument of one conversion onto the line.
+ *
+ * @return false once the record has no more arguments.
+ */
+static bool formatArg( const FormatSpec_t * pSpec,
+                       ArgClass_t argClass,
+                       const uint8_t * pRecord,
+                       size_t length,
+                       size_t * pOffset,
+                       char * pLine,
+                       size_t * pPosition )
+{
+    char specText[ 16 ];
+    char string[ LOG_DEFERRED_STRING_MAX + 1U ];
+    int stars[ 2 ];
+    size_t starCount = 0U;
+    size_t space = LOG_DEFERRED_LINE_MAX - *pPosition;
+    int written = 0;
+
+    if( pSpec->length >= sizeof( specText ) )
+    {
+        return false;
+    }
+
+    memcpy( specText, pSpec->pStart, pSpec->length );
+    specText[ pSpec->length ] = '\0';
+
+    if( pSpec->widthStar &&
+        !take( pRecord, length, pOffset, &stars[ starCount++ ], sizeof( int ) ) )
+    {
+        return false;
+    }
+
+    if( pSpec->precisionStar &&
+        !take( pRecord, length, pOffset, &stars[ starCount++ ], sizeof( int ) ) )
+    {
+        return false;
+    }
+
+    switch( argClass )
+    {
+        case ARG_INT:
+            TAKE_AND_FORMAT( int );
+            break;
+
+        case ARG_LONG:
+            TAKE_AND_FORMAT( long );
+            break;
+
+        case ARG_LONG_LONG:
+            TAKE_AND_FORMAT( long long );
+            break;
+
+        case ARG_INTMAX:
+            TAKE_AND_FORMAT( intmax_t );
+            break;
+
+        case ARG_SIZE:
+            TAKE_AND_FORMAT( size_t );
+            break;
+
+        case ARG_PTRDIFF:
+            TAKE_AND_FORMAT( ptrdiff_t );
+            break;
+
+        case ARG_DOUBLE:
+            TAKE_AND_FORMAT( double );
+            break;
+
+        case ARG_LONG_DOUBLE:
+            TAKE_AND_FORMAT( long double );
+            break;
+
+        case ARG_POINTER:
+            TAKE_AND_FORMAT( void * );
+            break;
+
+        case ARG_STRING:
+           {
+               uint8_t stringLength;
+
+               if( !take( pRecord, length, pOffset, &stringLength, 1U ) ||
+                   !take( pRecord, length, pOffset, string, stringLength ) )
+               {
+                   return false;
+               }
+
+               string[ stringLength ] = '\0';
+               written = FORMAT_ARG( string );
+               break;
+           }
+
+        default:
+            return false;
+    }
+
+    if( written > 0 )
+    {
+        *pPosition += ( ( size_t ) written < space ) ? ( size_t ) written : ( space - 1U );
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void formatRecord( const uint8_t * pRecord,
+                          size_t length,
+                          LogDeferredSink_t sink,
+                          void * pContext )
+{
+    RecordHeader_t header;
+    char line[ LOG_DEFERRED_LINE_MAX ];
+    const char * pFormat;
+    const char * pNext;
+    FormatSpec_t spec;
+    size_t position = 0U;
+    size_t offset = sizeof( RecordHeader_t );
+    bool complete = true;
+
+    memcpy( &header, pRecord, sizeof( header ) );
+    pFormat = header.pSite->pFormat;
+    line[ 0 ] = '\0';
+
+    while( ( pNext = parseSpec( pFormat, &spec ) ) != NULL )
+    {
+        ArgClass_t argClass = classify( &spec );
+
+        append( line, &position, pFormat, ( size_t ) ( spec.pStart - pFormat ) );
+
+        if( argClass == ARG_NONE )
+        {
+            append( line, &position, "%", 1U );
+        }
+        else if( !formatArg( &spec, argClass, pRecord, length, &offset, line, &position ) )
+        {
+            complete = false;
+            break;
+        }
+
+        pFormat = pNext;
+    }
+
+    if( complete )
+    {
+        append( line, &position, pFormat, strlen( pFormat ) );
+    }
+    else
+    {
+        append( line, &position, "...", 3U );
+    }
+
+    sink( pContext, header.pSite, header.timestampMs, line );
+}
+
+/*-----------------------------------------------------------*/
+
+static void defaultSink( void * pContext,
+                         const LogDeferredSite_t * pSite,
+                         uint32_t timestampMs,
+                         const char * pLine )
+{
+    static const char letters[] = "NEWIDV";
+    uint8_t level = ( pSite->level <= 5U ) ? pSite->level : 5U;
+
+    ( void ) pContext;
+
+    #ifdef ESP_PLATFORM
+        static const char * const colors[] = { "", LOG_COLOR_E, LOG_COLOR_W, LOG_COLOR_I, LOG_COLOR_D, LOG_COLOR_V };
+
+        esp_log_write( ( esp_log_level_t ) level, pSite->pTag, "%s%c (%u) %s: %s" LOG_RESET_COLOR "\n",
+                       colors[ level ], letters[ level ], ( unsigned ) timestampMs, pSite->pTag, pLine );
+    #else
+        fprintf( stderr, "%c (%u) %s: %s\n", letters[ level ], ( unsigned ) timestampMs, pSite->pTag, pLine );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reserve @p length bytes of the ring, inserting a padding record if
+ * they would straddle its end.
+ *
+ * @return The reserved space, or NULL if the ring is full.
+ */
+static uint8_t * reserve( uint32_t length )
+{
+    uint32_t head = __atomic_load_n( &reserveHead, __ATOMIC_RELAXED );
+    uint32_t offset;
+    uint32_t padding;
+
+    do
+    {
+        /* Acquire, so the consumer's clearing of freed control words is
+         * visible before the space is reused. */
+        uint32_t tail = __atomic_load_n( &readTail, __ATOMIC_ACQUIRE );
+
+        offset = head & BUFFER_MASK;
+        padding = ( ( LOG_DEFERRED_BUFFER_SIZE - offset ) < length ) ? ( LOG_DEFERRED_BUFFER_SIZE - offset ) : 0U;
+
+        if( ( ( head + padding + length ) - tail ) > LOG_DEFERRED_BUFFER_SIZE )
+        {
+            return NULL;
+        }
+    } while( !__atomic_compare_exchange_n( &reserveHead, &head, head + padding + length, true,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) );
+
+    if( padding > 0U )
+    {
+        __atomic_store_n( ( uint32_t * ) &ring[ offset ], padding | CONTROL_COMMITTED | CONTROL_PADDING,
+                          __ATOMIC_RELEASE );
+    }
+
+    return &ring[ ( head + padding ) & BUFFER_MASK ];
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t drainRecords( LogDeferredSink_t sink,
+                            void * pContext,
+                            size_t maxRecords )
+{
+    uint32_t tail = __atomic_load_n( &readTail, __ATOMIC_RELAXED );
+    size_t drained = 0U;
+
+    while( ( drained < maxRecords ) && ( tail != __atomic_load_n( &reserveHead, __ATOMIC_ACQUIRE ) ) )
+    {
+        uint32_t * pControl = ( uint32_t * ) &ring[ tail & BUFFER_MASK ];
+        uint32_t control = __atomic_load_n( pControl, __ATOMIC_ACQUIRE );
+        uint32_t length = control & CONTROL_LENGTH;
+
+        /* Records are freed in order, so one still being written holds up
+         * those after it. */
+        if( ( control & CONTROL_COMMITTED ) == 0U )
+        {
+            break;
+        }
+
+        if( ( control & CONTROL_PADDING ) == 0U )
+        {
+            formatRecord( ( const uint8_t * ) pControl, length, sink, pContext );
+            drained++;
+        }
+
+        /* Clear the whole span, not just the control word: a later record
+         * may start anywhere in it, and until that record is committed the
+         * word at its start must not read as a control word. */
+        memset( pControl, 0, ALIGN_UP( length ) );
+        tail += ALIGN_UP( length );
+        __atomic_store_n( &readTail, tail, __ATOMIC_RELEASE );
+    }
+
+    return drained;
+}
+
+/*-----------------------------------------------------------*/
+
+static void reportDrops( LogDeferredSink_t sink,
+                         void * pContext,
+                         uint32_t * pReported )
+{
+    static const LogDeferredSite_t dropSite = { 2U, "log_deferred", "%u records dropped", NULL };
+    uint32_t dropped = __atomic_load_n( &stats.dropped, __ATOMIC_RELAXED );
+    char line[ 32 ];
+
+    if( dropped != *pReported )
+    {
+        ( void ) snprintf( line, sizeof( line ), dropSite.pFormat, ( unsigned ) ( dropped - *pReported ) );
+        sink( pContext, &dropSite, Clock_GetTimeMs(), line );
+        *pReported = dropped;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void drainLoop( void * pvParameters )
+{
+    uint32_t reported = 0U;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        /* One pass serves every record signalled so far. */
+        while( osi_event_wait( &recordsPending, 0U ) == 0 )
+        {
+        }
+
+        ( void ) drainRecords( taskSink, taskContext, SIZE_MAX );
+        reportDrops( taskSink, taskContext, &reported );
+        ( void ) osi_event_wait( &recordsPending, OSI_EVENT_MAX_TIMEOUT );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LogDeferred_Write( const LogDeferredSite_t * pSite,
+                        ... )
+{
+    uint64_t recordStorage[ ( LOG_DEFERRED_RECORD_MAX + 7U ) / 8U ];
+    uint8_t * pRecord = ( uint8_t * ) recordStorage;
+    RecordHeader_t header;
+    uint8_t * pSlot;
+    size_t used;
+    uint32_t cached;
+    uint32_t layout;
+    va_list args;
+
+    if( pSite->level > __atomic_load_n( &maxLevel, __ATOMIC_RELAXED ) )
+    {
+        return;
+    }
+
+    /* Racing first calls of a site compute the same layout. */
+    cached = ( pSite->pLayout != NULL ) ? __atomic_load_n( pSite->pLayout, __ATOMIC_RELAXED ) : 0U;
+
+    va_start( args, pSite );
+
+    if( ( cached & ( LAYOUT_VALID | LAYOUT_PARSE ) ) == LAYOUT_VALID )
+    {
+        used = captureLayout( pRecord, cached, &args );
+    }
+    else
+    {
+        used = capture( pRecord, pSite->pFormat, &args, &layout );
+
+        if( ( pSite->pLayout != NULL ) && ( cached == 0U ) && ( layout != 0U ) )
+        {
+            __atomic_store_n( pSite->pLayout, layout, __ATOMIC_RELAXED );
+        }
+    }
+
+    va_end( args );
+
+    pSlot = reserve( ALIGN_UP( ( uint32_t ) used ) );
+
+    if( pSlot == NULL )
+    {
+        __atomic_add_fetch( &stats.dropped, 1U, __ATOMIC_RELAXED );
+        return;
+    }
+
+    header.control = 0U;
+    header.timestampMs = Clock_GetTimeMs();
+    header.pSite = pSite;
+    memcpy( pRecord, &header, sizeof( header ) );
+
+    /* The control word, which the consumer polls, is left to the atomic
+     * store that publishes the record. */
+    memcpy( &pSlot[ sizeof( uint32_t ) ], &pRecord[ sizeof( uint32_t ) ], used - sizeof( uint32_t ) );
+    __atomic_store_n( ( uint32_t * ) pSlot, ( uint32_t ) used | CONTROL_COMMITTED, __ATOMIC_RELEASE );
+    __atomic_add_fetch( &stats.written, 1U, __ATOMIC_RELAXED );
+
+    if( __atomic_load_n( &serviceState, __ATOMIC_ACQUIRE ) == STATE_RUNNING )
+    {
+        osi_event_signal( &recordsPending );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LogDeferred_SetLevel( uint8_t level )
+{
+    __atomic_store_n( &maxLevel, level, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
+
+bool LogDeferred_Start( LogDeferredSink_t sink,
+                        void * pContext )
+{
+    uint8_t expected = STATE_STOPPED;
+
+    if( !__atomic_compare_exchange_n( &serviceState, &expected, STATE_STARTING, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+    {
+        while( __atomic_load_n( &serviceState, __ATOMIC_ACQUIRE ) == STATE_STARTING )
+        {
+            vTaskDelay( 1 );
+        }
+
+        return __atomic_load_n( &serviceState, __ATOMIC_ACQUIRE ) == STATE_RUNNING;
+    }
+
+    taskSink = ( sink != NULL ) ? sink : defaultSink;
+    taskContext = pContext;
+    osi_event_init( &recordsPending, 0U );
+
+    if( xTaskCreate( drainLoop, "log_deferred", LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                     LOG_DEFERRED_TASK_PRIORITY, NULL ) != pdPASS )
+    {
+        osi_event_deinit( &recordsPending );
+        __atomic_store_n( &serviceState, STATE_STOPPED, __ATOMIC_RELEASE );
+        return false;
+    }
+
+    __atomic_store_n( &serviceState, STATE_RUNNING, __ATOMIC_RELEASE );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t LogDeferred_Drain( LogDeferredSink_t sink,
+                          void * pContext,
+                          size_t maxRecords )
+{
+    return drainRecords( ( sink != NULL ) ? sink : defaultSink, pContext, maxRecords );
+}
+
+/*-----------------------------------------------------------*/
+
+void LogDeferred_GetStats( LogDeferredStats_t * pStats )
+{
+    pStats->written = __atomic_load_n( &stats.written, __ATOMIC_RELAXED );
+    pStats->dropped = __atomic_load_n( &stats.dropped, __ATOMIC_RELAXED );
+}
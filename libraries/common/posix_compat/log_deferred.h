@@ -0,0 +1,239 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file log_deferred.h
+ * @brief Deferred logging: log sites record, a low priority task formats.
+ *
+ * A log call through #LOG_DEFERRED copies its raw arguments, with strings
+ * truncated to #LOG_DEFERRED_STRING_MAX, into a record in a lock-free ring
+ * buffer and returns. Formatting and output happen later, in the task
+ * started by LogDeferred_Start() or in a LogDeferred_Drain() call, so a hot
+ * path such as the MQTT receive callback no longer waits for printf and the
+ * console. Records that do not fit in the buffer are dropped and counted.
+ *
+ * Records logged before LogDeferred_Start() wait in the buffer and are
+ * written once the task runs.
+ *
+ * Calls above the level set with LogDeferred_SetLevel() return before
+ * anything is captured. esp_log_level_get() is not available on the
+ * supported IDF releases, so that level is kept here: set it together with
+ * esp_log_level_set(), which otherwise only filters records when they are
+ * written out.
+ *
+ * The first call from a site parses its format and caches the argument
+ * layout in a word per site, so later calls copy their arguments without
+ * looking at the format. Formats with more than 7 arguments, counting star
+ * widths and precisions, or with a %s of literal precision, are parsed on
+ * every call; that walks the format but still formats nothing.
+ *
+ * Records refer to their site by address, so only the program that wrote
+ * them can format them. There is no offline decoder.
+ *
+ * Log calls must not be made from interrupts.
+ */
+
+#ifndef LOG_DEFERRED_H_
+#define LOG_DEFERRED_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+#endif
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief Size of the ring buffer in bytes. Must be a power of 2.
+ */
+#ifndef LOG_DEFERRED_BUFFER_SIZE
+    #ifdef CONFIG_LOG_DEFERRED_BUFFER_SIZE
+        #define LOG_DEFERRED_BUFFER_SIZE    CONFIG_LOG_DEFERRED_BUFFER_SIZE
+    #else
+        #define LOG_DEFERRED_BUFFER_SIZE    ( 4096U )
+    #endif
+#endif
+
+/**
+ * @brief Largest record, header included. Arguments that do not fit are
+ * left out and the line ends in "...".
+ */
+#ifndef LOG_DEFERRED_RECORD_MAX
+    #define LOG_DEFERRED_RECORD_MAX    ( 128U )
+#endif
+
+/**
+ * @brief Characters of a string argument kept in a record.
+ */
+#ifndef LOG_DEFERRED_STRING_MAX
+    #define LOG_DEFERRED_STRING_MAX    ( 48U )
+#endif
+
+/**
+ * @brief Longest formatted line handed to a sink, terminator included.
+ */
+#ifndef LOG_DEFERRED_LINE_MAX
+    #define LOG_DEFERRED_LINE_MAX    ( 256U )
+#endif
+
+/**
+ * @brief Most verbose level recorded until LogDeferred_SetLevel() is called;
+ * the ESP_LOGx default level on the device, everything on the host.
+ */
+#ifndef LOG_DEFERRED_DEFAULT_LEVEL
+    #ifdef CONFIG_LOG_DEFAULT_LEVEL
+        #define LOG_DEFERRED_DEFAULT_LEVEL    CONFIG_LOG_DEFAULT_LEVEL
+    #else
+        #define LOG_DEFERRED_DEFAULT_LEVEL    ( 5U )
+    #endif
+#endif
+
+/**
+ * @brief A log site. One is created per #LOG_DEFERRED call site, and records
+ * refer to it by address, so the format string is never copied.
+ */
+typedef struct LogDeferredSite
+{
+    uint8_t level;         /**< @brief esp_log_level_t, which numbers levels as logging_levels.h. */
+    const char * pTag;     /**< @brief Module tag, e.g. LIBRARY_LOG_NAME. */
+    const char * pFormat;  /**< @brief printf format of the message. */
+    uint32_t * pLayout;    /**< @brief Argument layout cached by the first call, 0 until then; NULL to not cache. */
+} LogDeferredSite_t;
+
+/**
+ * @brief Receives formatted lines.
+ *
+ * @param[in] pContext Context given to LogDeferred_Start() or
+ * LogDeferred_Drain().
+ * @param[in] pSite Site of the log call.
+ * @param[in] timestampMs Clock_GetTimeMs() at the log call.
+ * @param[in] pLine The formatted message, without a line ending.
+ */
+typedef void ( * LogDeferredSink_t )( void * pContext,
+                                      const LogDeferredSite_t * pSite,
+                                      uint32_t timestampMs,
+                                      const char * pLine );
+
+/**
+ * @brief Log counters.
+ */
+typedef struct LogDeferredStats
+{
+    uint32_t written; /**< @brief Records queued. */
+    uint32_t dropped; /**< @brief Records dropped because the buffer was full. */
+} LogDeferredStats_t;
+
+/**
+ * @brief Log a message through the deferred backend.
+ *
+ * @param[in] level esp_log_level_t of the message.
+ * @param[in] tag Module tag, which must live as long as the program.
+ * @param[in] ... String literal printf format, then its arguments. Passed on
+ * through another macro, so REMOVE_PARENS( message ) works here.
+ */
+#define LOG_DEFERRED( level, tag, ... )    LOG_DEFERRED_SITE( level, tag, __VA_ARGS__ )
+
+#define LOG_DEFERRED_SITE( level, tag, format, ... )                                            \
+    do                                                                                          \
+    {                                                                                           \
+        static uint32_t logDeferredLayout;                                                      \
+        static const LogDeferredSite_t logDeferredSite =                                        \
+        { ( uint8_t ) ( level ), tag, format, &logDeferredLayout };                             \
+        if( false )                                                                             \
+        {                                                                                       \
+            LogDeferred_CheckFormat( format, ## __VA_ARGS__ );                                  \
+        }                                                                                       \
+        LogDeferred_Write( &logDeferredSite, ## __VA_ARGS__ );                                  \
+    } while( 0 )
+
+/**
+ * @brief Never called; lets the compiler check the arguments of a
+ * #LOG_DEFERRED against its format, which LogDeferred_Write() relies on.
+ */
+static inline void __attribute__( ( format( printf, 1, 2 ) ) ) LogDeferred_CheckFormat( const char * pFormat,
+                                                                                         ... )
+{
+    ( void ) pFormat;
+}
+
+/**
+ * @brief Record a log call. Use #LOG_DEFERRED rather than calling this.
+ *
+ * Returns at once if the site's level is above the one set with
+ * LogDeferred_SetLevel(). Otherwise the arguments are copied as the site's
+ * cached layout, or on the first call its format, asks for them.
+ *
+ * Supports the printf conversions except %n and wide characters, with the
+ * usual flags, widths, precisions and length modifiers.
+ *
+ * @param[in] pSite Site of the log call.
+ */
+void LogDeferred_Write( const LogDeferredSite_t * pSite,
+                        ... );
+
+/**
+ * @brief Set the most verbose level recorded. May be called at any time from
+ * any task.
+ *
+ * @param[in] level esp_log_level_t; ESP_LOG_NONE records nothing.
+ */
+void LogDeferred_SetLevel( uint8_t level );
+
+/**
+ * @brief Start the task that formats queued records and passes them to
+ * @p sink. Later calls do nothing.
+ *
+ * @param[in] sink Receives the formatted lines, or NULL to write them with
+ * esp_log_write() in the ESP_LOGx format, or to stderr on the host.
+ * @param[in] pContext Passed to @p sink.
+ *
+ * @return `true` once the task runs, `false` if it could not be created.
+ */
+bool LogDeferred_Start( LogDeferredSink_t sink,
+                        void * pContext );
+
+/**
+ * @brief Format queued records on the calling task, e.g. in a host program
+ * that does not start the task. Only one task may drain at a time, and not
+ * while the task of LogDeferred_Start() runs.
+ *
+ * @param[in] sink Receives the formatted lines; NULL for the default.
+ * @param[in] pContext Passed to @p sink.
+ * @param[in] maxRecords Most records to format.
+ *
+ * @return Number of records formatted.
+ */
+size_t LogDeferred_Drain( LogDeferredSink_t sink,
+                          void * pContext,
+                          size_t maxRecords );
+
+/**
+ * @brief Read the log counters.
+ */
+void LogDeferred_GetStats( LogDeferredStats_t * pStats );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef LOG_DEFERRED_H_ */
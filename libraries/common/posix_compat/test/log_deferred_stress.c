@@ -0,0 +1,291 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file log_deferred_stress.c
+ * @brief Host stress test of the deferred log ring.
+ *
+ * Includes log_deferred.c to reach the ring itself. Three parts:
+ *
+ * - Stale words: fills the ring with records whose arguments are all ones,
+ *   drains it, then reserves, without committing, records that start where
+ *   those arguments were. The drain must stop at the reservation instead of
+ *   reading the stale bytes as a committed control word.
+ * - Layouts: the cached argument layout of a site must capture exactly what
+ *   parsing its format does.
+ * - Producers: tasks log records of varying length through a small ring
+ *   while the drain task formats them. Every line must be intact, in order
+ *   per producer, and written plus dropped must add up; logging must still
+ *   work afterwards.
+ *
+ * Exits with 0 on success, or prints the failed check and exits with 1. Best
+ * run under -fsanitize=thread as well.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log_deferred.c"
+
+/*-----------------------------------------------------------*/
+
+#define STRESS_PRODUCERS          ( 4 )
+#define STRESS_RECORDS            ( 20000 )
+#define STRESS_DRAIN_TIMEOUT_MS   ( 10000U )
+
+#define CHECK( condition )                                                      \
+    do                                                                          \
+    {                                                                           \
+        if( !( condition ) )                                                    \
+        {                                                                       \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition ); \
+            exit( 1 );                                                          \
+        }                                                                       \
+    } while( 0 )
+
+static char lastLine[ LOG_DEFERRED_LINE_MAX ];
+static uint32_t linesSeen;
+
+/* Written by the sink of the producer part in the drain task, and read by
+ * the main task once producerLines shows that every line was seen. */
+static int32_t nextRecord[ STRESS_PRODUCERS ];
+static uint32_t producerLines;
+static uint32_t badLines;
+
+static TaskHandle_t mainTask;
+
+/*-----------------------------------------------------------*/
+
+static void copySink( void * pContext,
+                      const LogDeferredSite_t * pSite,
+                      uint32_t timestampMs,
+                      const char * pLine )
+{
+    ( void ) pContext;
+    ( void ) pSite;
+    ( void ) timestampMs;
+
+    ( void ) snprintf( lastLine, sizeof( lastLine ), "%s", pLine );
+    linesSeen++;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t ringUsed( void )
+{
+    return __atomic_load_n( &reserveHead, __ATOMIC_ACQUIRE ) - __atomic_load_n( &readTail, __ATOMIC_ACQUIRE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void testStaleControlWords( void )
+{
+    uint32_t recordLength = ALIGN_UP( ( uint32_t ) sizeof( RecordHeader_t ) );
+    int i;
+
+    /* Every argument byte all ones, at every offset the ring has. */
+    for( i = 0; i < ( int ) ( LOG_DEFERRED_BUFFER_SIZE / 8U ); i++ )
+    {
+        LOG_DEFERRED( 3, "stale", "%d %d %d %d %d", -1, -1, -1, -1, -1 );
+    }
+
+    while( LogDeferred_Drain( copySink, NULL, SIZE_MAX ) > 0U )
+    {
+    }
+
+    CHECK( ringUsed() == 0U );
+
+    /* Walk the head across the old records in steps that are not a multiple
+     * of their length, so reservations land on stale argument bytes. */
+    for( i = 0; i < ( int ) ( LOG_DEFERRED_BUFFER_SIZE / recordLength ); i++ )
+    {
+        uint8_t * pSlot;
+
+        LOG_DEFERRED( 3, "stale", "committed" );
+        pSlot = reserve( recordLength );
+        CHECK( pSlot != NULL );
+
+        linesSeen = 0U;
+        ( void ) LogDeferred_Drain( copySink, NULL, SIZE_MAX );
+        CHECK( linesSeen == 1U );
+        CHECK( strcmp( lastLine, "committed" ) == 0 );
+
+        /* Stopped at the reservation: neither freed nor skipped past. */
+        CHECK( ( ringUsed() >= recordLength ) && ( ringUsed() <= LOG_DEFERRED_BUFFER_SIZE ) );
+
+        /* Give the reservation back as padding. */
+        __atomic_store_n( ( uint32_t * ) pSlot, recordLength | CONTROL_COMMITTED | CONTROL_PADDING, __ATOMIC_RELEASE );
+        ( void ) LogDeferred_Drain( copySink, NULL, SIZE_MAX );
+        CHECK( ringUsed() == 0U );
+    }
+
+    LOG_DEFERRED( 3, "stale", "after %d", 1 );
+    CHECK( LogDeferred_Drain( copySink, NULL, SIZE_MAX ) == 1U );
+    CHECK( strcmp( lastLine, "after 1" ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void testLayouts( void )
+{
+    static const char topic[] = "devices/thing/ota/job";
+    char expected[ LOG_DEFERRED_LINE_MAX ];
+    int i;
+
+    for( i = 0; i < 3; i++ )
+    {
+        /* The first pass parses and caches, the others use the layouts. */
+        LOG_DEFERRED( 3, "layout", "[%*d][%.*s][%s][%lld][%zu][%c][%%][%p][%.2f]",
+                      5, i, i + 3, topic, "tail", ( long long ) i << 40, ( size_t ) 42, 'q', ( void * ) 0x10, 1.5 );
+        ( void ) snprintf( expected, sizeof( expected ), "[%*d][%.*s][%s][%lld][%zu][%c][%%][%p][%.2f]",
+                           5, i, i + 3, topic, "tail", ( long long ) i << 40, ( size_t ) 42, 'q', ( void * ) 0x10, 1.5 );
+        CHECK( LogDeferred_Drain( copySink, NULL, 1U ) == 1U );
+        CHECK( strcmp( lastLine, expected ) == 0 );
+
+        /* Literal string precisions are never cached. */
+        LOG_DEFERRED( 3, "layout", "%.4s %d", topic, i );
+        ( void ) snprintf( expected, sizeof( expected ), "%.4s %d", topic, i );
+        CHECK( LogDeferred_Drain( copySink, NULL, 1U ) == 1U );
+        CHECK( strcmp( lastLine, expected ) == 0 );
+
+        /* More arguments than a layout holds. */
+        LOG_DEFERRED( 3, "layout", "%d %d %d %d %d %d %d %d %d", i, 1, 2, 3, 4, 5, 6, 7, 8 );
+        ( void ) snprintf( expected, sizeof( expected ), "%d %d %d %d %d %d %d %d %d", i, 1, 2, 3, 4, 5, 6, 7, 8 );
+        CHECK( LogDeferred_Drain( copySink, NULL, 1U ) == 1U );
+        CHECK( strcmp( lastLine, expected ) == 0 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void stressSink( void * pContext,
+                        const LogDeferredSite_t * pSite,
+                        uint32_t timestampMs,
+                        const char * pLine )
+{
+    int producer;
+    int record;
+    int length;
+    int consumed = 0;
+
+    ( void ) pContext;
+    ( void ) timestampMs;
+
+    /* Drop reports. */
+    if( strcmp( pSite->pTag, "stress" ) != 0 )
+    {
+        return;
+    }
+
+    if( ( sscanf( pLine, "p%d r%d l%d %n", &producer, &record, &length, &consumed ) != 3 ) ||
+        ( producer < 0 ) || ( producer >= STRESS_PRODUCERS ) ||
+        ( record < nextRecord[ producer ] ) || ( length != ( record % 40 ) ) ||
+        ( strlen( &pLine[ consumed ] ) != ( size_t ) length + 2U ) )
+    {
+        fprintf( stderr, "bad line: %s\n", pLine );
+        badLines++;
+    }
+    else
+    {
+        nextRecord[ producer ] = record + 1;
+    }
+
+    /* Publishes the checks above to the main task. */
+    __atomic_add_fetch( &producerLines, 1U, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void producerTask( void * pvParameters )
+{
+    static const char filler[] = "........................................";
+    int producer = ( int ) ( intptr_t ) pvParameters;
+    int record;
+
+    for( record = 0; record < STRESS_RECORDS; record++ )
+    {
+        int length = record % 40;
+
+        LOG_DEFERRED( 3, "stress", "p%d r%d l%d <%.*s>", producer, record, length, length, filler );
+
+        if( ( record % 64 ) == 0 )
+        {
+            vTaskDelay( 1 );
+        }
+    }
+
+    ( void ) xTaskNotifyGive( mainTask );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void testProducers( void )
+{
+    LogDeferredStats_t before;
+    LogDeferredStats_t after;
+    uint32_t waitedMs = 0U;
+    int i;
+
+    LogDeferred_GetStats( &before );
+    mainTask = xTaskGetCurrentTaskHandle();
+    CHECK( LogDeferred_Start( stressSink, NULL ) );
+
+    for( i = 0; i < STRESS_PRODUCERS; i++ )
+    {
+        CHECK( xTaskCreate( producerTask, "producer", 4096, ( void * ) ( intptr_t ) i, 5, NULL ) == pdPASS );
+    }
+
+    for( i = 0; i < STRESS_PRODUCERS; i++ )
+    {
+        ( void ) ulTaskNotifyTake( pdFALSE, portMAX_DELAY );
+    }
+
+    /* Then one more record, which must not be dropped. */
+    vTaskDelay( pdMS_TO_TICKS( 100 ) );
+    LogDeferred_GetStats( &after );
+    LOG_DEFERRED( 3, "stress", "p0 r%d l%d <%.*s>", STRESS_RECORDS, STRESS_RECORDS % 40, STRESS_RECORDS % 40,
+                  "........................................" );
+
+    do
+    {
+        vTaskDelay( pdMS_TO_TICKS( 10 ) );
+        waitedMs += 10U;
+        LogDeferred_GetStats( &after );
+    } while( ( __atomic_load_n( &producerLines, __ATOMIC_ACQUIRE ) < ( after.written - before.written ) ) &&
+             ( waitedMs < STRESS_DRAIN_TIMEOUT_MS ) );
+
+    printf( "producers: %u written, %u dropped, %u formatted\n",
+            ( unsigned ) ( after.written - before.written ), ( unsigned ) ( after.dropped - before.dropped ),
+            ( unsigned ) __atomic_load_n( &producerLines, __ATOMIC_ACQUIRE ) );
+
+    CHECK( badLines == 0U );
+    CHECK( __atomic_load_n( &producerLines, __ATOMIC_ACQUIRE ) == after.written - before.written );
+    CHECK( ( after.written - before.written ) + ( after.dropped - before.dropped ) ==
+           ( uint32_t ) ( STRESS_PRODUCERS * STRESS_RECORDS ) + 1U );
+    CHECK( nextRecord[ 0 ] == STRESS_RECORDS + 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    testStaleControlWords();
+    testLayouts();
+    testProducers();
+
+    printf( "log_deferred_stress: passed\n" );
+
+    return 0;
+}
@@ -0,0 +1,442 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timer_wheel_model.c
+ * @brief Host test of the timer wheel against a brute force model.
+ *
+ * Two parts:
+ *
+ * - Model: random arm, cancel and advance on wheels of several resolutions,
+ *   with callbacks that re-arm and cancel timers, delays beyond the span of
+ *   the wheel and jumps of the clock. The model keeps the tick each armed
+ *   timer is due at and checks every callback against it, that no due timer
+ *   is left after an advance, and that TimerWheel_NextExpiryMs() is never
+ *   later than the earliest due timer.
+ * - Service: timers armed through timer_service.h, from a task and from a
+ *   callback, fire on the FreeRTOS software timer of the shim, never early.
+ *
+ * Exits with 0 on success, or prints the failed check and exits with 1.
+ * Options: -s seed, -r rounds.
+ */
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Platform clock include. */
+#include "clock.h"
+
+#include "timer_service.h"
+#include "timer_wheel.h"
+
+/*-----------------------------------------------------------*/
+
+#define MODEL_TIMERS             ( 48 )
+#define MODEL_OPS_PER_ROUND      ( 4000 )
+#define MODEL_NOT_ARMED          ( UINT64_MAX )
+
+#define SERVICE_TIMERS           ( 8 )
+#define SERVICE_WAIT_MS          ( 2000U )
+
+#define CHECK( condition )                                                      \
+    do                                                                          \
+    {                                                                           \
+        if( !( condition ) )                                                    \
+        {                                                                       \
+            fprintf( stderr, "%s:%d: check failed: %s (seed %" PRIu32 ")\n",  \
+                     __FILE__, __LINE__, #condition, seed );                    \
+            exit( 1 );                                                          \
+        }                                                                       \
+    } while( 0 )
+
+static uint32_t seed = 1U;
+static uint32_t randomState;
+
+static TimerWheel_t wheel;
+static TimerWheelNode_t nodes[ MODEL_TIMERS ];
+
+/* Tick each timer is due at, or MODEL_NOT_ARMED. */
+static uint64_t dueTick[ MODEL_TIMERS ];
+
+/* The first tick the wheel has not processed yet. */
+static uint64_t modelTick;
+
+/* State of the advance in progress. */
+static uint64_t advanceNowMs;
+static uint64_t advanceTargetTick;
+static uint64_t lastFiredTick;
+static uint32_t modelFired;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t nextRandom( void )
+{
+    /* xorshift32. */
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return randomState;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t randomDelayMs( void )
+{
+    uint32_t delayMs;
+
+    switch( nextRandom() % 8U )
+    {
+        case 0:
+            delayMs = 0U;
+            break;
+
+        case 1:
+            delayMs = nextRandom() % 16U;
+            break;
+
+        case 2:
+        case 3:
+            delayMs = nextRandom() % 1000U;
+            break;
+
+        case 4:
+            delayMs = nextRandom() % 100000U;
+            break;
+
+        case 5:
+            delayMs = nextRandom() % 10000000U;
+            break;
+
+        default:
+            /* Beyond the span of a wheel with a 1 ms tick. */
+            delayMs = nextRandom();
+            break;
+    }
+
+    return delayMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void modelArm( int index,
+                      uint64_t nowMs,
+                      uint64_t currentTick )
+{
+    uint32_t delayMs = randomDelayMs();
+    uint64_t expiryTick = ( nowMs + delayMs + wheel.tickMs - 1U ) / wheel.tickMs;
+
+    TimerWheel_Arm( &wheel, &nodes[ index ], nowMs, delayMs );
+
+    /* Never early, and an overdue timer runs on the next tick processed. */
+    dueTick[ index ] = ( expiryTick > currentTick ) ? expiryTick : currentTick;
+}
+
+/*-----------------------------------------------------------*/
+
+static void modelCancel( int index )
+{
+    TimerWheel_Cancel( &wheel, &nodes[ index ] );
+    dueTick[ index ] = MODEL_NOT_ARMED;
+}
+
+/*-----------------------------------------------------------*/
+
+static void modelCallback( TimerWheelNode_t * pNode,
+                           void * pArg )
+{
+    int index = ( int ) ( intptr_t ) pArg;
+    uint64_t tick = dueTick[ index ];
+
+    CHECK( pNode == &nodes[ index ] );
+    CHECK( !TimerWheel_IsArmed( pNode ) );
+    CHECK( tick != MODEL_NOT_ARMED );
+    CHECK( tick <= advanceTargetTick );
+    CHECK( tick >= lastFiredTick );
+
+    dueTick[ index ] = MODEL_NOT_ARMED;
+    lastFiredTick = tick;
+    modelFired++;
+
+    /* The wheel is on the tick after this one while the callback runs. */
+    switch( nextRandom() % 4U )
+    {
+        case 0:
+            modelArm( index, advanceNowMs, tick + 1U );
+            break;
+
+        case 1:
+            modelCancel( ( int ) ( nextRandom() % MODEL_TIMERS ) );
+            break;
+
+        case 2:
+            modelArm( ( int ) ( nextRandom() % MODEL_TIMERS ), advanceNowMs, tick + 1U );
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkState( void )
+{
+    uint64_t earliest = MODEL_NOT_ARMED;
+    uint64_t nextMs = TimerWheel_NextExpiryMs( &wheel );
+    int i;
+
+    for( i = 0; i < MODEL_TIMERS; i++ )
+    {
+        CHECK( TimerWheel_IsArmed( &nodes[ i ] ) == ( dueTick[ i ] != MODEL_NOT_ARMED ) );
+
+        if( dueTick[ i ] < earliest )
+        {
+            earliest = dueTick[ i ];
+        }
+    }
+
+    if( earliest == MODEL_NOT_ARMED )
+    {
+        CHECK( nextMs == TIMER_WHEEL_NEVER );
+    }
+    else
+    {
+        CHECK( nextMs <= earliest * wheel.tickMs );
+        CHECK( nextMs >= modelTick * wheel.tickMs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void modelAdvance( uint64_t nowMs )
+{
+    uint32_t fired;
+    int i;
+
+    advanceNowMs = nowMs;
+    advanceTargetTick = nowMs / wheel.tickMs;
+    lastFiredTick = 0U;
+    modelFired = 0U;
+
+    fired = TimerWheel_Advance( &wheel, nowMs );
+    CHECK( fired == modelFired );
+
+    if( advanceTargetTick + 1U > modelTick )
+    {
+        modelTick = advanceTargetTick + 1U;
+    }
+
+    /* Every timer due by now has run. */
+    for( i = 0; i < MODEL_TIMERS; i++ )
+    {
+        CHECK( ( dueTick[ i ] == MODEL_NOT_ARMED ) || ( dueTick[ i ] > advanceTargetTick ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void modelRound( uint32_t tickMs )
+{
+    uint64_t nowMs = ( uint64_t ) nextRandom() * ( nextRandom() % 1000U );
+    uint64_t nextMs;
+    uint32_t op;
+    int i;
+
+    TimerWheel_Init( &wheel, tickMs, nowMs );
+    modelTick = nowMs / tickMs;
+
+    for( i = 0; i < MODEL_TIMERS; i++ )
+    {
+        TimerWheel_InitNode( &nodes[ i ], modelCallback, ( void * ) ( intptr_t ) i );
+        dueTick[ i ] = MODEL_NOT_ARMED;
+    }
+
+    for( op = 0U; op < MODEL_OPS_PER_ROUND; op++ )
+    {
+        switch( nextRandom() % 8U )
+        {
+            case 0:
+            case 1:
+            case 2:
+                modelArm( ( int ) ( nextRandom() % MODEL_TIMERS ), nowMs, modelTick );
+                break;
+
+            case 3:
+                modelCancel( ( int ) ( nextRandom() % MODEL_TIMERS ) );
+                break;
+
+            case 4:
+                nowMs += nextRandom() % ( 4U * tickMs );
+                modelAdvance( nowMs );
+                break;
+
+            case 5:
+                nowMs += nextRandom() % 100000U;
+                modelAdvance( nowMs );
+                break;
+
+            case 6:
+                /* As the service does: advance to the next expiry. */
+                nextMs = TimerWheel_NextExpiryMs( &wheel );
+
+                if( ( nextMs != TIMER_WHEEL_NEVER ) && ( nextMs > nowMs ) )
+                {
+                    nowMs = nextMs;
+                }
+
+                modelAdvance( nowMs );
+                break;
+
+            default:
+                /* A jump across many cascades. Advancing costs a step per 64
+                 * ticks, so longer jumps only make the test slow. */
+                nowMs += ( uint64_t ) ( nextRandom() % ( 1U << 18 ) ) * tickMs;
+                modelAdvance( nowMs );
+                break;
+        }
+
+        checkState();
+    }
+
+    /* Drain: everything armed runs eventually. */
+    while( ( nextMs = TimerWheel_NextExpiryMs( &wheel ) ) != TIMER_WHEEL_NEVER )
+    {
+        CHECK( nextMs >= nowMs );
+        nowMs = nextMs;
+
+        for( i = 0; i < MODEL_TIMERS; i++ )
+        {
+            modelCancel( i );
+        }
+
+        modelAdvance( nowMs );
+        checkState();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static TaskHandle_t mainTask;
+static TimerWheelNode_t serviceNodes[ SERVICE_TIMERS ];
+static uint64_t serviceDueMs[ SERVICE_TIMERS ];
+static uint32_t serviceEarly;
+static uint32_t serviceRearmed;
+
+static void serviceCallback( TimerWheelNode_t * pNode,
+                             void * pArg )
+{
+    int index = ( int ) ( intptr_t ) pArg;
+
+    /* The service runs on whole milliseconds of the same clock. */
+    if( ( Clock_GetTimeUs() / 1000U ) < serviceDueMs[ index ] )
+    {
+        serviceEarly++;
+    }
+
+    /* The first timer re-arms itself once from its callback. */
+    if( ( index == 0 ) && ( serviceRearmed == 0U ) )
+    {
+        serviceRearmed++;
+        serviceDueMs[ index ] = ( Clock_GetTimeUs() / 1000U ) + 30U;
+        TimerService_Arm( pNode, 30U );
+        return;
+    }
+
+    ( void ) xTaskNotifyGive( mainTask );
+}
+
+/*-----------------------------------------------------------*/
+
+static void testService( void )
+{
+    uint32_t received = 0U;
+    int i;
+
+    mainTask = xTaskGetCurrentTaskHandle();
+    CHECK( TimerService_Start() );
+    CHECK( TimerService_Start() );
+
+    /* Armed latest first, so each arm is earlier than the wake-up set. */
+    for( i = SERVICE_TIMERS - 1; i >= 0; i-- )
+    {
+        TimerWheel_InitNode( &serviceNodes[ i ], serviceCallback, ( void * ) ( intptr_t ) i );
+        serviceDueMs[ i ] = ( Clock_GetTimeUs() / 1000U ) + ( ( uint64_t ) ( i + 1 ) * 25U );
+        TimerService_Arm( &serviceNodes[ i ], ( uint32_t ) ( i + 1 ) * 25U );
+    }
+
+    /* A cancelled timer never runs. */
+    TimerWheel_InitNode( &nodes[ 0 ], serviceCallback, ( void * ) ( intptr_t ) 1 );
+    TimerService_Arm( &nodes[ 0 ], 10U );
+    TimerService_Cancel( &nodes[ 0 ] );
+
+    while( ( received < SERVICE_TIMERS ) &&
+           ( ulTaskNotifyTake( pdFALSE, pdMS_TO_TICKS( SERVICE_WAIT_MS ) ) > 0U ) )
+    {
+        received++;
+    }
+
+    vTaskDelay( pdMS_TO_TICKS( 50 ) );
+    CHECK( received == SERVICE_TIMERS );
+    CHECK( ulTaskNotifyTake( pdTRUE, 0U ) == 0U );
+    CHECK( serviceRearmed == 1U );
+    CHECK( serviceEarly == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static const uint32_t tickMs[] = { 1U, 10U, 7U };
+    uint32_t rounds = 30U;
+    uint32_t round;
+    int option;
+
+    while( ( option = getopt( argc, argv, "s:r:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 's':
+                seed = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'r':
+                rounds = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                fprintf( stderr, "usage: %s [-s seed] [-r rounds]\n", argv[ 0 ] );
+                return 1;
+        }
+    }
+
+    randomState = ( seed != 0U ) ? seed : 1U;
+
+    for( round = 0U; round < rounds; round++ )
+    {
+        modelRound( tickMs[ round % ( sizeof( tickMs ) / sizeof( tickMs[ 0 ] ) ) ] );
+    }
+
+    testService();
+
+    printf( "timer_wheel_model: passed, seed %" PRIu32 ", %" PRIu32 " rounds\n", seed, rounds );
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timer_service.h
+ * @brief A shared timer wheel driven by one FreeRTOS software timer.
+ *
+ * Lets protocol code (OTA request and self-test timers, keep-alive and
+ * acknowledgement deadlines) share one wake-up schedule instead of a software
+ * timer or a polling loop each. The service has no task of its own: timer
+ * nodes are owned by the caller and callbacks run in the FreeRTOS timer
+ * daemon task, so they must not block.
+ */
+
+#ifndef TIMER_SERVICE_H_
+#define TIMER_SERVICE_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "timer_wheel.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief Start the service. Safe to call more than once; later calls do
+ * nothing.
+ *
+ * @return true if the service is running.
+ */
+bool TimerService_Start( void );
+
+/**
+ * @brief Arm a timer, or re-arm it if it is already armed. Thread safe, and
+ * may be called from a timer callback.
+ *
+ * @param[in] pNode A timer initialised with TimerWheel_InitNode().
+ * @param[in] delayMs Time from now the timer expires at.
+ */
+void TimerService_Arm( TimerWheelNode_t * pNode,
+                       uint32_t delayMs );
+
+/**
+ * @brief Disarm a timer. Thread safe, and may be called from a timer
+ * callback. The callback of the timer does not run after this returns,
+ * unless called from another callback already running.
+ *
+ * @param[in] pNode The timer.
+ */
+void TimerService_Cancel( TimerWheelNode_t * pNode );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef TIMER_SERVICE_H_ */
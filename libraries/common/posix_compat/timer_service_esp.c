@@ -0,0 +1,206 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timer_service_esp.c
+ * @brief Shared timer wheel driven by one FreeRTOS software timer.
+ */
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+/* Platform clock include. */
+#include "clock.h"
+
+#include "timer_service.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Resolution of the shared wheel.
+ */
+#ifndef TIMER_SERVICE_TICK_MS
+    #define TIMER_SERVICE_TICK_MS    ( 10U )
+#endif
+
+static const char * TAG = "timer_service";
+
+static TimerWheel_t wheel;
+
+/**
+ * @brief Guards the wheel. Recursive, because callbacks run with it held and
+ * may arm or cancel timers.
+ */
+static SemaphoreHandle_t wheelLock;
+static StaticSemaphore_t wheelLockBuffer;
+
+/**
+ * @brief One-shot timer that advances the wheel in the timer daemon task,
+ * set to the next expiry each time.
+ */
+static TimerHandle_t serviceTimer;
+static StaticTimer_t serviceTimerBuffer;
+
+/**
+ * @brief Time the service timer expires at. Guarded by wheelLock.
+ */
+static uint64_t wakeMs = TIMER_WHEEL_NEVER;
+
+/**
+ * @brief Whether the wheel is being advanced. Guarded by wheelLock.
+ */
+static bool advancing;
+
+#define SERVICE_STOPPED     ( 0U )
+#define SERVICE_STARTING    ( 1U )
+#define SERVICE_RUNNING     ( 2U )
+
+static portMUX_TYPE stateLock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint8_t serviceState = SERVICE_STOPPED;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t monotonicMs( void )
+{
+    return Clock_GetTimeUs() / 1000U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void serviceTimerCallback( TimerHandle_t xTimer )
+{
+    uint64_t nowMs;
+    uint64_t waitTicks;
+    BaseType_t status;
+
+    ( void ) xTimer;
+
+    ( void ) xSemaphoreTakeRecursive( wheelLock, portMAX_DELAY );
+    advancing = true;
+    ( void ) TimerWheel_Advance( &wheel, monotonicMs() );
+    advancing = false;
+
+    nowMs = monotonicMs();
+    wakeMs = TimerWheel_NextExpiryMs( &wheel );
+
+    /* Sent with the lock held, so it is queued before the wake of any timer
+     * armed after the wheel was read. The daemon must not block on its own
+     * command queue. */
+    if( wakeMs == TIMER_WHEEL_NEVER )
+    {
+        status = xTimerStop( serviceTimer, 0U );
+    }
+    else
+    {
+        /* Round up, so the wheel is never advanced before the deadline. */
+        waitTicks = ( wakeMs > nowMs ) ? ( ( wakeMs - nowMs + portTICK_PERIOD_MS - 1U ) / portTICK_PERIOD_MS ) : 1U;
+        waitTicks = ( waitTicks < ( uint64_t ) portMAX_DELAY ) ? waitTicks : ( portMAX_DELAY - 1U );
+        status = xTimerChangePeriod( serviceTimer, ( TickType_t ) waitTicks, 0U );
+    }
+
+    ( void ) xSemaphoreGiveRecursive( wheelLock );
+
+    if( status != pdPASS )
+    {
+        ESP_LOGE( TAG, "Timer command queue full; timers wait for the next arm." );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool TimerService_Start( void )
+{
+    uint8_t state;
+
+    for( ; ; )
+    {
+        taskENTER_CRITICAL( &stateLock );
+        state = serviceState;
+
+        if( state == SERVICE_STOPPED )
+        {
+            serviceState = SERVICE_STARTING;
+        }
+
+        taskEXIT_CRITICAL( &stateLock );
+
+        if( state == SERVICE_RUNNING )
+        {
+            return true;
+        }
+
+        if( state == SERVICE_STOPPED )
+        {
+            break;
+        }
+
+        /* Another task is starting the service. */
+        vTaskDelay( 1 );
+    }
+
+    TimerWheel_Init( &wheel, TIMER_SERVICE_TICK_MS, monotonicMs() );
+    wheelLock = xSemaphoreCreateRecursiveMutexStatic( &wheelLockBuffer );
+    serviceTimer = xTimerCreateStatic( "timer_service", 1U, pdFALSE, NULL, serviceTimerCallback,
+                                       &serviceTimerBuffer );
+    configASSERT( ( wheelLock != NULL ) && ( serviceTimer != NULL ) );
+
+    serviceState = SERVICE_RUNNING;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerService_Arm( TimerWheelNode_t * pNode,
+                       uint32_t delayMs )
+{
+    bool wake;
+
+    configASSERT( ( serviceState == SERVICE_RUNNING ) && ( pNode != NULL ) );
+
+    ( void ) xSemaphoreTakeRecursive( wheelLock, portMAX_DELAY );
+    TimerWheel_Arm( &wheel, pNode, monotonicMs(), delayMs );
+
+    /* The service timer callback sets the next wake-up after running the
+     * timer callbacks, so a timer armed from one needs no wake. */
+    wake = !advancing && ( TimerWheel_NextExpiryMs( &wheel ) < wakeMs );
+
+    if( wake )
+    {
+        wakeMs = 0U;
+    }
+
+    ( void ) xSemaphoreGiveRecursive( wheelLock );
+
+    /* Run the callback on the next tick, which sets the exact wake-up. Sent
+     * unlocked, since the daemon may be waiting for the lock in the callback. */
+    if( wake && ( xTimerChangePeriod( serviceTimer, 1U, portMAX_DELAY ) != pdPASS ) )
+    {
+        ESP_LOGE( TAG, "Failed to wake the timer service." );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerService_Cancel( TimerWheelNode_t * pNode )
+{
+    configASSERT( ( serviceState == SERVICE_RUNNING ) && ( pNode != NULL ) );
+
+    /* A later wake-up is left as it is; the callback runs once for nothing. */
+    ( void ) xSemaphoreTakeRecursive( wheelLock, portMAX_DELAY );
+    TimerWheel_Cancel( &wheel, pNode );
+    ( void ) xSemaphoreGiveRecursive( wheelLock );
+}
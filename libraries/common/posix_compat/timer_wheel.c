@@ -0,0 +1,392 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timer_wheel.c
+ * @brief Hierarchical timer wheel for protocol deadlines.
+ *
+ * Level l slot i holds the timers expiring in the block of 64^l ticks whose
+ * index at level l is i. A timer goes to the lowest level whose span covers
+ * its distance from the current tick. Whenever the current tick crosses a
+ * block boundary of level l, the level l slot for the new block is cascaded:
+ * its timers are placed again, which moves them to lower levels.
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+
+#include "timer_wheel.h"
+
+/*-----------------------------------------------------------*/
+
+#define SLOT_MASK             ( ( uint64_t ) TIMER_WHEEL_SLOTS - 1U )
+#define LEVEL_SHIFT( level )    ( ( level ) * TIMER_WHEEL_SLOT_BITS )
+
+/**
+ * @brief Ticks covered by the whole wheel.
+ */
+#define WHEEL_SPAN            ( ( uint64_t ) 1U << LEVEL_SHIFT( TIMER_WHEEL_LEVELS ) )
+
+/*-----------------------------------------------------------*/
+
+static void linkNode( TimerWheel_t * pWheel,
+                      TimerWheelNode_t * pNode )
+{
+    uint64_t expiry = pNode->expiryTick;
+    uint64_t delta;
+    uint32_t level = 0U;
+    uint32_t slot;
+    TimerWheelNode_t ** ppHead;
+
+    /* An overdue timer runs on the next tick processed. A timer beyond the
+     * span of the wheel is placed as far out as possible and placed again
+     * when it gets there. */
+    if( expiry < pWheel->currentTick )
+    {
+        expiry = pWheel->currentTick;
+    }
+
+    delta = expiry - pWheel->currentTick;
+
+    if( delta >= WHEEL_SPAN )
+    {
+        delta = WHEEL_SPAN - 1U;
+        expiry = pWheel->currentTick + delta;
+    }
+
+    while( ( level < ( TIMER_WHEEL_LEVELS - 1U ) ) &&
+           ( delta >= ( ( uint64_t ) 1U << LEVEL_SHIFT( level + 1U ) ) ) )
+    {
+        level++;
+    }
+
+    slot = ( uint32_t ) ( ( expiry >> LEVEL_SHIFT( level ) ) & SLOT_MASK );
+    ppHead = &pWheel->slots[ level ][ slot ];
+
+    pNode->pNext = *ppHead;
+
+    if( pNode->pNext != NULL )
+    {
+        pNode->pNext->ppPrev = &pNode->pNext;
+    }
+
+    *ppHead = pNode;
+    pNode->ppPrev = ppHead;
+    pNode->slot = ( uint16_t ) ( ( level * TIMER_WHEEL_SLOTS ) + slot );
+    pWheel->occupied[ level ] |= ( uint64_t ) 1U << slot;
+}
+
+/*-----------------------------------------------------------*/
+
+static void unlinkNode( TimerWheel_t * pWheel,
+                        TimerWheelNode_t * pNode )
+{
+    uint32_t level = pNode->slot / TIMER_WHEEL_SLOTS;
+    uint32_t slot = pNode->slot % TIMER_WHEEL_SLOTS;
+
+    *pNode->ppPrev = pNode->pNext;
+
+    if( pNode->pNext != NULL )
+    {
+        pNode->pNext->ppPrev = pNode->ppPrev;
+    }
+
+    pNode->pNext = NULL;
+    pNode->ppPrev = NULL;
+
+    if( pWheel->slots[ level ][ slot ] == NULL )
+    {
+        pWheel->occupied[ level ] &= ~( ( uint64_t ) 1U << slot );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Place the timers of a slot again relative to the current tick. */
+static void cascade( TimerWheel_t * pWheel,
+                     uint32_t level,
+                     uint32_t slot )
+{
+    TimerWheelNode_t * pNode = pWheel->slots[ level ][ slot ];
+    TimerWheelNode_t * pNext;
+
+    pWheel->slots[ level ][ slot ] = NULL;
+    pWheel->occupied[ level ] &= ~( ( uint64_t ) 1U << slot );
+
+    while( pNode != NULL )
+    {
+        pNext = pNode->pNext;
+        linkNode( pWheel, pNode );
+        pNode = pNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Process the current tick and move to the next one. */
+static uint32_t processTick( TimerWheel_t * pWheel )
+{
+    uint64_t tick = pWheel->currentTick;
+    uint32_t slot = ( uint32_t ) ( tick & SLOT_MASK );
+    uint32_t level = 0U;
+    uint32_t fired = 0U;
+    TimerWheelNode_t * pPending;
+    TimerWheelNode_t * pNode;
+
+    /* Cascade from the highest level whose block starts at this tick, so
+     * timers cascaded down can be cascaded again at the level below. */
+    while( ( level < ( TIMER_WHEEL_LEVELS - 1U ) ) &&
+           ( ( tick & ( ( ( uint64_t ) 1U << LEVEL_SHIFT( level + 1U ) ) - 1U ) ) == 0U ) )
+    {
+        level++;
+    }
+
+    for( ; level > 0U; level-- )
+    {
+        cascade( pWheel, level, ( uint32_t ) ( ( tick >> LEVEL_SHIFT( level ) ) & SLOT_MASK ) );
+    }
+
+    /* Move the due timers to a local list first, so a callback arming a timer
+     * for this tick cannot make the loop run forever, and a callback
+     * cancelling another due timer unlinks it from the local list. */
+    pPending = pWheel->slots[ 0 ][ slot ];
+    pWheel->slots[ 0 ][ slot ] = NULL;
+    pWheel->occupied[ 0 ] &= ~( ( uint64_t ) 1U << slot );
+
+    if( pPending != NULL )
+    {
+        pPending->ppPrev = &pPending;
+    }
+
+    pWheel->currentTick++;
+
+    while( pPending != NULL )
+    {
+        pNode = pPending;
+        pPending = pNode->pNext;
+
+        if( pPending != NULL )
+        {
+            pPending->ppPrev = &pPending;
+        }
+
+        pNode->pNext = NULL;
+        pNode->ppPrev = NULL;
+
+        if( pNode->expiryTick > tick )
+        {
+            /* A timer beyond the span of the wheel when it was armed. */
+            linkNode( pWheel, pNode );
+        }
+        else
+        {
+            pWheel->armedCount--;
+            fired++;
+            pNode->callback( pNode, pNode->pArg );
+        }
+    }
+
+    return fired;
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Init( TimerWheel_t * pWheel,
+                      uint32_t tickMs,
+                      uint64_t nowMs )
+{
+    size_t level;
+    size_t slot;
+
+    for( level = 0; level < TIMER_WHEEL_LEVELS; level++ )
+    {
+        for( slot = 0; slot < TIMER_WHEEL_SLOTS; slot++ )
+        {
+            pWheel->slots[ level ][ slot ] = NULL;
+        }
+
+        pWheel->occupied[ level ] = 0U;
+    }
+
+    pWheel->tickMs = ( tickMs > 0U ) ? tickMs : 1U;
+    pWheel->currentTick = nowMs / pWheel->tickMs;
+    pWheel->armedCount = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerWheel_InitNode( TimerWheelNode_t * pNode,
+                          TimerWheelCallback_t callback,
+                          void * pArg )
+{
+    pNode->pNext = NULL;
+    pNode->ppPrev = NULL;
+    pNode->expiryTick = 0U;
+    pNode->slot = 0U;
+    pNode->callback = callback;
+    pNode->pArg = pArg;
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Arm( TimerWheel_t * pWheel,
+                     TimerWheelNode_t * pNode,
+                     uint64_t nowMs,
+                     uint32_t delayMs )
+{
+    uint64_t nowTick = nowMs / pWheel->tickMs;
+
+    if( pNode->ppPrev != NULL )
+    {
+        unlinkNode( pWheel, pNode );
+        pWheel->armedCount--;
+    }
+
+    /* An idle wheel is not advanced; catch up so the timer is placed
+     * relative to now rather than to the last advance. */
+    if( ( pWheel->armedCount == 0U ) && ( pWheel->currentTick < nowTick ) )
+    {
+        pWheel->currentTick = nowTick;
+    }
+
+    /* Round up, so the timer never expires early. */
+    pNode->expiryTick = ( nowMs + delayMs + pWheel->tickMs - 1U ) / pWheel->tickMs;
+    linkNode( pWheel, pNode );
+    pWheel->armedCount++;
+}
+
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Cancel( TimerWheel_t * pWheel,
+                        TimerWheelNode_t * pNode )
+{
+    if( pNode->ppPrev != NULL )
+    {
+        unlinkNode( pWheel, pNode );
+        pWheel->armedCount--;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool TimerWheel_IsArmed( const TimerWheelNode_t * pNode )
+{
+    return pNode->ppPrev != NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t TimerWheel_Advance( TimerWheel_t * pWheel,
+                             uint64_t nowMs )
+{
+    uint64_t targetTick = nowMs / pWheel->tickMs;
+    uint64_t ahead;
+    uint64_t nextTick;
+    uint32_t slot;
+    uint32_t fired = 0U;
+
+    while( pWheel->currentTick <= targetTick )
+    {
+        if( pWheel->armedCount == 0U )
+        {
+            pWheel->currentTick = targetTick + 1U;
+            break;
+        }
+
+        /* Skip the ticks before the next occupied level 0 slot or the next
+         * cascade, whichever comes first. */
+        slot = ( uint32_t ) ( pWheel->currentTick & SLOT_MASK );
+        ahead = pWheel->occupied[ 0 ] & ( ~( uint64_t ) 0U << slot );
+
+        if( ahead != 0U )
+        {
+            nextTick = ( pWheel->currentTick & ~SLOT_MASK ) + ( uint64_t ) __builtin_ctzll( ahead );
+        }
+        else
+        {
+            nextTick = ( pWheel->currentTick & ~SLOT_MASK ) + TIMER_WHEEL_SLOTS;
+        }
+
+        if( ( slot != 0U ) && ( nextTick > pWheel->currentTick ) )
+        {
+            pWheel->currentTick = ( nextTick <= targetTick ) ? nextTick : ( targetTick + 1U );
+            continue;
+        }
+
+        fired += processTick( pWheel );
+    }
+
+    return fired;
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t TimerWheel_NextExpiryMs( const TimerWheel_t * pWheel )
+{
+    uint64_t tick = pWheel->currentTick;
+    uint64_t nextTick = UINT64_MAX;
+    uint64_t candidate;
+    uint64_t ahead;
+    uint64_t blockStart;
+    uint32_t level;
+    uint32_t shift;
+    uint32_t slot;
+
+    if( pWheel->armedCount == 0U )
+    {
+        return TIMER_WHEEL_NEVER;
+    }
+
+    /* Take the earliest work over all levels: a lower level may have a slot
+     * ahead while the current tick also starts a higher level block that is
+     * yet to be cascaded. */
+    for( level = 0; level < TIMER_WHEEL_LEVELS; level++ )
+    {
+        if( pWheel->occupied[ level ] == 0U )
+        {
+            continue;
+        }
+
+        shift = LEVEL_SHIFT( level );
+        slot = ( uint32_t ) ( ( tick >> shift ) & SLOT_MASK );
+        blockStart = tick & ~( ( ( uint64_t ) 1U << ( shift + TIMER_WHEEL_SLOT_BITS ) ) - 1U );
+
+        /* The current slot of a higher level was cascaded already, unless
+         * the current tick starts its block and is yet to be processed.
+         * Timers in a cascaded slot belong to the next round. */
+        if( ( level > 0U ) && ( ( tick & ( ( ( uint64_t ) 1U << shift ) - 1U ) ) != 0U ) )
+        {
+            slot++;
+        }
+
+        ahead = ( slot < TIMER_WHEEL_SLOTS ) ? ( pWheel->occupied[ level ] & ( ~( uint64_t ) 0U << slot ) ) : 0U;
+
+        if( ahead != 0U )
+        {
+            candidate = blockStart + ( ( uint64_t ) __builtin_ctzll( ahead ) << shift );
+        }
+        else
+        {
+            /* Only slots of the next round: they are reached when this level
+             * wraps. */
+            candidate = blockStart + ( ( uint64_t ) 1U << ( shift + TIMER_WHEEL_SLOT_BITS ) );
+        }
+
+        if( candidate < nextTick )
+        {
+            nextTick = candidate;
+        }
+    }
+
+    return nextTick * pWheel->tickMs;
+}
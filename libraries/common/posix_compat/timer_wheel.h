@@ -0,0 +1,167 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timer wheel for protocol deadlines.
+ *
+ * Timers are nodes owned by the caller, usually statically allocated, linked
+ * into one of TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots each.
+ * Arming and cancelling are O(1); advancing the wheel costs one step per
+ * elapsed tick that has timers due, plus an occasional cascade of a higher
+ * level slot. The wheel is driven with a 64-bit millisecond clock passed by
+ * the caller and is not thread safe; see timer_service.h for a shared,
+ * locked instance driven by a FreeRTOS software timer.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief Number of levels and slots per level. With a 10 ms tick the wheel
+ * spans 64^4 ticks, about 46 hours; longer timers are re-queued on expiry.
+ */
+#define TIMER_WHEEL_SLOT_BITS    ( 6U )
+#define TIMER_WHEEL_SLOTS        ( 1U << TIMER_WHEEL_SLOT_BITS )
+#define TIMER_WHEEL_LEVELS       ( 4U )
+
+/**
+ * @brief Value of TimerWheel_NextExpiryMs() when no timer is armed.
+ */
+#define TIMER_WHEEL_NEVER        ( UINT64_MAX )
+
+struct TimerWheelNode;
+
+/**
+ * @brief Called from TimerWheel_Advance() when a timer expires. The node is
+ * disarmed first, so the callback may arm it again.
+ */
+typedef void ( * TimerWheelCallback_t )( struct TimerWheelNode * pNode,
+                                         void * pArg );
+
+/**
+ * @brief A timer. Initialise with TimerWheel_InitNode(); the members are
+ * private to timer_wheel.c.
+ */
+typedef struct TimerWheelNode
+{
+    struct TimerWheelNode * pNext;   /**< @brief Next node in the slot. */
+    struct TimerWheelNode ** ppPrev; /**< @brief Link pointing at this node, NULL when disarmed. */
+    uint64_t expiryTick;             /**< @brief Tick the timer expires at. */
+    uint16_t slot;                   /**< @brief Level * TIMER_WHEEL_SLOTS + slot, while armed. */
+    TimerWheelCallback_t callback;   /**< @brief Called on expiry. */
+    void * pArg;                     /**< @brief Passed to the callback. */
+} TimerWheelNode_t;
+
+/**
+ * @brief A timer wheel. The members are private to timer_wheel.c.
+ */
+typedef struct TimerWheel
+{
+    TimerWheelNode_t * slots[ TIMER_WHEEL_LEVELS ][ TIMER_WHEEL_SLOTS ];
+    uint64_t occupied[ TIMER_WHEEL_LEVELS ]; /**< @brief Bit per non-empty slot. */
+    uint64_t currentTick;                    /**< @brief Next tick to process. */
+    uint32_t tickMs;                         /**< @brief Resolution. */
+    uint32_t armedCount;                     /**< @brief Armed timers. */
+} TimerWheel_t;
+
+/**
+ * @brief Initialise a wheel.
+ *
+ * @param[out] pWheel The wheel.
+ * @param[in] tickMs Resolution in milliseconds; timers expire up to one tick
+ * late, never early.
+ * @param[in] nowMs Current time.
+ */
+void TimerWheel_Init( TimerWheel_t * pWheel,
+                      uint32_t tickMs,
+                      uint64_t nowMs );
+
+/**
+ * @brief Initialise a disarmed timer.
+ *
+ * @param[out] pNode The timer.
+ * @param[in] callback Called on expiry.
+ * @param[in] pArg Passed to the callback.
+ */
+void TimerWheel_InitNode( TimerWheelNode_t * pNode,
+                          TimerWheelCallback_t callback,
+                          void * pArg );
+
+/**
+ * @brief Arm a timer, or re-arm it if it is already armed.
+ *
+ * @param[in] pWheel The wheel.
+ * @param[in] pNode The timer.
+ * @param[in] nowMs Current time.
+ * @param[in] delayMs Time from now the timer expires at.
+ */
+void TimerWheel_Arm( TimerWheel_t * pWheel,
+                     TimerWheelNode_t * pNode,
+                     uint64_t nowMs,
+                     uint32_t delayMs );
+
+/**
+ * @brief Disarm a timer. Does nothing if it is not armed.
+ *
+ * @param[in] pWheel The wheel.
+ * @param[in] pNode The timer.
+ */
+void TimerWheel_Cancel( TimerWheel_t * pWheel,
+                        TimerWheelNode_t * pNode );
+
+/**
+ * @brief Whether a timer is armed.
+ */
+bool TimerWheel_IsArmed( const TimerWheelNode_t * pNode );
+
+/**
+ * @brief Run the callbacks of every timer due at @p nowMs.
+ *
+ * @param[in] pWheel The wheel.
+ * @param[in] nowMs Current time.
+ *
+ * @return Number of callbacks run.
+ */
+uint32_t TimerWheel_Advance( TimerWheel_t * pWheel,
+                             uint64_t nowMs );
+
+/**
+ * @brief Time at which TimerWheel_Advance() next has work to do: a timer
+ * expiry or a cascade that may lead to one. Never later than the earliest
+ * expiry, except that a timer armed for a tick already processed runs at the
+ * next one.
+ *
+ * @param[in] pWheel The wheel.
+ *
+ * @return Time in milliseconds, or #TIMER_WHEEL_NEVER if no timer is armed.
+ */
+uint64_t TimerWheel_NextExpiryMs( const TimerWheel_t * pWheel );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef TIMER_WHEEL_H_ */
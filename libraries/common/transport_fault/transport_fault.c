@@ -0,0 +1,531 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file transport_fault.c
+ * @brief Fault injecting wrapper around a TransportInterface_t.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Platform clock include. */
+#include "clock.h"
+
+#include "transport_fault.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wrapped transports, looked up by their network context.
+ */
+static TransportFault_t * wrapped[ TRANSPORT_FAULT_MAX_WRAPPED ];
+
+/**
+ * @brief Guards #wrapped.
+ */
+static portMUX_TYPE wrappedLock = portMUX_INITIALIZER_UNLOCKED;
+
+/*-----------------------------------------------------------*/
+
+static TransportFault_t * findFault( const NetworkContext_t * pNetworkContext )
+{
+    TransportFault_t * pFault = NULL;
+    size_t i;
+
+    portENTER_CRITICAL( &wrappedLock );
+
+    for( i = 0; i < TRANSPORT_FAULT_MAX_WRAPPED; i++ )
+    {
+        if( ( wrapped[ i ] != NULL ) && ( wrapped[ i ]->inner.pNetworkContext == pNetworkContext ) )
+        {
+            pFault = wrapped[ i ];
+            break;
+        }
+    }
+
+    portEXIT_CRITICAL( &wrappedLock );
+
+    return pFault;
+}
+
+/*-----------------------------------------------------------*/
+
+/* xorshift32: small, fast and reproducible across platforms. The helpers
+ * below are called with pFault->lock held. */
+static uint32_t nextRandom( uint32_t * pRngState )
+{
+    uint32_t x = *pRngState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pRngState = x;
+
+    return x;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool chance( uint32_t * pRngState,
+                    uint16_t perMille )
+{
+    return ( perMille != 0U ) && ( ( nextRandom( pRngState ) % 1000U ) < perMille );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t drawLatency( TransportFault_t * pFault,
+                             uint32_t * pRngState )
+{
+    uint32_t ms = pFault->config.latencyMs;
+
+    if( pFault->config.jitterMs != 0U )
+    {
+        ms += nextRandom( pRngState ) % ( pFault->config.jitterMs + 1U );
+    }
+
+    return ms;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Called without the lock, since it sleeps. */
+static void delayMs( TransportFault_t * pFault,
+                     uint32_t ms )
+{
+    if( ms > 0U )
+    {
+        portENTER_CRITICAL( &pFault->lock );
+        pFault->stats.delayMs += ms;
+        portEXIT_CRITICAL( &pFault->lock );
+
+        Clock_SleepMs( ms );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Decide whether a call may reach the inner transport.
+ *
+ * @return 1 to go ahead, 0 while stalled, -1 once disconnected.
+ */
+static int32_t admitCall( TransportFault_t * pFault,
+                          uint32_t * pRngState,
+                          uint32_t nowMs )
+{
+    if( pFault->disconnected )
+    {
+        return -1;
+    }
+
+    if( chance( pRngState, pFault->config.disconnectPerMille ) )
+    {
+        pFault->disconnected = true;
+        pFault->stats.disconnects++;
+        return -1;
+    }
+
+    if( pFault->stalled )
+    {
+        /* Signed difference, so the comparison survives the clock wrapping. */
+        if( ( int32_t ) ( nowMs - pFault->stallEndMs ) < 0 )
+        {
+            return 0;
+        }
+
+        pFault->stalled = false;
+    }
+
+    if( chance( pRngState, pFault->config.stallPerMille ) )
+    {
+        pFault->stalled = true;
+        pFault->stallEndMs = nowMs + pFault->config.stallMs;
+        pFault->stats.stalls++;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t truncateLength( TransportFault_t * pFault,
+                              uint32_t * pRngState,
+                              size_t length )
+{
+    if( ( length > 1U ) && chance( pRngState, pFault->config.partialPerMille ) )
+    {
+        pFault->stats.partials++;
+        length = 1U + ( nextRandom( pRngState ) % ( length - 1U ) );
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Account bytes that went through and arm the byte-count disconnect.
+ *
+ * @return The bandwidth cap delay the caller must sleep once the lock is
+ * released.
+ */
+static uint32_t accountBytes( TransportFault_t * pFault,
+                              int32_t bytes,
+                              uint32_t * pRemainder )
+{
+    uint32_t capDelayMs = 0U;
+
+    if( bytes <= 0 )
+    {
+        return 0U;
+    }
+
+    pFault->bytesMoved += ( uint32_t ) bytes;
+
+    if( ( pFault->config.disconnectAfterBytes != 0U ) &&
+        ( pFault->bytesMoved >= pFault->config.disconnectAfterBytes ) &&
+        !pFault->disconnected )
+    {
+        /* Let this call succeed; the next one sees the dropped connection. */
+        pFault->disconnected = true;
+        pFault->stats.disconnects++;
+    }
+
+    if( pFault->config.bandwidthBytesPerSec != 0U )
+    {
+        uint64_t owed = ( ( uint64_t ) bytes * 1000U ) + *pRemainder;
+
+        *pRemainder = ( uint32_t ) ( owed % pFault->config.bandwidthBytesPerSec );
+        capDelayMs = ( uint32_t ) ( owed / pFault->config.bandwidthBytesPerSec );
+    }
+
+    return capDelayMs;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Admit a send or writev and draw its latency and length.
+ *
+ * @return The admitCall() result.
+ */
+static int32_t beginSend( TransportFault_t * pFault,
+                          size_t * pLength,
+                          uint32_t * pLatencyMs )
+{
+    uint32_t nowMs = Clock_GetTimeMs();
+    int32_t result;
+
+    portENTER_CRITICAL( &pFault->lock );
+    pFault->stats.sendCalls++;
+    result = admitCall( pFault, &pFault->sendRngState, nowMs );
+
+    if( result > 0 )
+    {
+        *pLatencyMs = drawLatency( pFault, &pFault->sendRngState );
+        *pLength = truncateLength( pFault, &pFault->sendRngState, *pLength );
+    }
+
+    portEXIT_CRITICAL( &pFault->lock );
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static void endSend( TransportFault_t * pFault,
+                     int32_t result )
+{
+    uint32_t capDelayMs;
+
+    portENTER_CRITICAL( &pFault->lock );
+
+    if( result > 0 )
+    {
+        pFault->stats.bytesSent += ( uint32_t ) result;
+    }
+
+    capDelayMs = accountBytes( pFault, result, &pFault->sendRemainder );
+    portEXIT_CRITICAL( &pFault->lock );
+
+    delayMs( pFault, capDelayMs );
+}
+
+/*-----------------------------------------------------------*/
+
+bool TransportFault_Wrap( TransportFault_t * pFault,
+                          const TransportFaultConfig_t * pConfig,
+                          TransportInterface_t * pTransport )
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    size_t i;
+    size_t freeSlot = TRANSPORT_FAULT_MAX_WRAPPED;
+    bool duplicate = false;
+
+    if( ( pFault == NULL ) || ( pConfig == NULL ) || ( pTransport == NULL ) ||
+        ( pTransport->send == NULL ) || ( pTransport->recv == NULL ) )
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL( &wrappedLock );
+
+    for( i = 0; i < TRANSPORT_FAULT_MAX_WRAPPED; i++ )
+    {
+        if( wrapped[ i ] == NULL )
+        {
+            if( freeSlot == TRANSPORT_FAULT_MAX_WRAPPED )
+            {
+                freeSlot = i;
+            }
+        }
+        else if( ( wrapped[ i ] == pFault ) ||
+                 ( wrapped[ i ]->inner.pNetworkContext == pTransport->pNetworkContext ) )
+        {
+            duplicate = true;
+        }
+    }
+
+    if( !duplicate && ( freeSlot != TRANSPORT_FAULT_MAX_WRAPPED ) )
+    {
+        memset( pFault, 0, sizeof( *pFault ) );
+        pFault->lock = unlocked;
+        pFault->config = *pConfig;
+        pFault->inner = *pTransport;
+        pFault->sendRngState = ( pConfig->seed != 0U ) ? pConfig->seed : 1U;
+        /* A different but equally reproducible stream for receives. */
+        pFault->recvRngState = pFault->sendRngState ^ 0x9E3779B9U;
+        pFault->recvRngState = ( pFault->recvRngState != 0U ) ? pFault->recvRngState : 1U;
+        wrapped[ freeSlot ] = pFault;
+    }
+
+    portEXIT_CRITICAL( &wrappedLock );
+
+    if( duplicate || ( freeSlot == TRANSPORT_FAULT_MAX_WRAPPED ) )
+    {
+        return false;
+    }
+
+    pTransport->send = TransportFault_Send;
+    pTransport->recv = TransportFault_Recv;
+    pTransport->writev = TransportFault_Writev;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void TransportFault_Unwrap( TransportFault_t * pFault,
+                            TransportInterface_t * pTransport )
+{
+    size_t i;
+
+    if( pFault == NULL )
+    {
+        return;
+    }
+
+    portENTER_CRITICAL( &wrappedLock );
+
+    for( i = 0; i < TRANSPORT_FAULT_MAX_WRAPPED; i++ )
+    {
+        if( wrapped[ i ] == pFault )
+        {
+            wrapped[ i ] = NULL;
+        }
+    }
+
+    portEXIT_CRITICAL( &wrappedLock );
+
+    if( pTransport != NULL )
+    {
+        pTransport->send = pFault->inner.send;
+        pTransport->recv = pFault->inner.recv;
+        pTransport->writev = pFault->inner.writev;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TransportFault_Reset( TransportFault_t * pFault )
+{
+    if( pFault != NULL )
+    {
+        portENTER_CRITICAL( &pFault->lock );
+        pFault->disconnected = false;
+        pFault->stalled = false;
+        pFault->bytesMoved = 0U;
+        portEXIT_CRITICAL( &pFault->lock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t TransportFault_Send( NetworkContext_t * pNetworkContext,
+                             const void * pBuffer,
+                             size_t bytesToSend )
+{
+    TransportFault_t * pFault = findFault( pNetworkContext );
+    size_t length = bytesToSend;
+    uint32_t latencyMs = 0U;
+    int32_t result;
+
+    if( pFault == NULL )
+    {
+        return -1;
+    }
+
+    result = beginSend( pFault, &length, &latencyMs );
+
+    if( result > 0 )
+    {
+        delayMs( pFault, latencyMs );
+        result = pFault->inner.send( pNetworkContext, pBuffer, length );
+        endSend( pFault, result );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t TransportFault_Recv( NetworkContext_t * pNetworkContext,
+                             void * pBuffer,
+                             size_t bytesToRecv )
+{
+    TransportFault_t * pFault = findFault( pNetworkContext );
+    uint32_t nowMs = Clock_GetTimeMs();
+    uint32_t waitMs = 0U;
+    size_t length = bytesToRecv;
+    int32_t result;
+
+    if( pFault == NULL )
+    {
+        return -1;
+    }
+
+    portENTER_CRITICAL( &pFault->lock );
+    pFault->stats.recvCalls++;
+    result = admitCall( pFault, &pFault->recvRngState, nowMs );
+
+    if( result > 0 )
+    {
+        length = truncateLength( pFault, &pFault->recvRngState, length );
+    }
+
+    portEXIT_CRITICAL( &pFault->lock );
+
+    if( result > 0 )
+    {
+        result = pFault->inner.recv( pNetworkContext, pBuffer, length );
+
+        portENTER_CRITICAL( &pFault->lock );
+
+        if( result > 0 )
+        {
+            /* Data arrives late; polls that find nothing are not delayed. */
+            waitMs = drawLatency( pFault, &pFault->recvRngState );
+            pFault->stats.bytesReceived += ( uint32_t ) result;
+        }
+
+        waitMs += accountBytes( pFault, result, &pFault->recvRemainder );
+        portEXIT_CRITICAL( &pFault->lock );
+
+        delayMs( pFault, waitMs );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t TransportFault_Writev( NetworkContext_t * pNetworkContext,
+                               TransportOutVector_t * pIoVec,
+                               size_t ioVecCount )
+{
+    TransportFault_t * pFault = findFault( pNetworkContext );
+    int32_t result = 0;
+    size_t totalLength = 0U;
+    size_t allowed;
+    uint32_t latencyMs = 0U;
+    size_t i;
+
+    if( ( pFault == NULL ) || ( pIoVec == NULL ) || ( ioVecCount == 0U ) )
+    {
+        return -1;
+    }
+
+    for( i = 0; i < ioVecCount; i++ )
+    {
+        totalLength += pIoVec[ i ].iov_len;
+    }
+
+    allowed = totalLength;
+    result = beginSend( pFault, &allowed, &latencyMs );
+
+    if( result <= 0 )
+    {
+        return result;
+    }
+
+    delayMs( pFault, latencyMs );
+
+    if( ( allowed == totalLength ) && ( pFault->inner.writev != NULL ) )
+    {
+        result = pFault->inner.writev( pNetworkContext, pIoVec, ioVecCount );
+    }
+    else
+    {
+        /* Partial write, or no inner writev: send vector by vector and stop
+         * at the first short write, like a real writev. */
+        result = 0;
+
+        for( i = 0; ( i < ioVecCount ) && ( allowed > 0U ); i++ )
+        {
+            size_t length = ( pIoVec[ i ].iov_len < allowed ) ? pIoVec[ i ].iov_len : allowed;
+            int32_t sent;
+
+            if( length == 0U )
+            {
+                continue;
+            }
+
+            sent = pFault->inner.send( pNetworkContext, pIoVec[ i ].iov_base, length );
+
+            if( sent < 0 )
+            {
+                result = ( result == 0 ) ? sent : result;
+                break;
+            }
+
+            result += sent;
+            allowed -= ( size_t ) sent;
+
+            if( ( size_t ) sent < pIoVec[ i ].iov_len )
+            {
+                break;
+            }
+        }
+    }
+
+    endSend( pFault, result );
+
+    return result;
+}
@@ -0,0 +1,168 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file transport_fault.h
+ * @brief Fault injection and network emulation for a TransportInterface_t.
+ *
+ * The wrapper sits between coreMQTT/coreHTTP and the real transport and adds
+ * latency, jitter, a bandwidth cap, partial reads and writes, stalls and
+ * disconnects, all drawn from a seeded pseudo-random schedule so a run can be
+ * reproduced. It is meant for benchmarks and tests, not for production use.
+ *
+ * Sends and receives may run on different tasks. Each direction draws from
+ * its own stream of the schedule, so the faults it sees only depend on the
+ * seed and its own sequence of calls. A stall or disconnect drawn by one
+ * direction also affects the other, at a point that depends on timing.
+ */
+
+#ifndef TRANSPORT_FAULT_H_
+#define TRANSPORT_FAULT_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* FreeRTOS includes. */
+#include "freertos/FreeRTOS.h"
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    extern "C" {
+#endif
+/* *INDENT-ON* */
+
+/**
+ * @brief Maximum number of transports wrapped at the same time.
+ */
+#ifndef TRANSPORT_FAULT_MAX_WRAPPED
+    #define TRANSPORT_FAULT_MAX_WRAPPED    ( 4U )
+#endif
+
+/**
+ * @brief What to inject. Zero-initialise and set only the faults wanted.
+ *
+ * Probabilities are given per mille and are evaluated on every send or
+ * receive call that reaches the wrapper.
+ */
+typedef struct TransportFaultConfig
+{
+    uint32_t seed;                 /**< @brief Seed of the schedule; 0 is replaced by 1. */
+    uint32_t latencyMs;            /**< @brief Delay added to each send, and to each receive that returns data. */
+    uint32_t jitterMs;             /**< @brief Random extra delay of 0 to jitterMs on top of latencyMs. */
+    uint32_t bandwidthBytesPerSec; /**< @brief Rate cap applied to each direction separately; 0 for none. */
+    uint16_t partialPerMille;      /**< @brief Chance that a call transfers only part of the requested length. */
+    uint16_t stallPerMille;        /**< @brief Chance that a call starts a stall. */
+    uint32_t stallMs;              /**< @brief Length of a stall, during which every call returns 0. */
+    uint16_t disconnectPerMille;   /**< @brief Chance that a call drops the connection. */
+    uint32_t disconnectAfterBytes; /**< @brief Drop the connection once this many bytes have moved; 0 for never. */
+} TransportFaultConfig_t;
+
+/**
+ * @brief Counters of injected faults and of the traffic that got through.
+ */
+typedef struct TransportFaultStats
+{
+    uint32_t sendCalls;
+    uint32_t recvCalls;
+    uint32_t bytesSent;
+    uint32_t bytesReceived;
+    uint32_t partials;
+    uint32_t stalls;
+    uint32_t disconnects;
+    uint32_t delayMs; /**< @brief Total time spent in latency, jitter and bandwidth delays. */
+} TransportFaultStats_t;
+
+/**
+ * @brief State of one wrapped transport. Owned by the wrapper.
+ */
+typedef struct TransportFault
+{
+    TransportFaultConfig_t config;
+    TransportInterface_t inner;   /**< @brief The transport being wrapped. */
+    portMUX_TYPE lock;            /**< @brief Guards the fields below. Never held across a delay or inner call. */
+    uint32_t sendRngState;        /**< @brief Schedule of sends and writevs. */
+    uint32_t recvRngState;        /**< @brief Schedule of receives. */
+    uint32_t stallEndMs;
+    bool stalled;
+    bool disconnected;
+    uint32_t bytesMoved;
+    uint32_t sendRemainder;       /**< @brief Sub-millisecond part of the send debt, in bytes * 1000. */
+    uint32_t recvRemainder;       /**< @brief Sub-millisecond part of the receive debt, in bytes * 1000. */
+    TransportFaultStats_t stats;
+} TransportFault_t;
+
+/**
+ * @brief Wrap a transport.
+ *
+ * Saves the send, recv and writev functions of @p pTransport in @p pFault and
+ * replaces them with the fault injecting versions. The network context is
+ * left unchanged, so the wrapped transport is used exactly like the original.
+ *
+ * @param[out] pFault Wrapper state, which must outlive the wrapping.
+ * @param[in] pConfig Faults to inject.
+ * @param[in,out] pTransport Transport to wrap.
+ *
+ * @return false if a parameter is invalid, the network context is already
+ * wrapped, or #TRANSPORT_FAULT_MAX_WRAPPED transports are wrapped.
+ */
+bool TransportFault_Wrap( TransportFault_t * pFault,
+                          const TransportFaultConfig_t * pConfig,
+                          TransportInterface_t * pTransport );
+
+/**
+ * @brief Restore the original functions of a wrapped transport. No send or
+ * receive may be in progress on it.
+ */
+void TransportFault_Unwrap( TransportFault_t * pFault,
+                            TransportInterface_t * pTransport );
+
+/**
+ * @brief Clear an injected disconnect and stall, e.g. after the application
+ * has reconnected the underlying transport. The schedule continues.
+ */
+void TransportFault_Reset( TransportFault_t * pFault );
+
+/**
+ * @brief Fault injecting #TransportSend_t.
+ */
+int32_t TransportFault_Send( NetworkContext_t * pNetworkContext,
+                             const void * pBuffer,
+                             size_t bytesToSend );
+
+/**
+ * @brief Fault injecting #TransportRecv_t.
+ */
+int32_t TransportFault_Recv( NetworkContext_t * pNetworkContext,
+                             void * pBuffer,
+                             size_t bytesToRecv );
+
+/**
+ * @brief Fault injecting #TransportWritev_t. Falls back to sending the vectors
+ * one by one through the inner send when the inner transport has no writev.
+ */
+int32_t TransportFault_Writev( NetworkContext_t * pNetworkContext,
+                               TransportOutVector_t * pIoVec,
+                               size_t ioVecCount );
+
+/* *INDENT-OFF* */
+#ifdef __cplusplus
+    }
+#endif
+/* *INDENT-ON* */
+
+#endif /* ifndef TRANSPORT_FAULT_H_ */
@@ -0,0 +1,720 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file agent_bench.c
+ * @brief Host throughput benchmark of the MQTT agent, its message queue and
+ * its command pool.
+ *
+ * N producer threads publish through one agent, which talks to the loopback
+ * fake broker of fake_broker_transport.c. Each producer keeps up to a window
+ * of publishes in flight. The benchmark prints the completed commands per
+ * second, the enqueue-to-complete latency percentiles and the contention
+ * counters of the command pool. Latency runs from the MQTTAgent_Publish()
+ * call, so it includes waiting for a command structure, to the completion
+ * callback, i.e. the PUBACK or PUBCOMP for QoS 1 and 2:
+ *
+ * @code
+ * coremqtt_agent_bench -t 4 -n 100000 -w 4 -q 1 -p 10
+ * @endcode
+ *
+ * It also prints the context switches per 1000 publishes, of the agent
+ * thread and of the whole process, from getrusage(). Comparing -b 1 with a
+ * larger batch shows how many wakeups batch receive saves.
+ *
+ * Options: -t producers, -n publishes per producer, -w publishes in flight
+ * per producer, -q QoS, -s payload bytes, -p command pool size, -o command
+ * pool overflow limit, -l command queue length, -b agent receive batch size.
+ *
+ * Where the transport_fault library is built, -f seed runs the fake broker
+ * through the fault wrapper with that seed, adding -L ms of latency, -J ms
+ * of jitter, -P per mille partial reads and writes, and -S per mille stalls
+ * of -T ms each. Disconnects are left out, since the benchmark does not
+ * reconnect:
+ *
+ * @code
+ * coremqtt_agent_bench -n 2000 -f 7 -L 1 -J 2 -P 100 -S 5 -T 20
+ * @endcode
+ */
+
+/* RUSAGE_THREAD. */
+#define _GNU_SOURCE
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/* MQTT agent includes. */
+#include "core_mqtt_agent.h"
+#include "freertos_agent_message.h"
+#include "freertos_command_pool.h"
+
+#include "fake_broker_transport.h"
+
+#ifdef BENCH_TRANSPORT_FAULT
+    #include "bench_fault.h"
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Size of the agent's network buffer, on top of the payload.
+ */
+#define BENCH_NETWORK_BUFFER_OVERHEAD    ( 256U )
+
+/**
+ * @brief How long to wait for outstanding publishes once all producers are
+ * done.
+ */
+#define BENCH_DRAIN_TIMEOUT_MS           ( 10000U )
+
+/**
+ * @brief One publish in flight. Owned by a producer, handed to the agent
+ * while busy is set.
+ */
+struct MQTTAgentCommandContext
+{
+    struct BenchProducer * pProducer; /**< @brief Producer owning the slot. */
+    uint64_t enqueueUs;               /**< @brief When the publish was handed to the agent. */
+    MQTTPublishInfo_t publishInfo;    /**< @brief Must live until the publish completes. */
+    uint32_t busy;                    /**< @brief The agent holds the slot. */
+};
+
+/**
+ * @brief A producer thread and its results.
+ */
+typedef struct BenchProducer
+{
+    pthread_t thread;
+    sem_t freeSlots;                      /**< @brief Counts slots not held by the agent. */
+    MQTTAgentCommandContext_t * pSlots;   /**< @brief The window, windowSize entries. */
+    uint32_t * pLatencyUs;                /**< @brief Latency of each completed publish. */
+    char topic[ 32 ];                     /**< @brief Topic published to. */
+
+    /* Written by the agent thread only. */
+    uint32_t completed;                   /**< @brief Publishes that completed successfully. */
+    uint32_t completeFailed;              /**< @brief Publishes the agent completed with an error. */
+
+    /* Written by the producer thread only. */
+    uint32_t enqueueFailed;               /**< @brief MQTTAgent_Publish() calls that failed. */
+} BenchProducer_t;
+
+/**
+ * @brief Benchmark parameters, see the options in the file comment.
+ */
+typedef struct BenchConfig
+{
+    uint32_t producers;
+    uint32_t commandsPerProducer;
+    uint32_t windowSize;
+    MQTTQoS_t qos;
+    uint32_t payloadLength;
+    uint32_t poolSize;
+    uint32_t poolOverflow;
+    uint32_t queueLength;
+    uint32_t batchSize;
+    #ifdef BENCH_TRANSPORT_FAULT
+        BenchFaultConfig_t fault;
+        bool faultEnabled;
+    #endif
+} BenchConfig_t;
+
+/*-----------------------------------------------------------*/
+
+static BenchConfig_t benchConfig =
+{
+    .producers           = 4U,
+    .commandsPerProducer = 100000U,
+    .windowSize          = 4U,
+    .qos                 = MQTTQoS1,
+    .payloadLength       = 64U,
+    .poolSize            = 10U,
+    .poolOverflow        = 0U,
+    .queueLength         = 25U,
+    .batchSize           = 1U
+};
+
+static MQTTAgentContext_t agentContext;
+static MQTTAgentMessageContext_t messageContext;
+static AgentCommandPool_t commandPool;
+static NetworkContext_t networkContext;
+
+/**
+ * @brief Publishes not yet completed or failed, over all producers.
+ */
+static uint32_t outstandingCommands;
+
+/**
+ * @brief When the last publish completed. Written by the agent thread.
+ */
+static uint64_t lastCompleteUs;
+
+/**
+ * @brief Lets all producers start at the same time.
+ */
+static pthread_barrier_t startBarrier;
+
+static uint8_t * pPayload;
+
+/**
+ * @brief Resource usage of the agent thread when it started and when its
+ * command loop returned.
+ */
+static struct rusage agentUsageStart;
+static struct rusage agentUsageEnd;
+
+AGENT_COMMAND_POOL_INTERFACE( bench, commandPool )
+
+/*-----------------------------------------------------------*/
+
+static uint64_t nowUs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000U ) + ( ( uint64_t ) now.tv_nsec / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getTimeMs( void )
+{
+    return ( uint32_t ) ( nowUs() / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void incomingPublish( MQTTAgentContext_t * pMqttAgentContext,
+                             uint16_t packetId,
+                             MQTTPublishInfo_t * pPublishInfo )
+{
+    /* The fake broker does not route publishes back. */
+    ( void ) pMqttAgentContext;
+    ( void ) packetId;
+    ( void ) pPublishInfo;
+}
+
+/*-----------------------------------------------------------*/
+
+static void commandDone( BenchProducer_t * pProducer,
+                         MQTTAgentCommandContext_t * pSlot )
+{
+    __atomic_store_n( &pSlot->busy, 0U, __ATOMIC_RELEASE );
+    ( void ) sem_post( &pProducer->freeSlots );
+    ( void ) __atomic_sub_fetch( &outstandingCommands, 1U, __ATOMIC_ACQ_REL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishComplete( MQTTAgentCommandContext_t * pCmdCallbackContext,
+                             MQTTAgentReturnInfo_t * pReturnInfo )
+{
+    BenchProducer_t * pProducer = pCmdCallbackContext->pProducer;
+    uint64_t completeUs = nowUs();
+
+    if( pReturnInfo->returnCode == MQTTSuccess )
+    {
+        pProducer->pLatencyUs[ pProducer->completed ] = ( uint32_t ) ( completeUs - pCmdCallbackContext->enqueueUs );
+        pProducer->completed++;
+    }
+    else
+    {
+        pProducer->completeFailed++;
+    }
+
+    lastCompleteUs = completeUs;
+    commandDone( pProducer, pCmdCallbackContext );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * producerThread( void * pArg )
+{
+    BenchProducer_t * pProducer = pArg;
+    MQTTAgentCommandContext_t * pSlot;
+    MQTTAgentCommandInfo_t commandInfo = { 0 };
+    uint32_t next = 0;
+    uint32_t i;
+
+    commandInfo.cmdCompleteCallback = publishComplete;
+    commandInfo.blockTimeMs = AGENT_MESSAGE_WAIT_FOREVER;
+
+    ( void ) pthread_barrier_wait( &startBarrier );
+
+    for( i = 0; i < benchConfig.commandsPerProducer; i++ )
+    {
+        while( sem_wait( &pProducer->freeSlots ) != 0 )
+        {
+            /* Interrupted by a signal. */
+        }
+
+        /* Completions arrive in order for one producer, so the next slot is
+         * almost always the free one. */
+        while( __atomic_load_n( &pProducer->pSlots[ next ].busy, __ATOMIC_ACQUIRE ) != 0U )
+        {
+            next = ( next + 1U ) % benchConfig.windowSize;
+        }
+
+        pSlot = &pProducer->pSlots[ next ];
+        next = ( next + 1U ) % benchConfig.windowSize;
+
+        pSlot->busy = 1U;
+        pSlot->enqueueUs = nowUs();
+        commandInfo.pCmdCompleteCallbackContext = pSlot;
+
+        if( MQTTAgent_Publish( &agentContext, &pSlot->publishInfo, &commandInfo ) != MQTTSuccess )
+        {
+            pProducer->enqueueFailed++;
+            commandDone( pProducer, pSlot );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * agentThread( void * pArg )
+{
+    MQTTStatus_t status;
+
+    ( void ) pArg;
+
+    ( void ) getrusage( RUSAGE_THREAD, &agentUsageStart );
+    status = MQTTAgent_CommandLoop( &agentContext );
+    ( void ) getrusage( RUSAGE_THREAD, &agentUsageEnd );
+
+    if( status != MQTTSuccess )
+    {
+        fprintf( stderr, "MQTTAgent_CommandLoop returned %s.\n", MQTT_Status_strerror( status ) );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static int compareLatency( const void * pLeft,
+                           const void * pRight )
+{
+    uint32_t left = *( const uint32_t * ) pLeft;
+    uint32_t right = *( const uint32_t * ) pRight;
+
+    return ( left > right ) - ( left < right );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t percentile( const uint32_t * pSorted,
+                            size_t count,
+                            uint32_t perMille )
+{
+    size_t index;
+
+    if( count == 0U )
+    {
+        return 0U;
+    }
+
+    index = ( ( count * perMille ) + 999U ) / 1000U;
+
+    return pSorted[ ( index > 0U ) ? ( index - 1U ) : 0U ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void printResults( BenchProducer_t * pProducers,
+                          uint64_t elapsedUs )
+{
+    AgentCommandPoolStats_t poolStats;
+    FakeBrokerStats_t brokerStats;
+    uint32_t * pAll;
+    size_t completed = 0;
+    uint32_t failed = 0;
+    uint32_t i;
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        completed += pProducers[ i ].completed;
+        failed += pProducers[ i ].completeFailed + pProducers[ i ].enqueueFailed;
+    }
+
+    pAll = malloc( ( completed + 1U ) * sizeof( uint32_t ) );
+
+    if( pAll == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return;
+    }
+
+    completed = 0;
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        memcpy( &pAll[ completed ], pProducers[ i ].pLatencyUs, pProducers[ i ].completed * sizeof( uint32_t ) );
+        completed += pProducers[ i ].completed;
+    }
+
+    qsort( pAll, completed, sizeof( uint32_t ), compareLatency );
+
+    printf( "producers %" PRIu32 ", window %" PRIu32 ", QoS %d, payload %" PRIu32 " bytes, pool %" PRIu32 "+%" PRIu32
+            ", queue %" PRIu32 ", batch %" PRIu32 "\n",
+            benchConfig.producers, benchConfig.windowSize, ( int ) benchConfig.qos, benchConfig.payloadLength,
+            benchConfig.poolSize, benchConfig.poolOverflow, benchConfig.queueLength, benchConfig.batchSize );
+    printf( "commands: %zu completed, %" PRIu32 " failed in %.3f s, %.0f commands/s\n",
+            completed, failed, ( double ) elapsedUs / 1e6,
+            ( elapsedUs > 0U ) ? ( ( double ) completed * 1e6 / ( double ) elapsedUs ) : 0.0 );
+    printf( "latency us: p50 %" PRIu32 ", p90 %" PRIu32 ", p99 %" PRIu32 ", p99.9 %" PRIu32 ", max %" PRIu32 "\n",
+            percentile( pAll, completed, 500U ), percentile( pAll, completed, 900U ),
+            percentile( pAll, completed, 990U ), percentile( pAll, completed, 999U ),
+            ( completed > 0U ) ? pAll[ completed - 1U ] : 0U );
+
+    Agent_PoolGetStats( &commandPool, &poolStats );
+    printf( "pool: high watermark %" PRIu32 ", exhausted %" PRIu32 ", waits %" PRIu32 " (total %" PRIu32 " ms, max %" PRIu32
+            " ms), failed %" PRIu32 ", overflow allocations %" PRIu32 " (high watermark %" PRIu32 ")\n",
+            poolStats.highWatermark, poolStats.exhaustedCount, poolStats.waitCount, poolStats.totalWaitMs,
+            poolStats.maxWaitMs, poolStats.failedCount, poolStats.overflowAllocations, poolStats.overflowHighWatermark );
+
+    FakeBroker_GetStats( &networkContext, &brokerStats );
+    printf( "broker: %" PRIu32 " publishes, %" PRIu64 " bytes, %" PRIu32 " responses dropped\n",
+            brokerStats.publishReceived, brokerStats.bytesReceived, brokerStats.responsesDropped );
+
+    #ifdef BENCH_TRANSPORT_FAULT
+        if( benchConfig.faultEnabled )
+        {
+            BenchFault_PrintStats();
+        }
+    #endif
+
+    free( pAll );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t contextSwitches( const struct rusage * pStart,
+                                 const struct rusage * pEnd )
+{
+    return ( uint64_t ) ( ( pEnd->ru_nvcsw - pStart->ru_nvcsw ) + ( pEnd->ru_nivcsw - pStart->ru_nivcsw ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void printContextSwitches( BenchProducer_t * pProducers,
+                                  const struct rusage * pProcessStart,
+                                  const struct rusage * pProcessEnd )
+{
+    uint64_t completed = 0U;
+    uint32_t i;
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        completed += pProducers[ i ].completed;
+    }
+
+    if( completed == 0U )
+    {
+        return;
+    }
+
+    /* The agent thread's count also covers connecting and terminating, a
+     * handful of switches. */
+    printf( "context switches per 1000 publishes: agent %.1f (%.1f voluntary), process %.1f\n",
+            ( double ) contextSwitches( &agentUsageStart, &agentUsageEnd ) * 1000.0 / ( double ) completed,
+            ( double ) ( agentUsageEnd.ru_nvcsw - agentUsageStart.ru_nvcsw ) * 1000.0 / ( double ) completed,
+            ( double ) contextSwitches( pProcessStart, pProcessEnd ) * 1000.0 / ( double ) completed );
+}
+
+/*-----------------------------------------------------------*/
+
+static int parseArguments( int argc,
+                           char ** argv )
+{
+    int option;
+    unsigned long value;
+
+    while( ( option = getopt( argc, argv, "t:n:w:q:s:p:o:l:b:f:L:J:P:S:T:" ) ) != -1 )
+    {
+        if( option == '?' )
+        {
+            return -1;
+        }
+
+        value = strtoul( optarg, NULL, 0 );
+
+        switch( option )
+        {
+            case 't':
+                benchConfig.producers = ( uint32_t ) value;
+                break;
+
+            case 'n':
+                benchConfig.commandsPerProducer = ( uint32_t ) value;
+                break;
+
+            case 'w':
+                benchConfig.windowSize = ( uint32_t ) value;
+                break;
+
+            case 'q':
+                benchConfig.qos = ( MQTTQoS_t ) value;
+                break;
+
+            case 's':
+                benchConfig.payloadLength = ( uint32_t ) value;
+                break;
+
+            case 'p':
+                benchConfig.poolSize = ( uint32_t ) value;
+                break;
+
+            case 'o':
+                benchConfig.poolOverflow = ( uint32_t ) value;
+                break;
+
+            case 'l':
+                benchConfig.queueLength = ( uint32_t ) value;
+                break;
+
+            case 'b':
+                benchConfig.batchSize = ( uint32_t ) value;
+                break;
+
+            #ifdef BENCH_TRANSPORT_FAULT
+                case 'f':
+                    benchConfig.fault.seed = ( uint32_t ) value;
+                    benchConfig.faultEnabled = true;
+                    break;
+
+                case 'L':
+                    benchConfig.fault.latencyMs = ( uint32_t ) value;
+                    break;
+
+                case 'J':
+                    benchConfig.fault.jitterMs = ( uint32_t ) value;
+                    break;
+
+                case 'P':
+                    benchConfig.fault.partialPerMille = ( uint16_t ) value;
+                    break;
+
+                case 'S':
+                    benchConfig.fault.stallPerMille = ( uint16_t ) value;
+                    break;
+
+                case 'T':
+                    benchConfig.fault.stallMs = ( uint32_t ) value;
+                    break;
+            #endif
+
+            default:
+                return -1;
+        }
+    }
+
+    if( ( benchConfig.producers == 0U ) || ( benchConfig.windowSize == 0U ) ||
+        ( benchConfig.qos > MQTTQoS2 ) || ( benchConfig.batchSize > AGENT_MESSAGE_BATCH_MAX ) )
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int setUp( BenchProducer_t * pProducers,
+                  uint8_t * pNetworkBuffer )
+{
+    MQTTAgentMessageInterface_t messageInterface = { 0 };
+    TransportInterface_t transport = { 0 };
+    MQTTFixedBuffer_t networkBuffer;
+    MQTTConnectInfo_t connectInfo = { 0 };
+    bool sessionPresent;
+    MQTTStatus_t status;
+    uint32_t i;
+    uint32_t j;
+
+    if( !Agent_PoolInit( &commandPool, benchConfig.poolSize, benchConfig.poolOverflow ) ||
+        !Agent_MessageInit( &messageContext, benchConfig.queueLength ) )
+    {
+        fprintf( stderr, "Invalid pool or queue size.\n" );
+        return -1;
+    }
+
+    messageContext.batchSize = ( uint8_t ) benchConfig.batchSize;
+
+    messageInterface.pMsgCtx = &messageContext;
+    messageInterface.send = Agent_MessageSend;
+    messageInterface.recv = Agent_MessageReceive;
+    messageInterface.getCommand = benchGetCommand;
+    messageInterface.releaseCommand = benchReleaseCommand;
+
+    FakeBroker_Init( &networkContext );
+    transport.pNetworkContext = &networkContext;
+    transport.send = FakeBroker_Send;
+    transport.recv = FakeBroker_Recv;
+    transport.writev = NULL;
+
+    #ifdef BENCH_TRANSPORT_FAULT
+        if( benchConfig.faultEnabled && !BenchFault_Wrap( &benchConfig.fault, &transport ) )
+        {
+            fprintf( stderr, "Invalid fault configuration.\n" );
+            return -1;
+        }
+    #endif
+
+    networkBuffer.pBuffer = pNetworkBuffer;
+    networkBuffer.size = BENCH_NETWORK_BUFFER_OVERHEAD + benchConfig.payloadLength;
+
+    status = MQTTAgent_Init( &agentContext, &messageInterface, &networkBuffer, &transport,
+                             getTimeMs, incomingPublish, NULL );
+
+    if( status == MQTTSuccess )
+    {
+        /* Connect before the agent loop starts, as the demos do. */
+        connectInfo.cleanSession = true;
+        connectInfo.pClientIdentifier = "agent_bench";
+        connectInfo.clientIdentifierLength = ( uint16_t ) strlen( connectInfo.pClientIdentifier );
+        status = MQTT_Connect( &agentContext.mqttContext, &connectInfo, NULL, 1000U, &sessionPresent );
+    }
+
+    if( status != MQTTSuccess )
+    {
+        fprintf( stderr, "Agent set up failed: %s.\n", MQTT_Status_strerror( status ) );
+        return -1;
+    }
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        pProducers[ i ].pSlots = calloc( benchConfig.windowSize, sizeof( MQTTAgentCommandContext_t ) );
+        pProducers[ i ].pLatencyUs = malloc( ( ( size_t ) benchConfig.commandsPerProducer + 1U ) * sizeof( uint32_t ) );
+
+        if( ( pProducers[ i ].pSlots == NULL ) || ( pProducers[ i ].pLatencyUs == NULL ) )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            return -1;
+        }
+
+        ( void ) snprintf( pProducers[ i ].topic, sizeof( pProducers[ i ].topic ), "bench/producer/%" PRIu32, i );
+        ( void ) sem_init( &pProducers[ i ].freeSlots, 0, benchConfig.windowSize );
+
+        for( j = 0; j < benchConfig.windowSize; j++ )
+        {
+            pProducers[ i ].pSlots[ j ].pProducer = &pProducers[ i ];
+            pProducers[ i ].pSlots[ j ].publishInfo.qos = benchConfig.qos;
+            pProducers[ i ].pSlots[ j ].publishInfo.pTopicName = pProducers[ i ].topic;
+            pProducers[ i ].pSlots[ j ].publishInfo.topicNameLength = ( uint16_t ) strlen( pProducers[ i ].topic );
+            pProducers[ i ].pSlots[ j ].publishInfo.pPayload = pPayload;
+            pProducers[ i ].pSlots[ j ].publishInfo.payloadLength = benchConfig.payloadLength;
+        }
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    BenchProducer_t * pProducers;
+    uint8_t * pNetworkBuffer;
+    MQTTAgentCommandInfo_t commandInfo = { 0 };
+    struct rusage processStart;
+    struct rusage processEnd;
+    pthread_t agent;
+    uint64_t startUs;
+    uint64_t deadlineUs;
+    uint32_t i;
+    int result = 0;
+
+    if( parseArguments( argc, argv ) != 0 )
+    {
+        fprintf( stderr, "usage: %s [-t producers] [-n publishes per producer] [-w window] [-q qos] "
+                         "[-s payload bytes] [-p pool size] [-o pool overflow] [-l queue length] [-b batch size] "
+                         "[-f fault seed] [-L latency ms] [-J jitter ms] [-P partial per mille] "
+                         "[-S stall per mille] [-T stall ms]\n",
+                 argv[ 0 ] );
+        return 2;
+    }
+
+    pProducers = calloc( benchConfig.producers, sizeof( BenchProducer_t ) );
+    pNetworkBuffer = malloc( BENCH_NETWORK_BUFFER_OVERHEAD + benchConfig.payloadLength );
+    pPayload = calloc( 1, benchConfig.payloadLength + 1U );
+
+    if( ( pProducers == NULL ) || ( pNetworkBuffer == NULL ) || ( pPayload == NULL ) ||
+        ( setUp( pProducers, pNetworkBuffer ) != 0 ) )
+    {
+        return 1;
+    }
+
+    outstandingCommands = benchConfig.producers * benchConfig.commandsPerProducer;
+    ( void ) pthread_barrier_init( &startBarrier, NULL, benchConfig.producers + 1U );
+    ( void ) pthread_create( &agent, NULL, agentThread, NULL );
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        ( void ) pthread_create( &pProducers[ i ].thread, NULL, producerThread, &pProducers[ i ] );
+    }
+
+    ( void ) pthread_barrier_wait( &startBarrier );
+    startUs = nowUs();
+    ( void ) getrusage( RUSAGE_SELF, &processStart );
+
+    for( i = 0; i < benchConfig.producers; i++ )
+    {
+        ( void ) pthread_join( pProducers[ i ].thread, NULL );
+    }
+
+    /* The agent drains the publishes still in flight. */
+    deadlineUs = nowUs() + ( BENCH_DRAIN_TIMEOUT_MS * 1000U );
+
+    while( ( __atomic_load_n( &outstandingCommands, __ATOMIC_ACQUIRE ) != 0U ) && ( nowUs() < deadlineUs ) )
+    {
+        ( void ) usleep( 1000U );
+    }
+
+    ( void ) getrusage( RUSAGE_SELF, &processEnd );
+
+    if( __atomic_load_n( &outstandingCommands, __ATOMIC_ACQUIRE ) != 0U )
+    {
+        fprintf( stderr, "%" PRIu32 " publishes did not complete.\n", outstandingCommands );
+        result = 1;
+    }
+    else
+    {
+        printResults( pProducers, lastCompleteUs - startUs );
+    }
+
+    commandInfo.blockTimeMs = AGENT_MESSAGE_WAIT_FOREVER;
+
+    if( MQTTAgent_Terminate( &agentContext, &commandInfo ) == MQTTSuccess )
+    {
+        ( void ) pthread_join( agent, NULL );
+
+        if( result == 0 )
+        {
+            printContextSwitches( pProducers, &processStart, &processEnd );
+        }
+    }
+
+    return result;
+}
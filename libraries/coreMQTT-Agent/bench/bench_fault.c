@@ -0,0 +1,57 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file bench_fault.c
+ * @brief Runs the benchmark transport through the transport_fault wrapper.
+ */
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "bench_fault.h"
+#include "transport_fault.h"
+
+/*-----------------------------------------------------------*/
+
+static TransportFault_t transportFault;
+static uint32_t faultSeed;
+
+/*-----------------------------------------------------------*/
+
+bool BenchFault_Wrap( const BenchFaultConfig_t * pConfig,
+                      TransportInterface_t * pTransport )
+{
+    TransportFaultConfig_t config = { 0 };
+
+    config.seed = pConfig->seed;
+    config.latencyMs = pConfig->latencyMs;
+    config.jitterMs = pConfig->jitterMs;
+    config.partialPerMille = pConfig->partialPerMille;
+    config.stallPerMille = pConfig->stallPerMille;
+    config.stallMs = pConfig->stallMs;
+    faultSeed = pConfig->seed;
+
+    return TransportFault_Wrap( &transportFault, &config, pTransport );
+}
+
+/*-----------------------------------------------------------*/
+
+void BenchFault_PrintStats( void )
+{
+    printf( "faults: seed %" PRIu32 ", %" PRIu32 " sends, %" PRIu32 " receives, %" PRIu32 " partials, %" PRIu32
+            " stalls, %" PRIu32 " ms delayed\n",
+            faultSeed, transportFault.stats.sendCalls, transportFault.stats.recvCalls,
+            transportFault.stats.partials, transportFault.stats.stalls, transportFault.stats.delayMs );
+}
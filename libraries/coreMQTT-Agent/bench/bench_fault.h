@@ -0,0 +1,62 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file bench_fault.h
+ * @brief Runs the benchmark transport through the transport_fault wrapper.
+ *
+ * Kept in its own library because transport_fault brings the posix_compat
+ * include directory, whose semaphore.h hides the system <semaphore.h> that
+ * agent_bench.c uses. Host builds only.
+ */
+
+#ifndef BENCH_FAULT_H_
+#define BENCH_FAULT_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief The faults the benchmark injects, a subset of TransportFaultConfig_t.
+ */
+typedef struct BenchFaultConfig
+{
+    uint32_t seed;            /**< @brief Seed of the schedule. */
+    uint32_t latencyMs;       /**< @brief Delay added to each send, and to each receive that returns data. */
+    uint32_t jitterMs;        /**< @brief Random extra delay of 0 to jitterMs. */
+    uint16_t partialPerMille; /**< @brief Chance of a partial read or write. */
+    uint16_t stallPerMille;   /**< @brief Chance that a call starts a stall. */
+    uint32_t stallMs;         /**< @brief Length of a stall. */
+} BenchFaultConfig_t;
+
+/**
+ * @brief Wrap the benchmark transport. At most one transport is wrapped.
+ *
+ * @param[in] pConfig Faults to inject.
+ * @param[in,out] pTransport Transport to wrap.
+ *
+ * @return false if the wrapper rejected the configuration.
+ */
+bool BenchFault_Wrap( const BenchFaultConfig_t * pConfig,
+                      TransportInterface_t * pTransport );
+
+/**
+ * @brief Print the counters of the injected faults.
+ */
+void BenchFault_PrintStats( void );
+
+#endif /* ifndef BENCH_FAULT_H_ */
@@ -0,0 +1,293 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file command_pool_bench.c
+ * @brief Host benchmark of the lock-free command pool against the queue of
+ * pointers it replaced.
+ *
+ * N tasks each acquire and release commands in a loop, holding up to a given
+ * number at a time, first from an AgentCommandPool_t and then from a FreeRTOS
+ * queue preloaded with pointers to the same number of commands, the way
+ * freertos_command_pool.c used to work. Both run on the FreeRTOS shim of the
+ * posix_compat host build, where a queue operation takes a mutex as a kernel
+ * critical section would. The benchmark prints the acquire plus release
+ * pairs per second of each and their ratio:
+ *
+ * @code
+ * coremqtt_agent_command_pool_bench -t 4 -n 1000000 -p 10 -k 2
+ * @endcode
+ *
+ * Options: -t tasks, -n acquire and release pairs per task, -p pool size,
+ * -k commands each task holds at a time.
+ */
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Kernel includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/* MQTT agent includes. */
+#include "freertos_command_pool.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief How long an acquire may block before the run counts it as failed.
+ */
+#define BENCH_BLOCK_TIME_MS    ( 10000U )
+
+/**
+ * @brief Most commands a task may hold at a time.
+ */
+#define BENCH_MAX_HELD         ( 16U )
+
+/**
+ * @brief The two pools under test.
+ */
+typedef enum BenchPoolKind
+{
+    BENCH_POOL_LOCK_FREE,
+    BENCH_POOL_QUEUE
+} BenchPoolKind_t;
+
+static BenchPoolKind_t poolKind;
+static AgentCommandPool_t lockFreePool;
+static QueueHandle_t commandQueue;
+static MQTTAgentCommand_t * pQueueCommands;
+
+static uint32_t pairsPerTask;
+static uint32_t heldPerTask;
+static uint32_t failedAcquires;
+static TaskHandle_t mainTask;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t nowUs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000U ) + ( ( uint64_t ) now.tv_nsec / 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentCommand_t * acquire( void )
+{
+    MQTTAgentCommand_t * pCommand = NULL;
+
+    if( poolKind == BENCH_POOL_LOCK_FREE )
+    {
+        pCommand = Agent_PoolGetCommand( &lockFreePool, BENCH_BLOCK_TIME_MS );
+    }
+    else if( xQueueReceive( commandQueue, &pCommand, pdMS_TO_TICKS( BENCH_BLOCK_TIME_MS ) ) != pdTRUE )
+    {
+        pCommand = NULL;
+    }
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+static void release( MQTTAgentCommand_t * pCommand )
+{
+    if( poolKind == BENCH_POOL_LOCK_FREE )
+    {
+        ( void ) Agent_PoolReleaseCommand( &lockFreePool, pCommand );
+    }
+    else
+    {
+        ( void ) xQueueSendToBack( commandQueue, &pCommand, 0U );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void benchTask( void * pvParameters )
+{
+    MQTTAgentCommand_t * pHeld[ BENCH_MAX_HELD ];
+    uint32_t pairs = 0U;
+
+    ( void ) pvParameters;
+
+    while( pairs < pairsPerTask )
+    {
+        uint32_t count = 0U;
+        uint32_t i;
+
+        while( ( count < heldPerTask ) && ( pairs + count < pairsPerTask ) )
+        {
+            pHeld[ count ] = acquire();
+
+            if( pHeld[ count ] == NULL )
+            {
+                __atomic_add_fetch( &failedAcquires, 1U, __ATOMIC_RELAXED );
+                break;
+            }
+
+            count++;
+        }
+
+        for( i = 0U; i < count; i++ )
+        {
+            release( pHeld[ i ] );
+        }
+
+        pairs += ( count > 0U ) ? count : 1U;
+    }
+
+    ( void ) xTaskNotifyGive( mainTask );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static double runBench( BenchPoolKind_t kind,
+                        uint32_t tasks )
+{
+    uint64_t startUs;
+    uint64_t elapsedUs;
+    uint32_t i;
+
+    poolKind = kind;
+    startUs = nowUs();
+
+    for( i = 0U; i < tasks; i++ )
+    {
+        if( xTaskCreate( benchTask, "bench", 4096, NULL, 5, NULL ) != pdPASS )
+        {
+            fprintf( stderr, "failed to create task %" PRIu32 "\n", i );
+            exit( 1 );
+        }
+    }
+
+    for( i = 0U; i < tasks; i++ )
+    {
+        ( void ) ulTaskNotifyTake( pdFALSE, portMAX_DELAY );
+    }
+
+    elapsedUs = nowUs() - startUs;
+
+    return ( elapsedUs > 0U ) ? ( ( double ) tasks * ( double ) pairsPerTask * 1e6 / ( double ) elapsedUs ) : 0.0;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t tasks = 4U;
+    uint32_t poolSize = 10U;
+    AgentCommandPoolStats_t stats;
+    double lockFreeRate;
+    double queueRate;
+    int option;
+    uint32_t i;
+
+    pairsPerTask = 1000000U;
+    heldPerTask = 1U;
+
+    while( ( option = getopt( argc, argv, "t:n:p:k:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 't':
+                tasks = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'n':
+                pairsPerTask = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'p':
+                poolSize = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            case 'k':
+                heldPerTask = ( uint32_t ) strtoul( optarg, NULL, 0 );
+                break;
+
+            default:
+                fprintf( stderr, "usage: %s [-t tasks] [-n pairs per task] [-p pool size] [-k held per task]\n", argv[ 0 ] );
+                return 1;
+        }
+    }
+
+    /* Every task must be able to hold its commands at once, or they could
+     * deadlock each holding part of the pool. */
+    if( ( tasks == 0U ) || ( pairsPerTask == 0U ) || ( heldPerTask == 0U ) || ( heldPerTask > BENCH_MAX_HELD ) ||
+        ( poolSize < heldPerTask ) || ( poolSize > 65534U ) ||
+        ( ( heldPerTask > 1U ) && ( poolSize < tasks * heldPerTask ) ) )
+    {
+        fprintf( stderr, "invalid options\n" );
+        return 1;
+    }
+
+    mainTask = xTaskGetCurrentTaskHandle();
+
+    if( !Agent_PoolInit( &lockFreePool, poolSize, 0U ) )
+    {
+        fprintf( stderr, "failed to create the pool\n" );
+        return 1;
+    }
+
+    pQueueCommands = calloc( poolSize, sizeof( MQTTAgentCommand_t ) );
+    commandQueue = xQueueCreate( poolSize, sizeof( MQTTAgentCommand_t * ) );
+
+    if( ( pQueueCommands == NULL ) || ( commandQueue == NULL ) )
+    {
+        fprintf( stderr, "failed to create the queue\n" );
+        return 1;
+    }
+
+    for( i = 0U; i < poolSize; i++ )
+    {
+        MQTTAgentCommand_t * pCommand = &pQueueCommands[ i ];
+
+        ( void ) xQueueSendToBack( commandQueue, &pCommand, 0U );
+    }
+
+    lockFreeRate = runBench( BENCH_POOL_LOCK_FREE, tasks );
+    queueRate = runBench( BENCH_POOL_QUEUE, tasks );
+
+    Agent_PoolGetStats( &lockFreePool, &stats );
+
+    printf( "tasks %" PRIu32 ", pool %" PRIu32 ", held %" PRIu32 ", %" PRIu32 " pairs per task\n",
+            tasks, poolSize, heldPerTask, pairsPerTask );
+    printf( "lock-free pool: %.0f pairs/s (%" PRIu32 " waits, %" PRIu32 " ms waited)\n",
+            lockFreeRate, stats.waitCount, stats.totalWaitMs );
+    printf( "queue pool:     %.0f pairs/s\n", queueRate );
+    printf( "ratio:          %.2fx\n", ( queueRate > 0.0 ) ? ( lockFreeRate / queueRate ) : 0.0 );
+
+    Agent_PoolDelete( &lockFreePool );
+    vQueueDelete( commandQueue );
+    free( pQueueCommands );
+
+    if( failedAcquires != 0U )
+    {
+        fprintf( stderr, "%" PRIu32 " acquires timed out\n", failedAcquires );
+        return 1;
+    }
+
+    return 0;
+}
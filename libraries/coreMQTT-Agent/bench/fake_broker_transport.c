@@ -0,0 +1,349 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file fake_broker_transport.c
+ * @brief Loopback transport that answers coreMQTT like a broker would.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "fake_broker_transport.h"
+
+/*-----------------------------------------------------------*/
+
+/* MQTT control packet types, the high nibble of the first header byte. */
+#define PACKET_CONNECT        ( 1U )
+#define PACKET_CONNACK        ( 2U )
+#define PACKET_PUBLISH        ( 3U )
+#define PACKET_PUBACK         ( 4U )
+#define PACKET_PUBREC         ( 5U )
+#define PACKET_PUBREL         ( 6U )
+#define PACKET_PUBCOMP        ( 7U )
+#define PACKET_SUBSCRIBE      ( 8U )
+#define PACKET_SUBACK         ( 9U )
+#define PACKET_UNSUBSCRIBE    ( 10U )
+#define PACKET_UNSUBACK       ( 11U )
+#define PACKET_PINGREQ        ( 12U )
+#define PACKET_PINGRESP       ( 13U )
+
+/* States of the packet parser. */
+#define PARSE_TYPE            ( 0U )
+#define PARSE_LENGTH          ( 1U )
+#define PARSE_BODY            ( 2U )
+
+/**
+ * @brief Most topic filters acknowledged by one SUBACK. Keeps the remaining
+ * length of the SUBACK to one byte.
+ */
+#define SUBACK_MAX_CODES      ( 64U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue an acknowledgement. Called with the lock held.
+ */
+static void queueResponse( NetworkContext_t * pNetworkContext,
+                           const uint8_t * pResponse,
+                           size_t length )
+{
+    if( ( pNetworkContext->responseLength + length ) > sizeof( pNetworkContext->response ) )
+    {
+        pNetworkContext->stats.responsesDropped++;
+        return;
+    }
+
+    if( ( pNetworkContext->responseHead + pNetworkContext->responseLength + length ) >
+        sizeof( pNetworkContext->response ) )
+    {
+        memmove( pNetworkContext->response,
+                 &pNetworkContext->response[ pNetworkContext->responseHead ],
+                 pNetworkContext->responseLength );
+        pNetworkContext->responseHead = 0;
+    }
+
+    memcpy( &pNetworkContext->response[ pNetworkContext->responseHead + pNetworkContext->responseLength ],
+            pResponse, length );
+    pNetworkContext->responseLength += length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue an acknowledgement that carries only a packet identifier.
+ */
+static void queueAck( NetworkContext_t * pNetworkContext,
+                      uint8_t firstByte,
+                      const uint8_t * pPacketId )
+{
+    uint8_t ack[ 4 ] = { firstByte, 2U, pPacketId[ 0 ], pPacketId[ 1 ] };
+
+    queueResponse( pNetworkContext, ack, sizeof( ack ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Acknowledge a SUBSCRIBE, granting the QoS of every topic filter
+ * found in the kept part of the packet.
+ */
+static void queueSuback( NetworkContext_t * pNetworkContext,
+                         size_t kept )
+{
+    uint8_t suback[ 4 + SUBACK_MAX_CODES ];
+    size_t codes = 0;
+    size_t offset = 2;
+    size_t filterLength;
+
+    while( ( ( offset + 2U ) < kept ) && ( codes < SUBACK_MAX_CODES ) )
+    {
+        filterLength = ( ( size_t ) pNetworkContext->body[ offset ] << 8 ) | pNetworkContext->body[ offset + 1U ];
+        offset += 2U + filterLength;
+
+        if( offset >= kept )
+        {
+            break;
+        }
+
+        suback[ 4U + codes ] = pNetworkContext->body[ offset ] & 0x03U;
+        codes++;
+        offset++;
+    }
+
+    suback[ 0 ] = ( uint8_t ) ( PACKET_SUBACK << 4 );
+    suback[ 1 ] = ( uint8_t ) ( 2U + codes );
+    suback[ 2 ] = pNetworkContext->body[ 0 ];
+    suback[ 3 ] = pNetworkContext->body[ 1 ];
+    queueResponse( pNetworkContext, suback, 4U + codes );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer a complete packet. Called with the lock held.
+ */
+static void handlePacket( NetworkContext_t * pNetworkContext )
+{
+    static const uint8_t connack[ 4 ] = { PACKET_CONNACK << 4, 2U, 0U, 0U };
+    static const uint8_t pingresp[ 2 ] = { PACKET_PINGRESP << 4, 0U };
+    uint8_t type = pNetworkContext->packetType >> 4;
+    uint8_t qos;
+    size_t kept = pNetworkContext->remainingLength;
+    size_t idOffset;
+
+    if( kept > sizeof( pNetworkContext->body ) )
+    {
+        kept = sizeof( pNetworkContext->body );
+    }
+
+    pNetworkContext->stats.packetsReceived++;
+
+    switch( type )
+    {
+        case PACKET_CONNECT:
+            queueResponse( pNetworkContext, connack, sizeof( connack ) );
+            break;
+
+        case PACKET_PUBLISH:
+            pNetworkContext->stats.publishReceived++;
+            qos = ( pNetworkContext->packetType >> 1 ) & 0x03U;
+
+            if( ( qos > 0U ) && ( kept >= 2U ) )
+            {
+                /* The packet identifier follows the topic name. */
+                idOffset = 2U + ( ( ( size_t ) pNetworkContext->body[ 0 ] << 8 ) | pNetworkContext->body[ 1 ] );
+
+                if( ( idOffset + 2U ) <= kept )
+                {
+                    queueAck( pNetworkContext,
+                              ( uint8_t ) ( ( ( qos == 1U ) ? PACKET_PUBACK : PACKET_PUBREC ) << 4 ),
+                              &pNetworkContext->body[ idOffset ] );
+                }
+            }
+
+            break;
+
+        case PACKET_PUBREL:
+
+            if( kept >= 2U )
+            {
+                queueAck( pNetworkContext, PACKET_PUBCOMP << 4, pNetworkContext->body );
+            }
+
+            break;
+
+        case PACKET_SUBSCRIBE:
+
+            if( kept >= 2U )
+            {
+                queueSuback( pNetworkContext, kept );
+            }
+
+            break;
+
+        case PACKET_UNSUBSCRIBE:
+
+            if( kept >= 2U )
+            {
+                queueAck( pNetworkContext, PACKET_UNSUBACK << 4, pNetworkContext->body );
+            }
+
+            break;
+
+        case PACKET_PINGREQ:
+            queueResponse( pNetworkContext, pingresp, sizeof( pingresp ) );
+            break;
+
+        default:
+            /* DISCONNECT and acknowledgements of server publishes need no
+             * answer. */
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void FakeBroker_Init( NetworkContext_t * pNetworkContext )
+{
+    ( void ) pthread_mutex_init( &pNetworkContext->lock, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+void FakeBroker_Deinit( NetworkContext_t * pNetworkContext )
+{
+    ( void ) pthread_mutex_destroy( &pNetworkContext->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+void FakeBroker_GetStats( NetworkContext_t * pNetworkContext,
+                          FakeBrokerStats_t * pStats )
+{
+    ( void ) pthread_mutex_lock( &pNetworkContext->lock );
+    *pStats = pNetworkContext->stats;
+    ( void ) pthread_mutex_unlock( &pNetworkContext->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t FakeBroker_Recv( NetworkContext_t * pNetworkContext,
+                         void * pBuffer,
+                         size_t bytesToRecv )
+{
+    size_t length;
+
+    ( void ) pthread_mutex_lock( &pNetworkContext->lock );
+
+    length = pNetworkContext->responseLength;
+
+    if( length > bytesToRecv )
+    {
+        length = bytesToRecv;
+    }
+
+    memcpy( pBuffer, &pNetworkContext->response[ pNetworkContext->responseHead ], length );
+    pNetworkContext->responseHead += length;
+    pNetworkContext->responseLength -= length;
+
+    if( pNetworkContext->responseLength == 0U )
+    {
+        pNetworkContext->responseHead = 0;
+    }
+
+    ( void ) pthread_mutex_unlock( &pNetworkContext->lock );
+
+    return ( int32_t ) length;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t FakeBroker_Send( NetworkContext_t * pNetworkContext,
+                         const void * pBuffer,
+                         size_t bytesToSend )
+{
+    const uint8_t * pBytes = pBuffer;
+    size_t i;
+    size_t chunk;
+    size_t keep;
+
+    ( void ) pthread_mutex_lock( &pNetworkContext->lock );
+
+    pNetworkContext->stats.bytesReceived += bytesToSend;
+
+    for( i = 0; i < bytesToSend; i++ )
+    {
+        switch( pNetworkContext->parseState )
+        {
+            case PARSE_TYPE:
+                pNetworkContext->packetType = pBytes[ i ];
+                pNetworkContext->remainingLength = 0;
+                pNetworkContext->remainingShift = 0;
+                pNetworkContext->bodyReceived = 0;
+                pNetworkContext->parseState = PARSE_LENGTH;
+                break;
+
+            case PARSE_LENGTH:
+                pNetworkContext->remainingLength |= ( uint32_t ) ( pBytes[ i ] & 0x7FU ) << pNetworkContext->remainingShift;
+                pNetworkContext->remainingShift += 7U;
+
+                if( ( pBytes[ i ] & 0x80U ) == 0U )
+                {
+                    if( pNetworkContext->remainingLength == 0U )
+                    {
+                        handlePacket( pNetworkContext );
+                        pNetworkContext->parseState = PARSE_TYPE;
+                    }
+                    else
+                    {
+                        pNetworkContext->parseState = PARSE_BODY;
+                    }
+                }
+
+                break;
+
+            default:
+                /* Take as much of the body as this write holds; only the
+                 * leading bytes are kept. */
+                chunk = pNetworkContext->remainingLength - pNetworkContext->bodyReceived;
+
+                if( chunk > ( bytesToSend - i ) )
+                {
+                    chunk = bytesToSend - i;
+                }
+
+                if( pNetworkContext->bodyReceived < sizeof( pNetworkContext->body ) )
+                {
+                    keep = sizeof( pNetworkContext->body ) - pNetworkContext->bodyReceived;
+                    memcpy( &pNetworkContext->body[ pNetworkContext->bodyReceived ], &pBytes[ i ],
+                            ( chunk < keep ) ? chunk : keep );
+                }
+
+                pNetworkContext->bodyReceived += ( uint32_t ) chunk;
+                i += chunk - 1U;
+
+                if( pNetworkContext->bodyReceived == pNetworkContext->remainingLength )
+                {
+                    handlePacket( pNetworkContext );
+                    pNetworkContext->parseState = PARSE_TYPE;
+                }
+
+                break;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pNetworkContext->lock );
+
+    return ( int32_t ) bytesToSend;
+}
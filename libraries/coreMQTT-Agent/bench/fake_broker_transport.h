@@ -0,0 +1,123 @@
+// Copyright 2021 Espressif Systems (Shanghai) CO LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+/**
+ * @file fake_broker_transport.h
+ * @brief Loopback transport that answers coreMQTT like a broker would.
+ *
+ * Every packet written with FakeBroker_Send() is parsed as it arrives and
+ * acknowledged straight away: CONNACK, PUBACK, PUBREC/PUBCOMP, SUBACK,
+ * UNSUBACK and PINGRESP are queued for FakeBroker_Recv(). Publishes are not
+ * routed anywhere. There is no socket and no I/O wait, so a benchmark on top
+ * of it measures the agent, its queue and its command pool, not the network.
+ * Host builds only.
+ */
+
+#ifndef FAKE_BROKER_TRANSPORT_H_
+#define FAKE_BROKER_TRANSPORT_H_
+
+/* Standard includes. */
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+/**
+ * @brief Size of the queue of acknowledgements waiting to be received.
+ */
+#ifndef FAKE_BROKER_RESPONSE_BUFFER_SIZE
+    #define FAKE_BROKER_RESPONSE_BUFFER_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief Leading bytes after the fixed header kept for parsing. The rest of a
+ * packet, e.g. a publish payload, is counted and dropped.
+ */
+#define FAKE_BROKER_HEADER_KEEP                 ( 256U )
+
+/**
+ * @brief Traffic counters of a fake broker.
+ */
+typedef struct FakeBrokerStats
+{
+    uint64_t bytesReceived;    /**< @brief Bytes written by the client. */
+    uint32_t publishReceived;  /**< @brief PUBLISH packets from the client. */
+    uint32_t packetsReceived;  /**< @brief Packets of any type from the client. */
+    uint32_t responsesDropped; /**< @brief Acknowledgements lost to a full response queue. */
+} FakeBrokerStats_t;
+
+/**
+ * @brief The transport's network context. Zero-initialise and pass to
+ * FakeBroker_Init().
+ */
+struct NetworkContext
+{
+    pthread_mutex_t lock; /**< @brief Guards everything below. */
+
+    /* Parser state of the packet being received. */
+    uint8_t parseState;                      /**< @brief Which part of the packet comes next. */
+    uint8_t packetType;                      /**< @brief First byte of the fixed header. */
+    uint32_t remainingLength;                /**< @brief Remaining length field, once decoded. */
+    uint32_t remainingShift;                 /**< @brief Decoding position in the remaining length field. */
+    uint32_t bodyReceived;                   /**< @brief Bytes of the packet after the fixed header. */
+    uint8_t body[ FAKE_BROKER_HEADER_KEEP ]; /**< @brief Leading bytes after the fixed header. */
+
+    /* Acknowledgements waiting for FakeBroker_Recv(). */
+    uint8_t response[ FAKE_BROKER_RESPONSE_BUFFER_SIZE ];
+    size_t responseHead;   /**< @brief Next byte to receive. */
+    size_t responseLength; /**< @brief Bytes queued. */
+
+    FakeBrokerStats_t stats; /**< @brief Traffic counters. */
+};
+
+/**
+ * @brief Prepare a zero-initialised context.
+ *
+ * @param[in] pNetworkContext The context to prepare.
+ */
+void FakeBroker_Init( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Release the resources of a context. No thread may be using it.
+ *
+ * @param[in] pNetworkContext The context to release.
+ */
+void FakeBroker_Deinit( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Read the traffic counters.
+ *
+ * @param[in] pNetworkContext The context to read.
+ * @param[out] pStats Where to store the counters.
+ */
+void FakeBroker_GetStats( NetworkContext_t * pNetworkContext,
+                          FakeBrokerStats_t * pStats );
+
+/**
+ * @brief TransportRecv_t of the fake broker. Returns queued acknowledgement
+ * bytes, or 0 at once if there are none.
+ */
+int32_t FakeBroker_Recv( NetworkContext_t * pNetworkContext,
+                         void * pBuffer,
+                         size_t bytesToRecv );
+
+/**
+ * @brief TransportSend_t of the fake broker. Accepts and parses all the bytes.
+ */
+int32_t FakeBroker_Send( NetworkContext_t * pNetworkContext,
+                         const void * pBuffer,
+                         size_t bytesToSend );
+
+#endif /* FAKE_BROKER_TRANSPORT_H_ */
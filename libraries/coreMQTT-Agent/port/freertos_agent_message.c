@@ -27,6 +27,219 @@
 /* Header include. */
 #include "freertos_agent_message.h"
 #include "core_mqtt_agent_message_interface.h"
+#include "core_mqtt_agent.h"
+
+/*-----------------------------------------------------------*/
+
+/* Disconnect and terminate share the bulk lane with publishes, so that they
+ * run after the publishes sent before them instead of cutting those off. */
+static AgentMessageLane_t defaultClassifier( const MQTTAgentCommand_t * pCommand )
+{
+    AgentMessageLane_t lane = AGENT_MESSAGE_LANE_CONTROL;
+
+    if( ( pCommand->commandType == PUBLISH ) ||
+        ( pCommand->commandType == DISCONNECT ) ||
+        ( pCommand->commandType == TERMINATE ) )
+    {
+        lane = AGENT_MESSAGE_LANE_BULK;
+    }
+
+    return lane;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Queue of a lane, falling back to lower priority lanes that were merged. */
+static QueueHandle_t laneQueue( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageLane_t * pLane )
+{
+    while( ( *pLane < AGENT_MESSAGE_LANE_BULK ) && ( pMsgCtx->laneQueues[ *pLane ] == NULL ) )
+    {
+        ( *pLane )++;
+    }
+
+    return pMsgCtx->laneQueues[ *pLane ];
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendToLane( MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t * const * pCommandToSend,
+                        uint32_t blockTimeMs )
+{
+    AgentMessageClassifier_t classify = ( pMsgCtx->classify != NULL ) ? pMsgCtx->classify : defaultClassifier;
+    AgentMessageLane_t lane = classify( *pCommandToSend );
+
+    if( lane >= AGENT_MESSAGE_LANE_COUNT )
+    {
+        lane = AGENT_MESSAGE_LANE_BULK;
+    }
+
+    QueueHandle_t queue = laneQueue( pMsgCtx, &lane );
+    AgentMessageLaneStats_t * pStats = &pMsgCtx->laneStats[ lane ];
+
+    if( xQueueSendToBack( queue, pCommandToSend, pdMS_TO_TICKS( blockTimeMs ) ) != pdPASS )
+    {
+        return false;
+    }
+
+    /* Count the command only once it can be received. */
+    ( void ) xSemaphoreGive( pMsgCtx->pending );
+
+    uint32_t depth = ( uint32_t ) uxQueueMessagesWaiting( queue );
+
+    __atomic_add_fetch( &pStats->sent, 1U, __ATOMIC_RELAXED );
+
+    if( depth > __atomic_load_n( &pStats->maxDepth, __ATOMIC_RELAXED ) )
+    {
+        /* Racy by design: a metric, not worth a critical section. */
+        __atomic_store_n( &pStats->maxDepth, depth, __ATOMIC_RELAXED );
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveFromLanes( MQTTAgentMessageContext_t * pMsgCtx,
+                              MQTTAgentCommand_t ** pReceivedCommand,
+                              uint32_t blockTimeMs )
+{
+    bool weighted = false;
+    size_t lane;
+    size_t round;
+
+    /* Each count taken guarantees a queued command in one of the lanes. */
+    if( xSemaphoreTake( pMsgCtx->pending, pdMS_TO_TICKS( blockTimeMs ) ) != pdPASS )
+    {
+        return false;
+    }
+
+    for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+    {
+        weighted = weighted || ( pMsgCtx->weights[ lane ] != 0U );
+    }
+
+    /* Weighted: serve the highest priority lane that has credit left, and
+     * start a new round once no lane with commands has credit. Strict
+     * priority, and the last resort of a weighted round, ignores credit. */
+    for( round = 0; round < 3U; round++ )
+    {
+        bool useCredit = weighted && ( round < 2U );
+
+        if( useCredit && ( round == 1U ) )
+        {
+            for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+            {
+                pMsgCtx->credits[ lane ] = pMsgCtx->weights[ lane ];
+            }
+        }
+
+        for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+        {
+            if( ( pMsgCtx->laneQueues[ lane ] == NULL ) ||
+                ( useCredit && ( pMsgCtx->credits[ lane ] == 0U ) ) )
+            {
+                continue;
+            }
+
+            if( xQueueReceive( pMsgCtx->laneQueues[ lane ], pReceivedCommand, 0U ) == pdPASS )
+            {
+                if( useCredit )
+                {
+                    pMsgCtx->credits[ lane ]--;
+                }
+
+                __atomic_add_fetch( &pMsgCtx->laneStats[ lane ].received, 1U, __ATOMIC_RELAXED );
+                return true;
+            }
+        }
+
+        if( !weighted )
+        {
+            break;
+        }
+    }
+
+    /* Not reached while the counts match the queued commands. */
+    configASSERT( false );
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageInitLanes( MQTTAgentMessageContext_t * pMsgCtx,
+                             const uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ],
+                             AgentMessageClassifier_t classify )
+{
+    uint32_t total = 0U;
+    size_t lane;
+
+    if( ( pMsgCtx == NULL ) || ( laneLengths == NULL ) ||
+        ( laneLengths[ AGENT_MESSAGE_LANE_BULK ] == 0U ) || ( pMsgCtx->pending != NULL ) )
+    {
+        return false;
+    }
+
+    for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+    {
+        if( laneLengths[ lane ] != 0U )
+        {
+            pMsgCtx->laneQueues[ lane ] = xQueueCreate( laneLengths[ lane ], sizeof( MQTTAgentCommand_t * ) );
+
+            if( pMsgCtx->laneQueues[ lane ] == NULL )
+            {
+                break;
+            }
+
+            total += laneLengths[ lane ];
+        }
+    }
+
+    if( lane == AGENT_MESSAGE_LANE_COUNT )
+    {
+        pMsgCtx->pending = xSemaphoreCreateCounting( total, 0U );
+    }
+
+    if( pMsgCtx->pending == NULL )
+    {
+        for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+        {
+            if( pMsgCtx->laneQueues[ lane ] != NULL )
+            {
+                vQueueDelete( pMsgCtx->laneQueues[ lane ] );
+                pMsgCtx->laneQueues[ lane ] = NULL;
+            }
+        }
+
+        return false;
+    }
+
+    pMsgCtx->queue = pMsgCtx->laneQueues[ AGENT_MESSAGE_LANE_BULK ];
+    pMsgCtx->classify = classify;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageGetLaneStats( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageLane_t lane,
+                                AgentMessageLaneStats_t * pStats )
+{
+    if( ( pMsgCtx == NULL ) || ( pStats == NULL ) || ( lane >= AGENT_MESSAGE_LANE_COUNT ) ||
+        ( pMsgCtx->laneQueues[ lane ] == NULL ) )
+    {
+        return false;
+    }
+
+    pStats->depth = ( uint32_t ) uxQueueMessagesWaiting( pMsgCtx->laneQueues[ lane ] );
+    pStats->maxDepth = __atomic_load_n( &pMsgCtx->laneStats[ lane ].maxDepth, __ATOMIC_RELAXED );
+    pStats->sent = __atomic_load_n( &pMsgCtx->laneStats[ lane ].sent, __ATOMIC_RELAXED );
+    pStats->received = __atomic_load_n( &pMsgCtx->laneStats[ lane ].received, __ATOMIC_RELAXED );
+
+    return true;
+}
 
 /*-----------------------------------------------------------*/
 
@@ -38,6 +251,11 @@ bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
 
     if( ( pMsgCtx != NULL ) && ( pCommandToSend != NULL ) )
     {
+        if( pMsgCtx->pending != NULL )
+        {
+            return sendToLane( pMsgCtx, pCommandToSend, blockTimeMs );
+        }
+
         queueStatus = xQueueSendToBack( pMsgCtx->queue, pCommandToSend, pdMS_TO_TICKS( blockTimeMs ) );
     }
 
@@ -46,16 +264,90 @@ bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
 
 /*-----------------------------------------------------------*/
 
+/* Receive one command directly from the queues, bypassing the batch buffer. */
+static bool receiveOne( MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t ** pReceivedCommand,
+                        uint32_t blockTimeMs )
+{
+    if( pMsgCtx->pending != NULL )
+    {
+        return receiveFromLanes( pMsgCtx, pReceivedCommand, blockTimeMs );
+    }
+
+    return ( xQueueReceive( pMsgCtx->queue, pReceivedCommand, pdMS_TO_TICKS( blockTimeMs ) ) == pdPASS ) ? true : false;
+}
+
+/*-----------------------------------------------------------*/
+
 bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
                            MQTTAgentCommand_t ** pReceivedCommand,
                            uint32_t blockTimeMs )
 {
-    BaseType_t queueStatus = pdFAIL;
+    size_t batchSize;
 
-    if( ( pMsgCtx != NULL ) && ( pReceivedCommand != NULL ) )
+    if( ( pMsgCtx == NULL ) || ( pReceivedCommand == NULL ) )
     {
-        queueStatus = xQueueReceive( pMsgCtx->queue, pReceivedCommand, pdMS_TO_TICKS( blockTimeMs ) );
+        return false;
     }
 
-    return ( queueStatus == pdPASS ) ? true : false;
+    batchSize = ( pMsgCtx->batchSize < AGENT_MESSAGE_BATCH_MAX ) ? pMsgCtx->batchSize : AGENT_MESSAGE_BATCH_MAX;
+
+    if( ( pMsgCtx->batchCount == 0U ) && ( batchSize > 1U ) && ( pMsgCtx->pending == NULL ) )
+    {
+        /* Drain what is queued in one go; the agent then processes it back
+         * to back without touching the queue again. */
+        pMsgCtx->batchHead = 0U;
+        pMsgCtx->batchCount = ( uint8_t ) Agent_MessageReceiveBatch( pMsgCtx, pMsgCtx->batch,
+                                                                     batchSize, blockTimeMs );
+    }
+
+    if( pMsgCtx->batchCount > 0U )
+    {
+        *pReceivedCommand = pMsgCtx->batch[ pMsgCtx->batchHead++ ];
+        pMsgCtx->batchCount--;
+        return true;
+    }
+
+    if( ( batchSize > 1U ) && ( pMsgCtx->pending == NULL ) )
+    {
+        /* The refill above timed out. */
+        return false;
+    }
+
+    return receiveOne( pMsgCtx, pReceivedCommand, blockTimeMs );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t Agent_MessageReceiveBatch( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs )
+{
+    size_t received = 0U;
+
+    if( ( pMsgCtx == NULL ) || ( pCommands == NULL ) || ( maxCommands == 0U ) )
+    {
+        return 0U;
+    }
+
+    /* Hand out anything a batching Agent_MessageReceive() buffered first. */
+    while( ( received < maxCommands ) && ( pMsgCtx->batchCount > 0U ) )
+    {
+        pCommands[ received++ ] = pMsgCtx->batch[ pMsgCtx->batchHead++ ];
+        pMsgCtx->batchCount--;
+    }
+
+    if( ( received == 0U ) && receiveOne( pMsgCtx, &pCommands[ 0 ], blockTimeMs ) )
+    {
+        received = 1U;
+    }
+
+    while( ( received > 0U ) && ( received < maxCommands ) &&
+           receiveOne( pMsgCtx, &pCommands[ received ], 0U ) )
+    {
+        received++;
+    }
+
+    return received;
 }
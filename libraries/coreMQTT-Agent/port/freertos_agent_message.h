@@ -24,17 +24,83 @@
 /* FreeRTOS includes. */
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 /* Include MQTT agent messaging interface. */
 #include "core_mqtt_agent_message_interface.h"
 
+/**
+ * @brief Largest batch Agent_MessageReceive() can buffer, see
+ * MQTTAgentMessageContext::batchSize.
+ */
+#define AGENT_MESSAGE_BATCH_MAX    ( 8U )
+
+/**
+ * @brief Priority lanes of a message context, highest priority first.
+ */
+typedef enum AgentMessageLane
+{
+    AGENT_MESSAGE_LANE_CONTROL = 0, /**< Subscribe, unsubscribe, ping and connect. */
+    AGENT_MESSAGE_LANE_HIGH,        /**< Latency sensitive publishes, chosen by the classifier. */
+    AGENT_MESSAGE_LANE_BULK,        /**< Other publishes, e.g. telemetry, disconnect and terminate. */
+    AGENT_MESSAGE_LANE_COUNT
+} AgentMessageLane_t;
+
+/**
+ * @brief Picks the lane of a command. Called from Agent_MessageSend() in the
+ * sending task, so it must be thread safe and quick.
+ */
+typedef AgentMessageLane_t ( * AgentMessageClassifier_t )( const MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Depth metrics of one lane.
+ */
+typedef struct AgentMessageLaneStats
+{
+    uint32_t depth;    /**< @brief Commands currently queued. */
+    uint32_t maxDepth; /**< @brief Largest depth observed after a send. */
+    uint32_t sent;     /**< @brief Commands queued in the lane. */
+    uint32_t received; /**< @brief Commands taken from the lane. */
+} AgentMessageLaneStats_t;
+
 /**
  * @ingroup mqtt_agent_struct_types
  * @brief Context with which tasks may deliver messages to the agent.
+ *
+ * A context with only #queue set is a single FIFO, as before. After
+ * Agent_MessageInitLanes() it has one queue per #AgentMessageLane_t, with
+ * #queue serving as the bulk lane.
  */
 struct MQTTAgentMessageContext
 {
     QueueHandle_t queue;
+
+    QueueHandle_t laneQueues[ AGENT_MESSAGE_LANE_COUNT ]; /**< Lane queues, NULL for a single FIFO context. */
+    SemaphoreHandle_t pending;                            /**< Counts the commands queued over all lanes. */
+    AgentMessageClassifier_t classify;                    /**< Lane of each command, NULL for the default. */
+
+    /**
+     * @brief Dequeue weights. All zero selects strict priority. Otherwise
+     * each lane may be served up to its weight times per round, highest
+     * priority first, so bulk traffic keeps moving under a flood of
+     * higher priority commands. A lane with weight 0 is then only served
+     * when no other lane has commands.
+     */
+    uint8_t weights[ AGENT_MESSAGE_LANE_COUNT ];
+    uint8_t credits[ AGENT_MESSAGE_LANE_COUNT ]; /**< Remaining weight of the current round. */
+    AgentMessageLaneStats_t laneStats[ AGENT_MESSAGE_LANE_COUNT ];
+
+    /**
+     * @brief Commands Agent_MessageReceive() drains from a single FIFO
+     * context per refill, up to #AGENT_MESSAGE_BATCH_MAX. 0 or 1 receives one
+     * command at a time. Ignored by multi-lane contexts, where a buffered bulk
+     * command must not overtake a control command sent after it. Only
+     * valid with a single receiving task, which is the agent.
+     */
+    uint8_t batchSize;
+    uint8_t batchHead;                                /**< Next buffered command. */
+    uint8_t batchCount;                               /**< Buffered commands left. */
+    MQTTAgentCommand_t * batch[ AGENT_MESSAGE_BATCH_MAX ];
 };
 
 /*-----------------------------------------------------------*/
@@ -67,4 +133,53 @@ bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
                            MQTTAgentCommand_t ** pReceivedCommand,
                            uint32_t blockTimeMs );
 
+/**
+ * @brief Receive up to @p maxCommands commands in one call.
+ *
+ * Waits up to @p blockTimeMs for the first command, then takes whatever else
+ * is already queued without blocking, in lane priority order for a multi-lane
+ * context. Commands buffered by a batching Agent_MessageReceive() are returned
+ * first.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[out] pCommands Array receiving the commands.
+ * @param[in] maxCommands Size of @p pCommands.
+ * @param[in] blockTimeMs Block time to wait for the first command.
+ *
+ * @return Number of commands received, 0 on timeout.
+ */
+size_t Agent_MessageReceiveBatch( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs );
+
+/**
+ * @brief Turn a zero-initialised context into a multi-lane one.
+ *
+ * Creates one queue per lane with the given lengths. A length of 0 merges the
+ * lane into the next lower priority lane that has a queue; the bulk lane
+ * must have one. Call before the context is shared with other tasks.
+ *
+ * @param[in] pMsgCtx The context to initialise.
+ * @param[in] laneLengths Queue length of each lane.
+ * @param[in] classify Lane of each command, or NULL to queue publishes,
+ * disconnect and terminate in the bulk lane and every other command in the
+ * control lane.
+ *
+ * @return `true` on success, `false` if a parameter is invalid or memory
+ * runs out.
+ */
+bool Agent_MessageInitLanes( MQTTAgentMessageContext_t * pMsgCtx,
+                             const uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ],
+                             AgentMessageClassifier_t classify );
+
+/**
+ * @brief Read the depth metrics of a lane of a multi-lane context.
+ *
+ * @return `false` if the context has no such lane.
+ */
+bool Agent_MessageGetLaneStats( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageLane_t lane,
+                                AgentMessageLaneStats_t * pStats );
+
 #endif /* FREERTOS_AGENT_MESSAGE_H */
@@ -17,8 +17,179 @@
 #ifndef FREERTOS_COMMAND_POOL_H
 #define FREERTOS_COMMAND_POOL_H
 
+/* Kernel includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
 /* MQTT agent includes. */
 #include "core_mqtt_agent.h"
+#include "freertos_payload_pool.h"
+
+/**
+ * @brief Usage statistics of the command pool, see Agent_GetPoolStats().
+ */
+typedef struct AgentCommandPoolStats
+{
+    uint32_t inUse;                 /**< @brief Commands currently handed out, overflow included. */
+    uint32_t highWatermark;         /**< @brief Largest value inUse has reached. */
+    uint32_t exhaustedCount;        /**< @brief Agent_GetCommand() calls that found the static pool empty. */
+    uint32_t failedCount;           /**< @brief Agent_GetCommand() calls that returned NULL. */
+    uint32_t waitCount;             /**< @brief Agent_GetCommand() calls that blocked. */
+    uint32_t totalWaitMs;           /**< @brief Total time spent blocked. */
+    uint32_t maxWaitMs;             /**< @brief Longest single block. */
+    uint32_t overflowInUse;         /**< @brief Heap allocated commands currently handed out. */
+    uint32_t overflowHighWatermark; /**< @brief Largest value overflowInUse has reached. */
+    uint32_t overflowAllocations;   /**< @brief Heap allocations made for the overflow arena. */
+} AgentCommandPoolStats_t;
+
+/**
+ * @brief A pool of command structures.
+ *
+ * Each MQTT agent instance needs its own pool, sized for its own traffic.
+ * The Agent_Pool*() functions operate on a pool object; Agent_InitializePool(),
+ * Agent_GetCommand(), Agent_ReleaseCommand() and Agent_GetPoolStats() operate
+ * on a default pool sized by MQTT_COMMAND_CONTEXTS_POOL_SIZE and
+ * MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW.
+ *
+ * @note The members are private to freertos_command_pool.c. They are declared
+ * here so that pools can be allocated statically.
+ */
+typedef struct AgentCommandPool
+{
+    MQTTAgentCommand_t * pCommands;         /**< @brief Command structures, poolSize entries. */
+    uint16_t * pNextFree;                   /**< @brief Free list links, poolSize entries. */
+    size_t poolSize;                        /**< @brief Number of command structures. */
+    uint32_t freeListHead;                  /**< @brief Free list head and modification counter. */
+    uint32_t waitingTasks;                  /**< @brief Tasks blocked waiting for a command. */
+    SemaphoreHandle_t commandAvailable;     /**< @brief Signalled on release while tasks wait. */
+    StaticSemaphore_t commandAvailableStorage;
+    MQTTAgentCommand_t ** pOverflowCommands; /**< @brief Heap allocated commands in use, overflowLimit entries. */
+    size_t overflowLimit;                   /**< @brief Maximum number of heap allocated commands. */
+    portMUX_TYPE overflowLock;              /**< @brief Guards pOverflowCommands. */
+    AgentCommandPoolStats_t stats;          /**< @brief Usage statistics. */
+    AgentPayloadPool_t * pPayloadPool;      /**< @brief Buffers released with PUBLISH commands, or NULL. */
+    bool ownsStorage;                       /**< @brief Storage was allocated by Agent_PoolInit(). */
+    volatile uint8_t initStatus;            /**< @brief Whether the pool is initialized. */
+} AgentCommandPool_t;
+
+/**
+ * @brief Define the functions an MQTTAgentMessageInterface_t needs to use a
+ * pool other than the default one.
+ *
+ * The agent calls getCommand and releaseCommand without a context, so each
+ * pool needs its own pair of functions. For example:
+ *
+ * @code{c}
+ * static AgentCommandPool_t telemetryPool;
+ * AGENT_COMMAND_POOL_INTERFACE( telemetry, telemetryPool )
+ *
+ * messageInterface.getCommand = telemetryGetCommand;
+ * messageInterface.releaseCommand = telemetryReleaseCommand;
+ * @endcode
+ *
+ * @param[in] prefix Prefix of the names of the defined functions.
+ * @param[in] pool The AgentCommandPool_t object, not a pointer to it.
+ */
+#define AGENT_COMMAND_POOL_INTERFACE( prefix, pool )                             \
+    static MQTTAgentCommand_t * prefix ## GetCommand( uint32_t blockTimeMs )      \
+    {                                                                            \
+        return Agent_PoolGetCommand( &( pool ), blockTimeMs );                   \
+    }                                                                            \
+    static bool prefix ## ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease ) \
+    {                                                                            \
+        return Agent_PoolReleaseCommand( &( pool ), pCommandToRelease );         \
+    }
+
+/**
+ * @brief Initialize a pool, allocating its storage from the heap. Not thread
+ * safe.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] poolSize Number of command structures, between 1 and 65534.
+ * @param[in] overflowLimit Number of commands that may be allocated from the
+ * heap while the pool is exhausted. Zero disables overflow.
+ *
+ * @return true if the pool was initialized, false if a parameter is invalid or
+ * the storage could not be allocated.
+ */
+bool Agent_PoolInit( AgentCommandPool_t * pPool,
+                     size_t poolSize,
+                     size_t overflowLimit );
+
+/**
+ * @brief Initialize a pool using storage supplied by the caller. Not thread
+ * safe.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] pCommands Array of poolSize command structures.
+ * @param[in] pNextFree Array of poolSize free list links.
+ * @param[in] poolSize Number of command structures, between 1 and 65534.
+ * @param[in] pOverflowCommands Array of overflowLimit pointers, or NULL if
+ * overflowLimit is zero.
+ * @param[in] overflowLimit Number of commands that may be allocated from the
+ * heap while the pool is exhausted. Zero disables overflow.
+ *
+ * @return true if the pool was initialized, false if a parameter is invalid.
+ */
+bool Agent_PoolInitStatic( AgentCommandPool_t * pPool,
+                           MQTTAgentCommand_t * pCommands,
+                           uint16_t * pNextFree,
+                           size_t poolSize,
+                           MQTTAgentCommand_t ** pOverflowCommands,
+                           size_t overflowLimit );
+
+/**
+ * @brief Delete a pool, freeing the storage allocated by Agent_PoolInit().
+ *
+ * @note Every command must have been released, and no task may be using the
+ * pool.
+ *
+ * @param[in] pPool The pool to delete.
+ */
+void Agent_PoolDelete( AgentCommandPool_t * pPool );
+
+/**
+ * @brief Obtain a command structure from a pool. See Agent_GetCommand().
+ *
+ * @param[in] pPool The pool.
+ * @param[in] blockTimeMs How long to wait for a command structure.
+ *
+ * @return A command structure, or NULL if none became available in time.
+ */
+MQTTAgentCommand_t * Agent_PoolGetCommand( AgentCommandPool_t * pPool,
+                                           uint32_t blockTimeMs );
+
+/**
+ * @brief Return a command structure to the pool it was obtained from. See
+ * Agent_ReleaseCommand().
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pCommandToRelease The command structure to return.
+ *
+ * @return true if the command structure belonged to the pool and was returned.
+ */
+bool Agent_PoolReleaseCommand( AgentCommandPool_t * pPool,
+                               MQTTAgentCommand_t * pCommandToRelease );
+
+/**
+ * @brief Read the usage statistics of a pool. See Agent_GetPoolStats().
+ *
+ * @param[in] pPool The pool.
+ * @param[out] pStats Where to store the statistics.
+ */
+void Agent_PoolGetStats( AgentCommandPool_t * pPool,
+                         AgentCommandPoolStats_t * pStats );
+
+/**
+ * @brief Attach a payload pool to a command pool, so that buffers published
+ * with Agent_PayloadPublish() are released when their PUBLISH command is.
+ * Not thread safe; call after initializing the pool and before the agent runs.
+ *
+ * @param[in] pPool The command pool.
+ * @param[in] pPayloadPool The payload pool, or NULL to detach.
+ */
+void Agent_PoolSetPayloadPool( AgentCommandPool_t * pPool,
+                               AgentPayloadPool_t * pPayloadPool );
 
 /**
  * @brief Initialize the common task pool. Not thread safe.
@@ -66,4 +237,19 @@ MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs );
  */
 bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease );
 
+/**
+ * @brief Read the usage statistics of the pool.
+ * @note Each counter is read atomically, but counters updated by a concurrent
+ * call may be one step apart.
+ * @param[out] pStats Where to store the statistics.
+ */
+void Agent_GetPoolStats( AgentCommandPoolStats_t * pStats );
+
+/**
+ * @brief Attach a payload pool to the common task pool. See
+ * Agent_PoolSetPayloadPool().
+ * @param[in] pPayloadPool The payload pool, or NULL to detach.
+ */
+void Agent_SetPayloadPool( AgentPayloadPool_t * pPayloadPool );
+
 #endif /* FREERTOS_COMMAND_POOL_H */
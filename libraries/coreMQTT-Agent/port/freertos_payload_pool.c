@@ -0,0 +1,293 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file freertos_payload_pool.c
+ * @brief Reference counted publish buffers released with their agent command.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdlib.h>
+
+/* Kernel includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* Header include. */
+#include "freertos_payload_pool.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Index marking the end of the free list.
+ */
+#define FREE_LIST_END    ( UINT32_MAX )
+
+/*-----------------------------------------------------------*/
+
+static void returnBuffer( AgentPayloadPool_t * pPool,
+                          AgentPayloadBuffer_t * pBuffer )
+{
+    portENTER_CRITICAL( &pPool->lock );
+    pBuffer->nextFree = pPool->freeListHead;
+    pPool->freeListHead = ( uint32_t ) ( pBuffer - pPool->pBuffers );
+    pPool->inUse--;
+    portEXIT_CRITICAL( &pPool->lock );
+
+    ( void ) xSemaphoreGive( pPool->buffersAvailable );
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_PayloadPoolInit( AgentPayloadPool_t * pPool,
+                            size_t bufferCount,
+                            size_t bufferSize )
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    size_t i;
+
+    if( ( pPool == NULL ) || ( bufferCount == 0U ) || ( bufferCount >= FREE_LIST_END ) ||
+        ( bufferSize == 0U ) )
+    {
+        LogError( ( "Invalid payload pool parameters." ) );
+        return false;
+    }
+
+    memset( pPool, 0x00, sizeof( AgentPayloadPool_t ) );
+    pPool->pBuffers = calloc( bufferCount, sizeof( AgentPayloadBuffer_t ) );
+    pPool->pStorage = malloc( bufferCount * bufferSize );
+
+    if( ( pPool->pBuffers == NULL ) || ( pPool->pStorage == NULL ) )
+    {
+        LogError( ( "Could not allocate %u payload buffers of %u bytes.",
+                    ( unsigned int ) bufferCount, ( unsigned int ) bufferSize ) );
+        free( pPool->pBuffers );
+        free( pPool->pStorage );
+        memset( pPool, 0x00, sizeof( AgentPayloadPool_t ) );
+        return false;
+    }
+
+    for( i = 0; i < bufferCount; i++ )
+    {
+        pPool->pBuffers[ i ].pPool = pPool;
+        pPool->pBuffers[ i ].nextFree = ( i + 1U < bufferCount ) ? ( uint32_t ) ( i + 1U ) : FREE_LIST_END;
+    }
+
+    pPool->bufferCount = bufferCount;
+    pPool->bufferSize = bufferSize;
+    pPool->freeListHead = 0U;
+    pPool->lock = unlocked;
+
+    pPool->buffersAvailable = xSemaphoreCreateCountingStatic( bufferCount, bufferCount,
+                                                              &pPool->buffersAvailableStorage );
+    configASSERT( pPool->buffersAvailable );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_PayloadPoolDelete( AgentPayloadPool_t * pPool )
+{
+    if( ( pPool == NULL ) || ( pPool->pBuffers == NULL ) )
+    {
+        return;
+    }
+
+    if( pPool->inUse != 0U )
+    {
+        LogError( ( "Deleting a payload pool with %u buffers in use.",
+                    ( unsigned int ) pPool->inUse ) );
+    }
+
+    vSemaphoreDelete( pPool->buffersAvailable );
+    free( pPool->pBuffers );
+    free( pPool->pStorage );
+    memset( pPool, 0x00, sizeof( AgentPayloadPool_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+AgentPayloadBuffer_t * Agent_PayloadAlloc( AgentPayloadPool_t * pPool,
+                                           const char * pTopicName,
+                                           uint16_t topicNameLength,
+                                           size_t payloadLength,
+                                           uint32_t blockTimeMs )
+{
+    AgentPayloadBuffer_t * pBuffer;
+    uint8_t * pBlock;
+    uint32_t index;
+
+    configASSERT( ( pPool != NULL ) && ( pPool->pBuffers != NULL ) );
+
+    if( ( pTopicName == NULL ) || ( topicNameLength == 0U ) ||
+        ( ( size_t ) topicNameLength + payloadLength > pPool->bufferSize ) )
+    {
+        LogError( ( "Topic and payload of %u bytes do not fit a payload buffer.",
+                    ( unsigned int ) ( topicNameLength + payloadLength ) ) );
+        return NULL;
+    }
+
+    if( xSemaphoreTake( pPool->buffersAvailable, pdMS_TO_TICKS( blockTimeMs ) ) == pdFALSE )
+    {
+        LogError( ( "No payload buffer available." ) );
+        return NULL;
+    }
+
+    /* The semaphore counts free buffers, so the list cannot be empty here. */
+    portENTER_CRITICAL( &pPool->lock );
+    index = pPool->freeListHead;
+    pPool->freeListHead = pPool->pBuffers[ index ].nextFree;
+
+    if( ++pPool->inUse > pPool->highWatermark )
+    {
+        pPool->highWatermark = pPool->inUse;
+    }
+
+    portEXIT_CRITICAL( &pPool->lock );
+
+    pBuffer = &pPool->pBuffers[ index ];
+    pBlock = &pPool->pStorage[ index * pPool->bufferSize ];
+
+    /* The topic goes first, the payload takes the rest of the block. */
+    memcpy( pBlock, pTopicName, topicNameLength );
+    pBuffer->pPayload = pBlock + topicNameLength;
+    pBuffer->payloadCapacity = pPool->bufferSize - topicNameLength;
+
+    memset( &pBuffer->publishInfo, 0x00, sizeof( MQTTPublishInfo_t ) );
+    pBuffer->publishInfo.qos = MQTTQoS0;
+    pBuffer->publishInfo.pTopicName = ( const char * ) pBlock;
+    pBuffer->publishInfo.topicNameLength = topicNameLength;
+    pBuffer->publishInfo.pPayload = pBuffer->pPayload;
+    pBuffer->publishInfo.payloadLength = payloadLength;
+
+    pBuffer->referenceCount = 1U;
+    pBuffer->inFlight = 0U;
+    pBuffer->agentReleased = 0U;
+
+    return pBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_PayloadRef( AgentPayloadBuffer_t * pBuffer )
+{
+    configASSERT( ( pBuffer != NULL ) && ( pBuffer->referenceCount > 0U ) );
+
+    __atomic_add_fetch( &pBuffer->referenceCount, 1U, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_PayloadRelease( AgentPayloadBuffer_t * pBuffer )
+{
+    if( pBuffer == NULL )
+    {
+        return;
+    }
+
+    configASSERT( pBuffer->referenceCount > 0U );
+
+    if( __atomic_sub_fetch( &pBuffer->referenceCount, 1U, __ATOMIC_ACQ_REL ) == 0U )
+    {
+        returnBuffer( pBuffer->pPool, pBuffer );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t Agent_PayloadPublish( const MQTTAgentContext_t * pMqttAgentContext,
+                                   AgentPayloadBuffer_t * pBuffer,
+                                   const MQTTAgentCommandInfo_t * pCommandInfo )
+{
+    MQTTStatus_t status;
+    uint32_t idle = 0U;
+
+    if( pBuffer == NULL )
+    {
+        return MQTTBadParameter;
+    }
+
+    if( !__atomic_compare_exchange_n( &pBuffer->inFlight, &idle, 1U, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) )
+    {
+        LogError( ( "Payload buffer is already being published." ) );
+        Agent_PayloadRelease( pBuffer );
+        return MQTTBadParameter;
+    }
+
+    configASSERT( pBuffer->publishInfo.payloadLength <= pBuffer->payloadCapacity );
+
+    /* The agent's reference, dropped by Agent_PayloadCommandReleased(). */
+    __atomic_store_n( &pBuffer->agentReleased, 0U, __ATOMIC_RELAXED );
+    Agent_PayloadRef( pBuffer );
+
+    status = MQTTAgent_Publish( pMqttAgentContext, &pBuffer->publishInfo, pCommandInfo );
+
+    /* On failure the agent may or may not have obtained a command, and so
+     * may or may not have released it again already. */
+    if( ( status != MQTTSuccess ) &&
+        ( __atomic_load_n( &pBuffer->agentReleased, __ATOMIC_ACQUIRE ) == 0U ) )
+    {
+        __atomic_store_n( &pBuffer->inFlight, 0U, __ATOMIC_RELEASE );
+        Agent_PayloadRelease( pBuffer );
+    }
+
+    /* The caller's reference. */
+    Agent_PayloadRelease( pBuffer );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_PayloadCommandReleased( AgentPayloadPool_t * pPool,
+                                   const MQTTAgentCommand_t * pCommand )
+{
+    const uint8_t * pArgs;
+    const uint8_t * pFirst;
+    AgentPayloadBuffer_t * pBuffer;
+    size_t offset;
+
+    if( ( pPool == NULL ) || ( pPool->pBuffers == NULL ) || ( pCommand == NULL ) ||
+        ( pCommand->commandType != PUBLISH ) )
+    {
+        return false;
+    }
+
+    /* A PUBLISH command's arguments are the MQTTPublishInfo_t passed to
+     * MQTTAgent_Publish(). Only those embedded in our buffers are ours. */
+    pArgs = ( const uint8_t * ) pCommand->pArgs;
+    pFirst = ( const uint8_t * ) pPool->pBuffers;
+
+    if( ( pArgs < pFirst ) || ( pArgs >= ( const uint8_t * ) ( pPool->pBuffers + pPool->bufferCount ) ) )
+    {
+        return false;
+    }
+
+    offset = ( size_t ) ( pArgs - pFirst );
+
+    if( ( offset % sizeof( AgentPayloadBuffer_t ) ) != offsetof( AgentPayloadBuffer_t, publishInfo ) )
+    {
+        return false;
+    }
+
+    pBuffer = &pPool->pBuffers[ offset / sizeof( AgentPayloadBuffer_t ) ];
+
+    __atomic_store_n( &pBuffer->agentReleased, 1U, __ATOMIC_RELEASE );
+    __atomic_store_n( &pBuffer->inFlight, 0U, __ATOMIC_RELEASE );
+    Agent_PayloadRelease( pBuffer );
+
+    return true;
+}
@@ -0,0 +1,178 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+/**
+ * @file freertos_payload_pool.h
+ * @brief Reference counted publish buffers released with their agent command.
+ *
+ * MQTTAgent_Publish() keeps a pointer to the caller's MQTTPublishInfo_t, topic
+ * and payload until the command completes. A payload buffer holds all three in
+ * one fixed size block from a pool, so a producer can copy its data once,
+ * publish with Agent_PayloadPublish() and forget about it: the buffer returns
+ * to its pool when the last reference is dropped, which for the agent's
+ * reference is when the command pool gets the PUBLISH command back.
+ */
+#ifndef FREERTOS_PAYLOAD_POOL_H
+#define FREERTOS_PAYLOAD_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Kernel includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* MQTT agent includes. */
+#include "core_mqtt_agent.h"
+
+struct AgentPayloadPool;
+
+/**
+ * @brief A publish buffer.
+ *
+ * publishInfo points at the topic and payload held in the buffer. The caller
+ * may change publishInfo.qos, publishInfo.retain and publishInfo.payloadLength
+ * (up to payloadCapacity) before publishing; the remaining members are private.
+ */
+typedef struct AgentPayloadBuffer
+{
+    MQTTPublishInfo_t publishInfo;  /**< @brief Passed to MQTTAgent_Publish(). */
+    uint8_t * pPayload;             /**< @brief Writable payload area. */
+    size_t payloadCapacity;         /**< @brief Size of the payload area. */
+    struct AgentPayloadPool * pPool; /**< @brief Pool the buffer belongs to. */
+    uint32_t referenceCount;        /**< @brief Number of owners. */
+    uint32_t inFlight;              /**< @brief Non-zero while the agent holds the buffer. */
+    uint32_t agentReleased;         /**< @brief Set when the agent dropped its reference. */
+    uint32_t nextFree;              /**< @brief Free list link. */
+} AgentPayloadBuffer_t;
+
+/**
+ * @brief A pool of publish buffers of one size.
+ *
+ * @note The members are private to freertos_payload_pool.c. They are declared
+ * here so that pools can be allocated statically.
+ */
+typedef struct AgentPayloadPool
+{
+    AgentPayloadBuffer_t * pBuffers;    /**< @brief bufferCount buffer headers. */
+    uint8_t * pStorage;                 /**< @brief bufferCount blocks of bufferSize bytes. */
+    size_t bufferCount;                 /**< @brief Number of buffers. */
+    size_t bufferSize;                  /**< @brief Bytes of topic and payload per buffer. */
+    uint32_t freeListHead;              /**< @brief First free buffer. Guarded by lock. */
+    uint32_t inUse;                     /**< @brief Buffers currently allocated. */
+    uint32_t highWatermark;             /**< @brief Largest value inUse has reached. */
+    portMUX_TYPE lock;                  /**< @brief Guards the free list. */
+    SemaphoreHandle_t buffersAvailable; /**< @brief Counts free buffers. */
+    StaticSemaphore_t buffersAvailableStorage;
+} AgentPayloadPool_t;
+
+/**
+ * @brief Initialize a pool, allocating its storage from the heap. Not thread
+ * safe.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] bufferCount Number of buffers.
+ * @param[in] bufferSize Bytes of topic plus payload each buffer can hold.
+ *
+ * @return true if the pool was initialized, false if a parameter is invalid or
+ * the storage could not be allocated.
+ */
+bool Agent_PayloadPoolInit( AgentPayloadPool_t * pPool,
+                            size_t bufferCount,
+                            size_t bufferSize );
+
+/**
+ * @brief Delete a pool and free its storage.
+ *
+ * @note Every buffer must have been released, and no task may be using the
+ * pool.
+ *
+ * @param[in] pPool The pool to delete.
+ */
+void Agent_PayloadPoolDelete( AgentPayloadPool_t * pPool );
+
+/**
+ * @brief Allocate a buffer and copy the topic into it.
+ *
+ * The buffer is returned with one reference, owned by the caller, and with
+ * publishInfo set up for a QoS 0 publish of payloadLength bytes to the topic.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pTopicName The topic to publish to.
+ * @param[in] topicNameLength Length of the topic.
+ * @param[in] payloadLength Length of the payload the caller will write to
+ * pPayload.
+ * @param[in] blockTimeMs How long to wait for a free buffer.
+ *
+ * @return The buffer, or NULL if the topic and payload do not fit in a buffer
+ * or none became free in time.
+ */
+AgentPayloadBuffer_t * Agent_PayloadAlloc( AgentPayloadPool_t * pPool,
+                                           const char * pTopicName,
+                                           uint16_t topicNameLength,
+                                           size_t payloadLength,
+                                           uint32_t blockTimeMs );
+
+/**
+ * @brief Add a reference to a buffer.
+ *
+ * @param[in] pBuffer The buffer.
+ */
+void Agent_PayloadRef( AgentPayloadBuffer_t * pBuffer );
+
+/**
+ * @brief Drop a reference to a buffer, returning it to its pool when it was
+ * the last one.
+ *
+ * @param[in] pBuffer The buffer.
+ */
+void Agent_PayloadRelease( AgentPayloadBuffer_t * pBuffer );
+
+/**
+ * @brief Publish a buffer through an agent.
+ *
+ * The caller's reference is consumed whatever the outcome. On success the
+ * agent holds its own reference until the PUBLISH command is released, i.e.
+ * once a QoS 0 publish is sent or a QoS 1 or 2 publish is acknowledged. The
+ * agent's message interface must use a command pool that the buffer's pool
+ * has been attached to with Agent_PoolSetPayloadPool() or
+ * Agent_SetPayloadPool().
+ *
+ * A buffer can be held by one agent command at a time. Take a reference with
+ * Agent_PayloadRef() to keep the buffer, and publish it again once the first
+ * command completed.
+ *
+ * @param[in] pMqttAgentContext The agent to publish through.
+ * @param[in] pBuffer The buffer.
+ * @param[in] pCommandInfo Passed to MQTTAgent_Publish().
+ *
+ * @return The status returned by MQTTAgent_Publish(), or MQTTBadParameter if
+ * the buffer is already being published.
+ */
+MQTTStatus_t Agent_PayloadPublish( const MQTTAgentContext_t * pMqttAgentContext,
+                                   AgentPayloadBuffer_t * pBuffer,
+                                   const MQTTAgentCommandInfo_t * pCommandInfo );
+
+/**
+ * @brief Drop the agent's reference to the buffer held by a command. Called by
+ * the command pool when a command is released.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pCommand The command being released.
+ *
+ * @return true if the command held a buffer from the pool.
+ */
+bool Agent_PayloadCommandReleased( AgentPayloadPool_t * pPool,
+                                   const MQTTAgentCommand_t * pCommand );
+
+#endif /* FREERTOS_PAYLOAD_POOL_H */
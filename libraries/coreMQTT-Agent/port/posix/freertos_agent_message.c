@@ -0,0 +1,463 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file freertos_agent_message.c
+ * @brief Host (Linux) build of the agent message functions, using pthreads.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Header include. */
+#include "freertos_agent_message.h"
+#include "core_mqtt_agent_message_interface.h"
+#include "core_mqtt_agent.h"
+
+/*-----------------------------------------------------------*/
+
+/* Disconnect and terminate share the bulk lane with publishes, so that they
+ * run after the publishes sent before them instead of cutting those off. */
+static AgentMessageLane_t defaultClassifier( const MQTTAgentCommand_t * pCommand )
+{
+    AgentMessageLane_t lane = AGENT_MESSAGE_LANE_CONTROL;
+
+    if( ( pCommand->commandType == PUBLISH ) ||
+        ( pCommand->commandType == DISCONNECT ) ||
+        ( pCommand->commandType == TERMINATE ) )
+    {
+        lane = AGENT_MESSAGE_LANE_BULK;
+    }
+
+    return lane;
+}
+
+/*-----------------------------------------------------------*/
+
+static void makeDeadline( struct timespec * pDeadline,
+                          uint32_t blockTimeMs )
+{
+    ( void ) clock_gettime( CLOCK_MONOTONIC, pDeadline );
+
+    pDeadline->tv_sec += ( time_t ) ( blockTimeMs / 1000U );
+    pDeadline->tv_nsec += ( long ) ( blockTimeMs % 1000U ) * 1000000L;
+
+    if( pDeadline->tv_nsec >= 1000000000L )
+    {
+        pDeadline->tv_sec++;
+        pDeadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Wait on a condition of the context with its lock held. Returns false once
+ * the deadline passed; a zero block time never waits. */
+static bool waitLocked( MQTTAgentMessageContext_t * pMsgCtx,
+                        pthread_cond_t * pCondition,
+                        const struct timespec * pDeadline,
+                        uint32_t blockTimeMs )
+{
+    if( blockTimeMs == 0U )
+    {
+        return false;
+    }
+
+    if( blockTimeMs == AGENT_MESSAGE_WAIT_FOREVER )
+    {
+        return pthread_cond_wait( pCondition, &pMsgCtx->lock ) == 0;
+    }
+
+    return pthread_cond_timedwait( pCondition, &pMsgCtx->lock, pDeadline ) != ETIMEDOUT;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool initContext( MQTTAgentMessageContext_t * pMsgCtx,
+                         const uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ] )
+{
+    pthread_condattr_t attributes;
+    size_t lane;
+
+    for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+    {
+        if( laneLengths[ lane ] != 0U )
+        {
+            pMsgCtx->lanes[ lane ].pItems = calloc( laneLengths[ lane ], sizeof( MQTTAgentCommand_t * ) );
+
+            if( pMsgCtx->lanes[ lane ].pItems == NULL )
+            {
+                break;
+            }
+
+            pMsgCtx->lanes[ lane ].length = laneLengths[ lane ];
+        }
+    }
+
+    if( lane != AGENT_MESSAGE_LANE_COUNT )
+    {
+        for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+        {
+            free( pMsgCtx->lanes[ lane ].pItems );
+            pMsgCtx->lanes[ lane ].pItems = NULL;
+            pMsgCtx->lanes[ lane ].length = 0U;
+        }
+
+        return false;
+    }
+
+    /* Deadlines are taken from the monotonic clock. */
+    ( void ) pthread_condattr_init( &attributes );
+    ( void ) pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( &pMsgCtx->notEmpty, &attributes );
+    ( void ) pthread_cond_init( &pMsgCtx->notFull, &attributes );
+    ( void ) pthread_condattr_destroy( &attributes );
+    ( void ) pthread_mutex_init( &pMsgCtx->lock, NULL );
+
+    pMsgCtx->initialised = true;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Lane used for a class, falling back to lower priority lanes that were merged. */
+static AgentMessageRing_t * laneRing( MQTTAgentMessageContext_t * pMsgCtx,
+                                      AgentMessageLane_t * pLane )
+{
+    while( ( *pLane < AGENT_MESSAGE_LANE_BULK ) && ( pMsgCtx->lanes[ *pLane ].pItems == NULL ) )
+    {
+        ( *pLane )++;
+    }
+
+    return &pMsgCtx->lanes[ *pLane ];
+}
+
+/*-----------------------------------------------------------*/
+
+/* Pick the lane to serve next, as the FreeRTOS port does. Called with the lock
+ * held and at least one command queued. */
+static size_t selectLaneLocked( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    bool weighted = false;
+    size_t lane;
+    size_t round;
+
+    for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+    {
+        weighted = weighted || ( pMsgCtx->weights[ lane ] != 0U );
+    }
+
+    for( round = 0; round < 3U; round++ )
+    {
+        bool useCredit = weighted && ( round < 2U );
+
+        if( useCredit && ( round == 1U ) )
+        {
+            for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+            {
+                pMsgCtx->credits[ lane ] = pMsgCtx->weights[ lane ];
+            }
+        }
+
+        for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+        {
+            if( ( pMsgCtx->lanes[ lane ].count == 0U ) ||
+                ( useCredit && ( pMsgCtx->credits[ lane ] == 0U ) ) )
+            {
+                continue;
+            }
+
+            if( useCredit )
+            {
+                pMsgCtx->credits[ lane ]--;
+            }
+
+            return lane;
+        }
+
+        if( !weighted )
+        {
+            break;
+        }
+    }
+
+    /* Not reached while pending matches the queued commands. */
+    abort();
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentCommand_t * takeLocked( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    size_t lane = pMsgCtx->multiLane ? selectLaneLocked( pMsgCtx ) : AGENT_MESSAGE_LANE_BULK;
+    AgentMessageRing_t * pRing = &pMsgCtx->lanes[ lane ];
+    MQTTAgentCommand_t * pCommand = pRing->pItems[ pRing->head ];
+
+    pRing->head = ( pRing->head + 1U ) % pRing->length;
+    pRing->count--;
+    pMsgCtx->pending--;
+    pMsgCtx->laneStats[ lane ].received++;
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Take up to maxCommands queued commands, waiting for the first one. */
+static size_t receiveCommands( MQTTAgentMessageContext_t * pMsgCtx,
+                               MQTTAgentCommand_t ** pCommands,
+                               size_t maxCommands,
+                               uint32_t blockTimeMs )
+{
+    struct timespec deadline;
+    size_t received = 0U;
+
+    makeDeadline( &deadline, blockTimeMs );
+    ( void ) pthread_mutex_lock( &pMsgCtx->lock );
+
+    while( ( pMsgCtx->pending == 0U ) &&
+           waitLocked( pMsgCtx, &pMsgCtx->notEmpty, &deadline, blockTimeMs ) )
+    {
+    }
+
+    while( ( received < maxCommands ) && ( pMsgCtx->pending > 0U ) )
+    {
+        pCommands[ received++ ] = takeLocked( pMsgCtx );
+    }
+
+    if( received > 0U )
+    {
+        ( void ) pthread_cond_broadcast( &pMsgCtx->notFull );
+    }
+
+    ( void ) pthread_mutex_unlock( &pMsgCtx->lock );
+
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageInit( MQTTAgentMessageContext_t * pMsgCtx,
+                        uint32_t queueLength )
+{
+    uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ] = { 0 };
+
+    if( ( pMsgCtx == NULL ) || ( queueLength == 0U ) || pMsgCtx->initialised )
+    {
+        return false;
+    }
+
+    laneLengths[ AGENT_MESSAGE_LANE_BULK ] = queueLength;
+
+    return initContext( pMsgCtx, laneLengths );
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageInitLanes( MQTTAgentMessageContext_t * pMsgCtx,
+                             const uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ],
+                             AgentMessageClassifier_t classify )
+{
+    if( ( pMsgCtx == NULL ) || ( laneLengths == NULL ) ||
+        ( laneLengths[ AGENT_MESSAGE_LANE_BULK ] == 0U ) || pMsgCtx->initialised )
+    {
+        return false;
+    }
+
+    if( !initContext( pMsgCtx, laneLengths ) )
+    {
+        return false;
+    }
+
+    pMsgCtx->multiLane = true;
+    pMsgCtx->classify = classify;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MessageDelete( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    size_t lane;
+
+    if( ( pMsgCtx == NULL ) || !pMsgCtx->initialised )
+    {
+        return;
+    }
+
+    for( lane = 0; lane < AGENT_MESSAGE_LANE_COUNT; lane++ )
+    {
+        free( pMsgCtx->lanes[ lane ].pItems );
+    }
+
+    ( void ) pthread_cond_destroy( &pMsgCtx->notEmpty );
+    ( void ) pthread_cond_destroy( &pMsgCtx->notFull );
+    ( void ) pthread_mutex_destroy( &pMsgCtx->lock );
+    memset( pMsgCtx, 0x00, sizeof( MQTTAgentMessageContext_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageGetLaneStats( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageLane_t lane,
+                                AgentMessageLaneStats_t * pStats )
+{
+    if( ( pMsgCtx == NULL ) || ( pStats == NULL ) || ( lane >= AGENT_MESSAGE_LANE_COUNT ) ||
+        !pMsgCtx->multiLane || ( pMsgCtx->lanes[ lane ].pItems == NULL ) )
+    {
+        return false;
+    }
+
+    ( void ) pthread_mutex_lock( &pMsgCtx->lock );
+    *pStats = pMsgCtx->laneStats[ lane ];
+    pStats->depth = pMsgCtx->lanes[ lane ].count;
+    ( void ) pthread_mutex_unlock( &pMsgCtx->lock );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t * const * pCommandToSend,
+                        uint32_t blockTimeMs )
+{
+    AgentMessageClassifier_t classify;
+    AgentMessageLane_t lane = AGENT_MESSAGE_LANE_BULK;
+    AgentMessageRing_t * pRing;
+    struct timespec deadline;
+    bool sent = false;
+
+    if( ( pMsgCtx == NULL ) || ( pCommandToSend == NULL ) || !pMsgCtx->initialised )
+    {
+        return false;
+    }
+
+    if( pMsgCtx->multiLane )
+    {
+        classify = ( pMsgCtx->classify != NULL ) ? pMsgCtx->classify : defaultClassifier;
+        lane = classify( *pCommandToSend );
+
+        if( lane >= AGENT_MESSAGE_LANE_COUNT )
+        {
+            lane = AGENT_MESSAGE_LANE_BULK;
+        }
+    }
+
+    pRing = laneRing( pMsgCtx, &lane );
+
+    makeDeadline( &deadline, blockTimeMs );
+    ( void ) pthread_mutex_lock( &pMsgCtx->lock );
+
+    while( ( pRing->count == pRing->length ) &&
+           waitLocked( pMsgCtx, &pMsgCtx->notFull, &deadline, blockTimeMs ) )
+    {
+    }
+
+    if( pRing->count < pRing->length )
+    {
+        pRing->pItems[ ( pRing->head + pRing->count ) % pRing->length ] = *pCommandToSend;
+        pRing->count++;
+        pMsgCtx->pending++;
+
+        pMsgCtx->laneStats[ lane ].sent++;
+
+        if( pRing->count > pMsgCtx->laneStats[ lane ].maxDepth )
+        {
+            pMsgCtx->laneStats[ lane ].maxDepth = pRing->count;
+        }
+
+        ( void ) pthread_cond_signal( &pMsgCtx->notEmpty );
+        sent = true;
+    }
+
+    ( void ) pthread_mutex_unlock( &pMsgCtx->lock );
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
+                           MQTTAgentCommand_t ** pReceivedCommand,
+                           uint32_t blockTimeMs )
+{
+    size_t batchSize;
+
+    if( ( pMsgCtx == NULL ) || ( pReceivedCommand == NULL ) || !pMsgCtx->initialised )
+    {
+        return false;
+    }
+
+    batchSize = ( pMsgCtx->batchSize < AGENT_MESSAGE_BATCH_MAX ) ? pMsgCtx->batchSize : AGENT_MESSAGE_BATCH_MAX;
+
+    /* Multi-lane contexts do not batch, so a buffered bulk command cannot
+     * overtake a control command sent after it. */
+    if( pMsgCtx->multiLane || ( batchSize <= 1U ) )
+    {
+        return receiveCommands( pMsgCtx, pReceivedCommand, 1U, blockTimeMs ) == 1U;
+    }
+
+    if( pMsgCtx->batchCount == 0U )
+    {
+        pMsgCtx->batchHead = 0U;
+        pMsgCtx->batchCount = ( uint8_t ) receiveCommands( pMsgCtx, pMsgCtx->batch,
+                                                           batchSize, blockTimeMs );
+    }
+
+    if( pMsgCtx->batchCount == 0U )
+    {
+        return false;
+    }
+
+    *pReceivedCommand = pMsgCtx->batch[ pMsgCtx->batchHead++ ];
+    pMsgCtx->batchCount--;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t Agent_MessageReceiveBatch( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs )
+{
+    size_t received = 0U;
+
+    if( ( pMsgCtx == NULL ) || ( pCommands == NULL ) || ( maxCommands == 0U ) ||
+        !pMsgCtx->initialised )
+    {
+        return 0U;
+    }
+
+    /* Hand out anything a batching Agent_MessageReceive() buffered first. */
+    while( ( received < maxCommands ) && ( pMsgCtx->batchCount > 0U ) )
+    {
+        pCommands[ received++ ] = pMsgCtx->batch[ pMsgCtx->batchHead++ ];
+        pMsgCtx->batchCount--;
+    }
+
+    if( received < maxCommands )
+    {
+        received += receiveCommands( pMsgCtx, &pCommands[ received ], maxCommands - received,
+                                     ( received == 0U ) ? blockTimeMs : 0U );
+    }
+
+    return received;
+}
@@ -0,0 +1,178 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+/**
+ * @file freertos_agent_message.h
+ * @brief Host (Linux) build of the agent message functions.
+ *
+ * Implements the API of the FreeRTOS port one directory up with pthread
+ * mutexes and condition variables, so the agent can be run and measured
+ * natively. The queues are created with Agent_MessageInit() or
+ * Agent_MessageInitLanes() instead of xQueueCreate().
+ */
+#ifndef FREERTOS_AGENT_MESSAGE_H
+#define FREERTOS_AGENT_MESSAGE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include MQTT agent messaging interface. */
+#include "core_mqtt_agent_message_interface.h"
+
+/**
+ * @brief Block time that waits forever, as portMAX_DELAY does on FreeRTOS.
+ */
+#define AGENT_MESSAGE_WAIT_FOREVER    ( UINT32_MAX )
+
+/**
+ * @brief Largest batch Agent_MessageReceive() can buffer, see
+ * MQTTAgentMessageContext::batchSize.
+ */
+#define AGENT_MESSAGE_BATCH_MAX       ( 8U )
+
+/**
+ * @brief Priority lanes of a message context, highest priority first.
+ */
+typedef enum AgentMessageLane
+{
+    AGENT_MESSAGE_LANE_CONTROL = 0, /**< Subscribe, unsubscribe, ping and connect. */
+    AGENT_MESSAGE_LANE_HIGH,        /**< Latency sensitive publishes, chosen by the classifier. */
+    AGENT_MESSAGE_LANE_BULK,        /**< Other publishes, e.g. telemetry, disconnect and terminate. */
+    AGENT_MESSAGE_LANE_COUNT
+} AgentMessageLane_t;
+
+/**
+ * @brief Picks the lane of a command. Called from Agent_MessageSend() in the
+ * sending thread, so it must be thread safe and quick.
+ */
+typedef AgentMessageLane_t ( * AgentMessageClassifier_t )( const MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Depth metrics of one lane.
+ */
+typedef struct AgentMessageLaneStats
+{
+    uint32_t depth;    /**< @brief Commands currently queued. */
+    uint32_t maxDepth; /**< @brief Largest depth observed after a send. */
+    uint32_t sent;     /**< @brief Commands queued in the lane. */
+    uint32_t received; /**< @brief Commands taken from the lane. */
+} AgentMessageLaneStats_t;
+
+/**
+ * @brief A bounded FIFO of commands. Guarded by MQTTAgentMessageContext::lock.
+ */
+typedef struct AgentMessageRing
+{
+    MQTTAgentCommand_t ** pItems; /**< @brief Storage, NULL for an unused lane. */
+    uint32_t length;              /**< @brief Capacity. */
+    uint32_t head;                /**< @brief Oldest command. */
+    uint32_t count;               /**< @brief Commands queued. */
+} AgentMessageRing_t;
+
+/**
+ * @ingroup mqtt_agent_struct_types
+ * @brief Context with which threads may deliver messages to the agent.
+ *
+ * After Agent_MessageInit() only the bulk lane is used, as a single FIFO.
+ * After Agent_MessageInitLanes() there is one FIFO per #AgentMessageLane_t.
+ */
+struct MQTTAgentMessageContext
+{
+    pthread_mutex_t lock;     /**< Guards the rings, credits and batch buffer. */
+    pthread_cond_t notEmpty;  /**< Signalled when a command is queued. */
+    pthread_cond_t notFull;   /**< Broadcast when a command is taken. */
+    bool initialised;         /**< The mutex, conditions and rings exist. */
+    bool multiLane;           /**< Commands are classified into lanes. */
+    uint32_t pending;         /**< Commands queued over all lanes. */
+
+    AgentMessageRing_t lanes[ AGENT_MESSAGE_LANE_COUNT ]; /**< Lane FIFOs. */
+    AgentMessageClassifier_t classify;                    /**< Lane of each command, NULL for the default. */
+
+    /**
+     * @brief Dequeue weights, as on FreeRTOS. All zero selects strict
+     * priority.
+     */
+    uint8_t weights[ AGENT_MESSAGE_LANE_COUNT ];
+    uint8_t credits[ AGENT_MESSAGE_LANE_COUNT ]; /**< Remaining weight of the current round. */
+    AgentMessageLaneStats_t laneStats[ AGENT_MESSAGE_LANE_COUNT ];
+
+    /**
+     * @brief Commands Agent_MessageReceive() drains from a single FIFO
+     * context per refill, up to #AGENT_MESSAGE_BATCH_MAX. 0 or 1 receives one
+     * command at a time.
+     */
+    uint8_t batchSize;
+    uint8_t batchHead;                                /**< Next buffered command. */
+    uint8_t batchCount;                               /**< Buffered commands left. */
+    MQTTAgentCommand_t * batch[ AGENT_MESSAGE_BATCH_MAX ];
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Turn a zero-initialised context into a single FIFO of the given
+ * length. Call before the context is shared with other threads.
+ *
+ * @return `true` on success, `false` if a parameter is invalid or memory
+ * runs out.
+ */
+bool Agent_MessageInit( MQTTAgentMessageContext_t * pMsgCtx,
+                        uint32_t queueLength );
+
+/**
+ * @brief Turn a zero-initialised context into a multi-lane one. See the
+ * FreeRTOS port.
+ */
+bool Agent_MessageInitLanes( MQTTAgentMessageContext_t * pMsgCtx,
+                             const uint32_t laneLengths[ AGENT_MESSAGE_LANE_COUNT ],
+                             AgentMessageClassifier_t classify );
+
+/**
+ * @brief Free the queues of a context. No thread may be using it.
+ */
+void Agent_MessageDelete( MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Send a message to the specified context. Thread safe.
+ */
+bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t * const * pCommandToSend,
+                        uint32_t blockTimeMs );
+
+/**
+ * @brief Receive a message from the specified context. Thread safe.
+ */
+bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
+                           MQTTAgentCommand_t ** pReceivedCommand,
+                           uint32_t blockTimeMs );
+
+/**
+ * @brief Receive up to @p maxCommands commands in one call. See the FreeRTOS
+ * port.
+ */
+size_t Agent_MessageReceiveBatch( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs );
+
+/**
+ * @brief Read the depth metrics of a lane of a multi-lane context.
+ *
+ * @return `false` if the context has no such lane.
+ */
+bool Agent_MessageGetLaneStats( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageLane_t lane,
+                                AgentMessageLaneStats_t * pStats );
+
+#endif /* FREERTOS_AGENT_MESSAGE_H */
@@ -0,0 +1,553 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+/**
+ * @file freertos_command_pool.c
+ * @brief Implements functions to obtain and release commands.
+ */
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Header include. */
+#include "freertos_command_pool.h"
+
+/*-----------------------------------------------------------*/
+
+#define QUEUE_NOT_INITIALIZED    ( 0U )
+#define QUEUE_INITIALIZED        ( 1U )
+
+#ifndef MQTT_COMMAND_CONTEXTS_POOL_SIZE
+    #define MQTT_COMMAND_CONTEXTS_POOL_SIZE        ( 10 )
+#endif
+
+#ifndef MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW
+    #define MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW    ( 0 )
+#endif
+
+/**
+ * @brief Index marking the end of the free list.
+ */
+#define FREE_LIST_END                       ( 0xFFFFU )
+
+/**
+ * @brief Marks an overflow slot taken by a heap allocation still in progress.
+ */
+#define OVERFLOW_SLOT_RESERVED              ( ( MQTTAgentCommand_t * ) ( uintptr_t ) 1U )
+
+/**
+ * @brief The free list head packs the index of the first free command in the
+ * low half and a modification counter in the high half. The counter changes on
+ * every update, so a compare-and-swap cannot succeed on a head that was popped
+ * and pushed back in between (the ABA problem).
+ */
+#define HEAD_INDEX( head )                  ( ( head ) & 0xFFFFU )
+#define HEAD_MAKE( head, index )            ( ( ( ( head ) + 0x10000U ) & 0xFFFF0000U ) | ( index ) )
+
+/**
+ * @brief The default pool, used by Agent_GetCommand() and
+ * Agent_ReleaseCommand(), and its statically allocated storage.
+ */
+static AgentCommandPool_t defaultPool;
+static MQTTAgentCommand_t commandStructurePool[ MQTT_COMMAND_CONTEXTS_POOL_SIZE ];
+static uint16_t nextFree[ MQTT_COMMAND_CONTEXTS_POOL_SIZE ];
+
+#if MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW > 0
+    static MQTTAgentCommand_t * overflowCommands[ MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW ];
+#endif
+
+/*-----------------------------------------------------------*/
+
+static uint64_t monotonicMs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000U ) + ( ( uint64_t ) now.tv_nsec / 1000000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentCommand_t * popFreeCommand( AgentCommandPool_t * pPool )
+{
+    uint32_t head = __atomic_load_n( &pPool->freeListHead, __ATOMIC_SEQ_CST );
+    uint32_t newHead;
+    uint32_t index;
+
+    do
+    {
+        index = HEAD_INDEX( head );
+
+        if( index == FREE_LIST_END )
+        {
+            return NULL;
+        }
+
+        /* The link may be rewritten by a concurrent pop and push of the same
+         * command; the tag in the head then fails the exchange and the stale
+         * value is discarded. */
+        newHead = HEAD_MAKE( head, __atomic_load_n( &pPool->pNextFree[ index ], __ATOMIC_RELAXED ) );
+    } while( !__atomic_compare_exchange_n( &pPool->freeListHead, &head, newHead, true,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+    return &pPool->pCommands[ index ];
+}
+
+/*-----------------------------------------------------------*/
+
+static void pushFreeCommand( AgentCommandPool_t * pPool,
+                             uint32_t index )
+{
+    uint32_t head = __atomic_load_n( &pPool->freeListHead, __ATOMIC_SEQ_CST );
+
+    do
+    {
+        __atomic_store_n( &pPool->pNextFree[ index ], ( uint16_t ) HEAD_INDEX( head ), __ATOMIC_RELAXED );
+    } while( !__atomic_compare_exchange_n( &pPool->freeListHead, &head, HEAD_MAKE( head, index ), true,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void updateMaximum( uint32_t * pMaximum,
+                           uint32_t value )
+{
+    uint32_t current = __atomic_load_n( pMaximum, __ATOMIC_RELAXED );
+
+    while( ( value > current ) &&
+           !__atomic_compare_exchange_n( pMaximum, &current, value, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+    {
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void accountAcquire( AgentCommandPool_t * pPool )
+{
+    updateMaximum( &pPool->stats.highWatermark,
+                   __atomic_add_fetch( &pPool->stats.inUse, 1U, __ATOMIC_RELAXED ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentCommand_t * allocateOverflowCommand( AgentCommandPool_t * pPool )
+{
+    MQTTAgentCommand_t * pCommand;
+    size_t i;
+
+    if( pPool->overflowLimit == 0U )
+    {
+        return NULL;
+    }
+
+    /* Reserve a slot first, so a full arena costs no heap traffic. */
+    ( void ) pthread_mutex_lock( &pPool->overflowLock );
+
+    for( i = 0; i < pPool->overflowLimit; i++ )
+    {
+        if( pPool->pOverflowCommands[ i ] == NULL )
+        {
+            pPool->pOverflowCommands[ i ] = OVERFLOW_SLOT_RESERVED;
+            break;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pPool->overflowLock );
+
+    if( i == pPool->overflowLimit )
+    {
+        /* The overflow arena is full too. */
+        return NULL;
+    }
+
+    pCommand = calloc( 1, sizeof( MQTTAgentCommand_t ) );
+
+    ( void ) pthread_mutex_lock( &pPool->overflowLock );
+    pPool->pOverflowCommands[ i ] = pCommand;
+    ( void ) pthread_mutex_unlock( &pPool->overflowLock );
+
+    if( pCommand == NULL )
+    {
+        return NULL;
+    }
+
+    __atomic_add_fetch( &pPool->stats.overflowAllocations, 1U, __ATOMIC_RELAXED );
+    updateMaximum( &pPool->stats.overflowHighWatermark,
+                   __atomic_add_fetch( &pPool->stats.overflowInUse, 1U, __ATOMIC_RELAXED ) );
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool freeOverflowCommand( AgentCommandPool_t * pPool,
+                                 MQTTAgentCommand_t * pCommand )
+{
+    bool found = false;
+    size_t i;
+
+    if( pPool->overflowLimit == 0U )
+    {
+        return false;
+    }
+
+    ( void ) pthread_mutex_lock( &pPool->overflowLock );
+
+    for( i = 0; i < pPool->overflowLimit; i++ )
+    {
+        if( pPool->pOverflowCommands[ i ] == pCommand )
+        {
+            /* Account before the slot reopens, so a concurrent get cannot
+             * push inUse above the pool size plus the overflow limit. */
+            __atomic_sub_fetch( &pPool->stats.inUse, 1U, __ATOMIC_RELAXED );
+            __atomic_sub_fetch( &pPool->stats.overflowInUse, 1U, __ATOMIC_RELAXED );
+            pPool->pOverflowCommands[ i ] = NULL;
+            found = true;
+            break;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &pPool->overflowLock );
+
+    if( found )
+    {
+        /* Shrink back straight away; the static pool covers the steady state. */
+        free( pCommand );
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentCommand_t * takeCommand( AgentCommandPool_t * pPool )
+{
+    MQTTAgentCommand_t * pCommand = popFreeCommand( pPool );
+
+    if( pCommand == NULL )
+    {
+        pCommand = allocateOverflowCommand( pPool );
+    }
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_PoolInitStatic( AgentCommandPool_t * pPool,
+                           MQTTAgentCommand_t * pCommands,
+                           uint16_t * pNextFree,
+                           size_t poolSize,
+                           MQTTAgentCommand_t ** pOverflowCommands,
+                           size_t overflowLimit )
+{
+    pthread_condattr_t attributes;
+    size_t i;
+
+    if( ( pPool == NULL ) || ( pCommands == NULL ) || ( pNextFree == NULL ) ||
+        ( poolSize == 0U ) || ( poolSize >= FREE_LIST_END ) ||
+        ( ( overflowLimit > 0U ) && ( pOverflowCommands == NULL ) ) )
+    {
+        LogError( ( "Invalid command pool parameters." ) );
+        return false;
+    }
+
+    memset( pPool, 0x00, sizeof( AgentCommandPool_t ) );
+    memset( pCommands, 0x00, poolSize * sizeof( MQTTAgentCommand_t ) );
+
+    if( overflowLimit > 0U )
+    {
+        memset( pOverflowCommands, 0x00, overflowLimit * sizeof( MQTTAgentCommand_t * ) );
+    }
+
+    /* Chain every command into the free list. */
+    for( i = 0; i < poolSize; i++ )
+    {
+        pNextFree[ i ] = ( uint16_t ) ( i + 1U );
+    }
+
+    pNextFree[ poolSize - 1U ] = FREE_LIST_END;
+
+    pPool->pCommands = pCommands;
+    pPool->pNextFree = pNextFree;
+    pPool->poolSize = poolSize;
+    pPool->freeListHead = 0U;
+    pPool->pOverflowCommands = pOverflowCommands;
+    pPool->overflowLimit = overflowLimit;
+    ( void ) pthread_mutex_init( &pPool->overflowLock, NULL );
+    ( void ) pthread_mutex_init( &pPool->waitLock, NULL );
+
+    /* Deadlines are taken from the monotonic clock. */
+    ( void ) pthread_condattr_init( &attributes );
+    ( void ) pthread_condattr_setclock( &attributes, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( &pPool->commandAvailable, &attributes );
+    ( void ) pthread_condattr_destroy( &attributes );
+
+    pPool->initStatus = QUEUE_INITIALIZED;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_PoolInit( AgentCommandPool_t * pPool,
+                     size_t poolSize,
+                     size_t overflowLimit )
+{
+    MQTTAgentCommand_t * pCommands;
+    uint16_t * pNextFree;
+    MQTTAgentCommand_t ** pOverflowCommands = NULL;
+
+    if( ( pPool == NULL ) || ( poolSize == 0U ) || ( poolSize >= FREE_LIST_END ) )
+    {
+        LogError( ( "Invalid command pool parameters." ) );
+        return false;
+    }
+
+    pCommands = malloc( poolSize * sizeof( MQTTAgentCommand_t ) );
+    pNextFree = malloc( poolSize * sizeof( uint16_t ) );
+
+    if( overflowLimit > 0U )
+    {
+        pOverflowCommands = malloc( overflowLimit * sizeof( MQTTAgentCommand_t * ) );
+    }
+
+    if( ( pCommands == NULL ) || ( pNextFree == NULL ) ||
+        ( ( overflowLimit > 0U ) && ( pOverflowCommands == NULL ) ) )
+    {
+        LogError( ( "Could not allocate a pool of %u commands.", ( unsigned int ) poolSize ) );
+        free( pCommands );
+        free( pNextFree );
+        free( pOverflowCommands );
+        return false;
+    }
+
+    ( void ) Agent_PoolInitStatic( pPool, pCommands, pNextFree, poolSize,
+                                   pOverflowCommands, overflowLimit );
+    pPool->ownsStorage = true;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_PoolDelete( AgentCommandPool_t * pPool )
+{
+    if( ( pPool == NULL ) || ( pPool->initStatus != QUEUE_INITIALIZED ) )
+    {
+        return;
+    }
+
+    if( __atomic_load_n( &pPool->stats.inUse, __ATOMIC_RELAXED ) != 0U )
+    {
+        LogError( ( "Deleting a command pool with %u commands in use.",
+                    ( unsigned int ) pPool->stats.inUse ) );
+    }
+
+    pPool->initStatus = QUEUE_NOT_INITIALIZED;
+    ( void ) pthread_cond_destroy( &pPool->commandAvailable );
+    ( void ) pthread_mutex_destroy( &pPool->waitLock );
+    ( void ) pthread_mutex_destroy( &pPool->overflowLock );
+
+    if( pPool->ownsStorage )
+    {
+        free( pPool->pCommands );
+        free( pPool->pNextFree );
+        free( pPool->pOverflowCommands );
+    }
+
+    memset( pPool, 0x00, sizeof( AgentCommandPool_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentCommand_t * Agent_PoolGetCommand( AgentCommandPool_t * pPool,
+                                           uint32_t blockTimeMs )
+{
+    MQTTAgentCommand_t * structToUse = NULL;
+    struct timespec deadline;
+    uint64_t startMs;
+    uint32_t elapsedMs;
+
+    /* Check the pool has been created. */
+    assert( ( pPool != NULL ) && ( pPool->initStatus == QUEUE_INITIALIZED ) );
+
+    structToUse = popFreeCommand( pPool );
+
+    if( structToUse == NULL )
+    {
+        __atomic_add_fetch( &pPool->stats.exhaustedCount, 1U, __ATOMIC_RELAXED );
+        structToUse = allocateOverflowCommand( pPool );
+    }
+
+    if( ( structToUse == NULL ) && ( blockTimeMs > 0U ) )
+    {
+        startMs = monotonicMs();
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &deadline );
+        deadline.tv_sec += ( time_t ) ( blockTimeMs / 1000U );
+        deadline.tv_nsec += ( long ) ( blockTimeMs % 1000U ) * 1000000L;
+
+        if( deadline.tv_nsec >= 1000000000L )
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        /* Register as a waiter before checking again, so a command released
+         * in between either is found by the check or signals the condition.
+         * The release signals with waitLock held, so it cannot fall between
+         * the check and the wait. */
+        ( void ) pthread_mutex_lock( &pPool->waitLock );
+        __atomic_add_fetch( &pPool->waitingTasks, 1U, __ATOMIC_SEQ_CST );
+
+        for( ; ; )
+        {
+            structToUse = takeCommand( pPool );
+
+            if( ( structToUse != NULL ) ||
+                ( pthread_cond_timedwait( &pPool->commandAvailable, &pPool->waitLock, &deadline ) == ETIMEDOUT ) )
+            {
+                break;
+            }
+        }
+
+        if( structToUse == NULL )
+        {
+            /* A command released just before the timeout. */
+            structToUse = takeCommand( pPool );
+        }
+
+        __atomic_sub_fetch( &pPool->waitingTasks, 1U, __ATOMIC_SEQ_CST );
+        ( void ) pthread_mutex_unlock( &pPool->waitLock );
+
+        elapsedMs = ( uint32_t ) ( monotonicMs() - startMs );
+        __atomic_add_fetch( &pPool->stats.waitCount, 1U, __ATOMIC_RELAXED );
+        __atomic_add_fetch( &pPool->stats.totalWaitMs, elapsedMs, __ATOMIC_RELAXED );
+        updateMaximum( &pPool->stats.maxWaitMs, elapsedMs );
+    }
+
+    if( structToUse == NULL )
+    {
+        __atomic_add_fetch( &pPool->stats.failedCount, 1U, __ATOMIC_RELAXED );
+        LogError( ( "No command structure available." ) );
+    }
+    else
+    {
+        accountAcquire( pPool );
+    }
+
+    return structToUse;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_PoolReleaseCommand( AgentCommandPool_t * pPool,
+                               MQTTAgentCommand_t * pCommandToRelease )
+{
+    bool structReturned = false;
+
+    assert( ( pPool != NULL ) && ( pPool->initStatus == QUEUE_INITIALIZED ) );
+
+    /* See if the structure being returned is actually from the pool. */
+    if( ( pCommandToRelease >= pPool->pCommands ) &&
+        ( pCommandToRelease < ( pPool->pCommands + pPool->poolSize ) ) )
+    {
+        /* Account first, so a concurrent get cannot push inUse above the
+         * pool size. */
+        __atomic_sub_fetch( &pPool->stats.inUse, 1U, __ATOMIC_RELAXED );
+        pushFreeCommand( pPool, ( uint32_t ) ( pCommandToRelease - pPool->pCommands ) );
+        structReturned = true;
+    }
+    else if( ( pCommandToRelease != NULL ) && freeOverflowCommand( pPool, pCommandToRelease ) )
+    {
+        structReturned = true;
+    }
+
+    if( structReturned )
+    {
+        /* Wake a task waiting for a command; freed overflow headroom counts
+         * too. A spurious wake-up only makes the waiter check again. */
+        if( __atomic_load_n( &pPool->waitingTasks, __ATOMIC_SEQ_CST ) > 0U )
+        {
+            ( void ) pthread_mutex_lock( &pPool->waitLock );
+            ( void ) pthread_cond_signal( &pPool->commandAvailable );
+            ( void ) pthread_mutex_unlock( &pPool->waitLock );
+        }
+    }
+
+    return structReturned;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_PoolGetStats( AgentCommandPool_t * pPool,
+                         AgentCommandPoolStats_t * pStats )
+{
+    if( ( pPool != NULL ) && ( pStats != NULL ) )
+    {
+        pStats->inUse = __atomic_load_n( &pPool->stats.inUse, __ATOMIC_RELAXED );
+        pStats->highWatermark = __atomic_load_n( &pPool->stats.highWatermark, __ATOMIC_RELAXED );
+        pStats->exhaustedCount = __atomic_load_n( &pPool->stats.exhaustedCount, __ATOMIC_RELAXED );
+        pStats->failedCount = __atomic_load_n( &pPool->stats.failedCount, __ATOMIC_RELAXED );
+        pStats->waitCount = __atomic_load_n( &pPool->stats.waitCount, __ATOMIC_RELAXED );
+        pStats->totalWaitMs = __atomic_load_n( &pPool->stats.totalWaitMs, __ATOMIC_RELAXED );
+        pStats->maxWaitMs = __atomic_load_n( &pPool->stats.maxWaitMs, __ATOMIC_RELAXED );
+        pStats->overflowInUse = __atomic_load_n( &pPool->stats.overflowInUse, __ATOMIC_RELAXED );
+        pStats->overflowHighWatermark = __atomic_load_n( &pPool->stats.overflowHighWatermark, __ATOMIC_RELAXED );
+        pStats->overflowAllocations = __atomic_load_n( &pPool->stats.overflowAllocations, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_InitializePool( void )
+{
+    if( defaultPool.initStatus == QUEUE_NOT_INITIALIZED )
+    {
+        #if MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW > 0
+            ( void ) Agent_PoolInitStatic( &defaultPool, commandStructurePool, nextFree,
+                                           MQTT_COMMAND_CONTEXTS_POOL_SIZE,
+                                           overflowCommands, MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW );
+        #else
+            ( void ) Agent_PoolInitStatic( &defaultPool, commandStructurePool, nextFree,
+                                           MQTT_COMMAND_CONTEXTS_POOL_SIZE, NULL, 0U );
+        #endif
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs )
+{
+    return Agent_PoolGetCommand( &defaultPool, blockTimeMs );
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease )
+{
+    return Agent_PoolReleaseCommand( &defaultPool, pCommandToRelease );
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_GetPoolStats( AgentCommandPoolStats_t * pStats )
+{
+    Agent_PoolGetStats( &defaultPool, pStats );
+}
+
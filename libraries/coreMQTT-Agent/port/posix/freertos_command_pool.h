@@ -0,0 +1,237 @@
+/*
+ * ThirdEye
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+/**
+ * @file freertos_command_pool.h
+ * @brief Host (Linux) build of the functions to obtain and release a command.
+ *
+ * Implements the API of the FreeRTOS port one directory up, blocking on a
+ * pthread condition variable instead of a semaphore. Payload pools are not
+ * available on the host.
+ */
+#ifndef FREERTOS_COMMAND_POOL_H
+#define FREERTOS_COMMAND_POOL_H
+
+#include <pthread.h>
+
+/* MQTT agent includes. */
+#include "core_mqtt_agent.h"
+
+/**
+ * @brief Usage statistics of the command pool, see Agent_GetPoolStats().
+ */
+typedef struct AgentCommandPoolStats
+{
+    uint32_t inUse;                 /**< @brief Commands currently handed out, overflow included. */
+    uint32_t highWatermark;         /**< @brief Largest value inUse has reached. */
+    uint32_t exhaustedCount;        /**< @brief Agent_GetCommand() calls that found the static pool empty. */
+    uint32_t failedCount;           /**< @brief Agent_GetCommand() calls that returned NULL. */
+    uint32_t waitCount;             /**< @brief Agent_GetCommand() calls that blocked. */
+    uint32_t totalWaitMs;           /**< @brief Total time spent blocked. */
+    uint32_t maxWaitMs;             /**< @brief Longest single block. */
+    uint32_t overflowInUse;         /**< @brief Heap allocated commands currently handed out. */
+    uint32_t overflowHighWatermark; /**< @brief Largest value overflowInUse has reached. */
+    uint32_t overflowAllocations;   /**< @brief Heap allocations made for the overflow arena. */
+} AgentCommandPoolStats_t;
+
+/**
+ * @brief A pool of command structures.
+ *
+ * Each MQTT agent instance needs its own pool, sized for its own traffic.
+ * The Agent_Pool*() functions operate on a pool object; Agent_InitializePool(),
+ * Agent_GetCommand(), Agent_ReleaseCommand() and Agent_GetPoolStats() operate
+ * on a default pool sized by MQTT_COMMAND_CONTEXTS_POOL_SIZE and
+ * MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW.
+ *
+ * @note The members are private to freertos_command_pool.c. They are declared
+ * here so that pools can be allocated statically.
+ */
+typedef struct AgentCommandPool
+{
+    MQTTAgentCommand_t * pCommands;         /**< @brief Command structures, poolSize entries. */
+    uint16_t * pNextFree;                   /**< @brief Free list links, poolSize entries. */
+    size_t poolSize;                        /**< @brief Number of command structures. */
+    uint32_t freeListHead;                  /**< @brief Free list head and modification counter. */
+    uint32_t waitingTasks;                  /**< @brief Threads blocked waiting for a command. */
+    pthread_mutex_t waitLock;               /**< @brief Guards waiting on commandAvailable. */
+    pthread_cond_t commandAvailable;        /**< @brief Signalled on release while threads wait. */
+    MQTTAgentCommand_t ** pOverflowCommands; /**< @brief Heap allocated commands in use, overflowLimit entries. */
+    size_t overflowLimit;                   /**< @brief Maximum number of heap allocated commands. */
+    pthread_mutex_t overflowLock;           /**< @brief Guards pOverflowCommands. */
+    AgentCommandPoolStats_t stats;          /**< @brief Usage statistics. */
+    bool ownsStorage;                       /**< @brief Storage was allocated by Agent_PoolInit(). */
+    volatile uint8_t initStatus;            /**< @brief Whether the pool is initialized. */
+} AgentCommandPool_t;
+
+/**
+ * @brief Define the functions an MQTTAgentMessageInterface_t needs to use a
+ * pool other than the default one.
+ *
+ * The agent calls getCommand and releaseCommand without a context, so each
+ * pool needs its own pair of functions. For example:
+ *
+ * @code{c}
+ * static AgentCommandPool_t telemetryPool;
+ * AGENT_COMMAND_POOL_INTERFACE( telemetry, telemetryPool )
+ *
+ * messageInterface.getCommand = telemetryGetCommand;
+ * messageInterface.releaseCommand = telemetryReleaseCommand;
+ * @endcode
+ *
+ * @param[in] prefix Prefix of the names of the defined functions.
+ * @param[in] pool The AgentCommandPool_t object, not a pointer to it.
+ */
+#define AGENT_COMMAND_POOL_INTERFACE( prefix, pool )                             \
+    static MQTTAgentCommand_t * prefix ## GetCommand( uint32_t blockTimeMs )      \
+    {                                                                            \
+        return Agent_PoolGetCommand( &( pool ), blockTimeMs );                   \
+    }                                                                            \
+    static bool prefix ## ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease ) \
+    {                                                                            \
+        return Agent_PoolReleaseCommand( &( pool ), pCommandToRelease );         \
+    }
+
+/**
+ * @brief Initialize a pool, allocating its storage from the heap. Not thread
+ * safe.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] poolSize Number of command structures, between 1 and 65534.
+ * @param[in] overflowLimit Number of commands that may be allocated from the
+ * heap while the pool is exhausted. Zero disables overflow.
+ *
+ * @return true if the pool was initialized, false if a parameter is invalid or
+ * the storage could not be allocated.
+ */
+bool Agent_PoolInit( AgentCommandPool_t * pPool,
+                     size_t poolSize,
+                     size_t overflowLimit );
+
+/**
+ * @brief Initialize a pool using storage supplied by the caller. Not thread
+ * safe.
+ *
+ * @param[out] pPool The pool to initialize.
+ * @param[in] pCommands Array of poolSize command structures.
+ * @param[in] pNextFree Array of poolSize free list links.
+ * @param[in] poolSize Number of command structures, between 1 and 65534.
+ * @param[in] pOverflowCommands Array of overflowLimit pointers, or NULL if
+ * overflowLimit is zero.
+ * @param[in] overflowLimit Number of commands that may be allocated from the
+ * heap while the pool is exhausted. Zero disables overflow.
+ *
+ * @return true if the pool was initialized, false if a parameter is invalid.
+ */
+bool Agent_PoolInitStatic( AgentCommandPool_t * pPool,
+                           MQTTAgentCommand_t * pCommands,
+                           uint16_t * pNextFree,
+                           size_t poolSize,
+                           MQTTAgentCommand_t ** pOverflowCommands,
+                           size_t overflowLimit );
+
+/**
+ * @brief Delete a pool, freeing the storage allocated by Agent_PoolInit().
+ *
+ * @note Every command must have been released, and no task may be using the
+ * pool.
+ *
+ * @param[in] pPool The pool to delete.
+ */
+void Agent_PoolDelete( AgentCommandPool_t * pPool );
+
+/**
+ * @brief Obtain a command structure from a pool. See Agent_GetCommand().
+ *
+ * @param[in] pPool The pool.
+ * @param[in] blockTimeMs How long to wait for a command structure.
+ *
+ * @return A command structure, or NULL if none became available in time.
+ */
+MQTTAgentCommand_t * Agent_PoolGetCommand( AgentCommandPool_t * pPool,
+                                           uint32_t blockTimeMs );
+
+/**
+ * @brief Return a command structure to the pool it was obtained from. See
+ * Agent_ReleaseCommand().
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pCommandToRelease The command structure to return.
+ *
+ * @return true if the command structure belonged to the pool and was returned.
+ */
+bool Agent_PoolReleaseCommand( AgentCommandPool_t * pPool,
+                               MQTTAgentCommand_t * pCommandToRelease );
+
+/**
+ * @brief Read the usage statistics of a pool. See Agent_GetPoolStats().
+ *
+ * @param[in] pPool The pool.
+ * @param[out] pStats Where to store the statistics.
+ */
+void Agent_PoolGetStats( AgentCommandPool_t * pPool,
+                         AgentCommandPoolStats_t * pStats );
+
+/**
+ * @brief Initialize the common task pool. Not thread safe.
+ */
+void Agent_InitializePool( void );
+
+/**
+ * @brief Obtain a MQTTAgentCommand_t structure from the pool of structures managed by the agent.
+ *
+ * @note MQTTAgentCommand_t structures hold everything the MQTT agent needs to process a
+ * command that originates from application.  Examples of commands are PUBLISH and
+ * SUBSCRIBE.  The MQTTAgentCommand_t structure must persist for the duration of the command's
+ * operation so are obtained from a pool of statically allocated structures when a
+ * new command is created, and returned to the pool when the command is complete.
+ * The MQTT_COMMAND_CONTEXTS_POOL_SIZE configuration file constant defines how many
+ * structures the pool contains.
+ *
+ * @param[in] blockTimeMs The length of time the calling task should remain in the
+ * Blocked state (so not consuming any CPU time) to wait for a MQTTAgentCommand_t structure to
+ * become available should one not be immediately at the time of the call.
+ *
+ * @return A pointer to a MQTTAgentCommand_t structure if one becomes available before
+ * blockTimeMs time expired, otherwise NULL.
+ */
+MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs );
+
+/**
+ * @brief Give a MQTTAgentCommand_t structure back to the the pool of structures managed by
+ * the agent.
+ *
+ * @note MQTTAgentCommand_t structures hold everything the MQTT agent needs to process a
+ * command that originates from application.  Examples of commands are PUBLISH and
+ * SUBSCRIBE.  The MQTTAgentCommand_t structure must persist for the duration of the command's
+ * operation so are obtained from a pool of statically allocated structures when a
+ * new command is created, and returned to the pool when the command is complete.
+ * The MQTT_COMMAND_CONTEXTS_POOL_SIZE configuration file constant defines how many
+ * structures the pool contains.
+ *
+ * @param[in] pCommandToRelease A pointer to the MQTTAgentCommand_t structure to return to
+ * the pool.  The structure must first have been obtained by calling
+ * Agent_GetCommand(), otherwise Agent_ReleaseCommand() will
+ * have no effect.
+ *
+ * @return true if the MQTTAgentCommand_t structure was returned to the pool, otherwise false.
+ */
+bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease );
+
+/**
+ * @brief Read the usage statistics of the pool.
+ * @note Each counter is read atomically, but counters updated by a concurrent
+ * call may be one step apart.
+ * @param[out] pStats Where to store the statistics.
+ */
+void Agent_GetPoolStats( AgentCommandPoolStats_t * pStats );
+
+#endif /* FREERTOS_COMMAND_POOL_H */
@@ -77,5 +77,7 @@
 /* coreMQTT-Agent configurations */
 #define MQTT_AGENT_MAX_OUTSTANDING_ACKS CONFIG_MQTT_AGENT_MAX_OUTSTANDING_ACKS
 #define MQTT_AGENT_MAX_EVENT_QUEUE_WAIT_TIME CONFIG_MQTT_AGENT_MAX_EVENT_QUEUE_WAIT_TIME
+#define MQTT_COMMAND_CONTEXTS_POOL_SIZE CONFIG_MQTT_AGENT_COMMAND_POOL_SIZE
+#define MQTT_COMMAND_CONTEXTS_POOL_OVERFLOW CONFIG_MQTT_AGENT_COMMAND_POOL_OVERFLOW
 
 #endif /* COREMQTT_CONFIG_H */
\ No newline at end of file
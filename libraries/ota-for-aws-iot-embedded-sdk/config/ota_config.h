@@ -69,21 +69,36 @@
     #undef LogDebug
 #endif
 
+/* With deferred logging the OTA agent, which logs every file block, only
+ * records its log arguments; see log_deferred.h in posix_compat. */
+#if CONFIG_LOG_DEFERRED_ENABLE
+    #include "log_deferred.h"
+    #define OTA_LOGE( ... ) LOG_DEFERRED( ESP_LOG_ERROR, LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGW( ... ) LOG_DEFERRED( ESP_LOG_WARN, LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGI( ... ) LOG_DEFERRED( ESP_LOG_INFO, LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGD( ... ) LOG_DEFERRED( ESP_LOG_DEBUG, LIBRARY_LOG_NAME, __VA_ARGS__ )
+#else
+    #define OTA_LOGE( ... ) ESP_LOGE( LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGW( ... ) ESP_LOGW( LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGI( ... ) ESP_LOGI( LIBRARY_LOG_NAME, __VA_ARGS__ )
+    #define OTA_LOGD( ... ) ESP_LOGD( LIBRARY_LOG_NAME, __VA_ARGS__ )
+#endif
+
 /* Define logging macros based on configurations in sdkconfig.h. */
 #if CONFIG_AWS_OTA_LOG_ERROR
-    #define LogError( message, ... ) ESP_LOGE( LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define LogError( message, ... ) OTA_LOGE( REMOVE_PARENS( message ), ##__VA_ARGS__ )
 #endif
 
 #if CONFIG_AWS_OTA_LOG_WARN
-    #define LogWarn( message, ... ) ESP_LOGW( LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define LogWarn( message, ... ) OTA_LOGW( REMOVE_PARENS( message ), ##__VA_ARGS__ )
 #endif
 
 #if CONFIG_AWS_OTA_LOG_INFO
-    #define LogInfo( message, ... ) ESP_LOGI( LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define LogInfo( message, ... ) OTA_LOGI( REMOVE_PARENS( message ), ##__VA_ARGS__ )
 #endif
 
 #if CONFIG_AWS_OTA_LOG_DEBUG
-    #define LogDebug( message, ... ) ESP_LOGD( LIBRARY_LOG_NAME, REMOVE_PARENS( message ), ##__VA_ARGS__ )
+    #define LogDebug( message, ... ) OTA_LOGD( REMOVE_PARENS( message ), ##__VA_ARGS__ )
 #endif
 
 /************ End of logging configuration ****************/
@@ -28,9 +28,11 @@
 
 /* FreeRTOS includes. */
 #include "freertos/FreeRTOS.h"
-#include "freertos/timers.h"
 #include "freertos/queue.h"
 
+/* Shared timer service include. */
+#include "timer_service.h"
+
 /* OTA OS POSIX Interface Includes.*/
 #include "ota_os_freertos.h"
 
@@ -54,13 +56,18 @@ static QueueHandle_t otaEventQueue;
 /* OTA App Timer callback.*/
 static OtaTimerCallback_t otaTimerCallback;
 
-/* OTA Timer handles.*/
-static TimerHandle_t otaTimer[ OtaNumOfTimers ];
+/* OTA Timers, run by the shared timer service.*/
+static TimerWheelNode_t otaTimer[ OtaNumOfTimers ];
+
+/* Whether each OTA timer has been created.*/
+static bool otaTimerCreated[ OtaNumOfTimers ];
 
 /* OTA Timer callbacks.*/
-static void requestTimerCallback( TimerHandle_t T );
-static void selfTestTimerCallback( TimerHandle_t T );
-void ( * timerCallback[ OtaNumOfTimers ] )( TimerHandle_t T ) = { requestTimerCallback, selfTestTimerCallback };
+static void requestTimerCallback( TimerWheelNode_t * pNode,
+                                  void * pArg );
+static void selfTestTimerCallback( TimerWheelNode_t * pNode,
+                                   void * pArg );
+static const TimerWheelCallback_t timerCallback[ OtaNumOfTimers ] = { requestTimerCallback, selfTestTimerCallback };
 
 OtaOsStatus_t OtaInitEvent_FreeRTOS( OtaEventContext_t * pEventCtx )
 {
@@ -171,9 +178,11 @@ OtaOsStatus_t OtaDeinitEvent_FreeRTOS( OtaEventContext_t * pEventCtx )
     return otaOsStatus;
 }
 
-static void selfTestTimerCallback( TimerHandle_t T )
+static void selfTestTimerCallback( TimerWheelNode_t * pNode,
+                                   void * pArg )
 {
-    ( void ) T;
+    ( void ) pNode;
+    ( void ) pArg;
 
     LogDebug( ( "Self-test expired within %ums\r\n",
                 otaconfigSELF_TEST_RESPONSE_WAIT_MS ) );
@@ -188,9 +197,11 @@ static void selfTestTimerCallback( TimerHandle_t T )
     }
 }
 
-static void requestTimerCallback( TimerHandle_t T )
+static void requestTimerCallback( TimerWheelNode_t * pNode,
+                                  void * pArg )
 {
-    ( void ) T;
+    ( void ) pNode;
+    ( void ) pArg;
 
     LogDebug( ( "Request timer expired in %ums \r\n",
                 otaconfigFILE_REQUEST_WAIT_MS ) );
@@ -211,7 +222,6 @@ OtaOsStatus_t OtaStartTimer_FreeRTOS( OtaTimerId_t otaTimerId,
                                       OtaTimerCallback_t callback )
 {
     OtaOsStatus_t otaOsStatus = OtaOsSuccess;
-    BaseType_t retVal = pdFALSE;
 
     configASSERT( callback != NULL );
     configASSERT( pTimerName != NULL );
@@ -220,63 +230,38 @@ OtaOsStatus_t OtaStartTimer_FreeRTOS( OtaTimerId_t otaTimerId,
     otaTimerCallback = callback;
 
     /* If timer is not created.*/
-    if( otaTimer[ otaTimerId ] == NULL )
+    if( !otaTimerCreated[ otaTimerId ] )
     {
         /* Create the timer. */
-        otaTimer[ otaTimerId ] = xTimerCreate( pTimerName,
-                                               pdMS_TO_TICKS( timeout ),
-                                               pdFALSE,
-                                               NULL,
-                                               timerCallback[ otaTimerId ] );
-
-        if( otaTimer[ otaTimerId ] == NULL )
+        if( TimerService_Start() )
         {
-            otaOsStatus = OtaOsTimerCreateFailed;
+            TimerWheel_InitNode( &otaTimer[ otaTimerId ], timerCallback[ otaTimerId ], NULL );
+            otaTimerCreated[ otaTimerId ] = true;
 
-            LogError( ( "Failed to create OTA timer: "
-                        "timerCreate returned NULL "
-                        "OtaOsStatus_t=%i ",
-                        otaOsStatus ) );
-        }
-        else
-        {
             LogDebug( ( "OTA Timer created." ) );
 
             /* Start the timer. */
-            retVal = xTimerStart( otaTimer[ otaTimerId ], portMAX_DELAY );
-
-            if( retVal == pdTRUE )
-            {
-                LogDebug( ( "OTA Timer started." ) );
-            }
-            else
-            {
-                otaOsStatus = OtaOsTimerStartFailed;
-
-                LogError( ( "Failed to start OTA timer: "
-                            "timerStart returned error." ) );
-            }
-        }
-    }
-    else
-    {
-        /* Reset the timer. */
-        retVal = xTimerReset( otaTimer[ otaTimerId ], portMAX_DELAY );
+            TimerService_Arm( &otaTimer[ otaTimerId ], timeout );
 
-        if( retVal == pdTRUE )
-        {
-            LogDebug( ( "OTA Timer restarted." ) );
+            LogDebug( ( "OTA Timer started." ) );
         }
         else
         {
-            otaOsStatus = OtaOsTimerRestartFailed;
+            otaOsStatus = OtaOsTimerCreateFailed;
 
-            LogError( ( "Failed to set OTA timer timeout: "
-                        "timer_settime returned error: "
+            LogError( ( "Failed to create OTA timer: "
+                        "timer service did not start "
                         "OtaOsStatus_t=%i ",
                         otaOsStatus ) );
         }
     }
+    else
+    {
+        /* Reset the timer. */
+        TimerService_Arm( &otaTimer[ otaTimerId ], timeout );
+
+        LogDebug( ( "OTA Timer restarted." ) );
+    }
 
     return otaOsStatus;
 }
@@ -284,26 +269,13 @@ OtaOsStatus_t OtaStartTimer_FreeRTOS( OtaTimerId_t otaTimerId,
 OtaOsStatus_t OtaStopTimer_FreeRTOS( OtaTimerId_t otaTimerId )
 {
     OtaOsStatus_t otaOsStatus = OtaOsSuccess;
-    BaseType_t retVal = pdFALSE;
 
-    if( otaTimer[ otaTimerId ] != NULL )
+    if( otaTimerCreated[ otaTimerId ] )
     {
         /* Stop the timer. */
-        retVal = xTimerStop( otaTimer[ otaTimerId ], portMAX_DELAY );
-
-        if( retVal == pdTRUE )
-        {
-            LogDebug( ( "OTA Timer Stopped for Timerid=%i.", otaTimerId ) );
-        }
-        else
-        {
-            LogError( ( "Failed to stop OTA timer: "
-                        "timer_settime returned error: "
-                        "OtaOsStatus_t=%i ",
-                        otaOsStatus ) );
+        TimerService_Cancel( &otaTimer[ otaTimerId ] );
 
-            otaOsStatus = OtaOsTimerStopFailed;
-        }
+        LogDebug( ( "OTA Timer Stopped for Timerid=%i.", otaTimerId ) );
     }
     else
     {
@@ -316,27 +288,14 @@ OtaOsStatus_t OtaStopTimer_FreeRTOS( OtaTimerId_t otaTimerId )
 OtaOsStatus_t OtaDeleteTimer_FreeRTOS( OtaTimerId_t otaTimerId )
 {
     OtaOsStatus_t otaOsStatus = OtaOsSuccess;
-    BaseType_t retVal = pdFALSE;
 
-    if( otaTimer[ otaTimerId ] != NULL )
+    if( otaTimerCreated[ otaTimerId ] )
     {
         /* Delete the timer. */
-        retVal = xTimerDelete( otaTimer[ otaTimerId ], portMAX_DELAY );
-
-        if( retVal == pdTRUE )
-        {
-            otaTimer[ otaTimerId ] = NULL;
-            LogDebug( ( "OTA Timer deleted." ) );
-        }
-        else
-        {
-            otaOsStatus = OtaOsTimerDeleteFailed;
+        TimerService_Cancel( &otaTimer[ otaTimerId ] );
+        otaTimerCreated[ otaTimerId ] = false;
 
-            LogError( ( "Failed to delete OTA timer: "
-                        "timer_delete returned error: "
-                        "OtaOsStatus_t=%i ",
-                        otaOsStatus ) );
-        }
+        LogDebug( ( "OTA Timer deleted." ) );
     }
     else
     {